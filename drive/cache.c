@@ -0,0 +1,622 @@
+#include <ofsl/drive/cache.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "export.h"
+#include "drive/internal.h"
+
+/* maximum number of consecutive missing blocks loaded by a single read */
+#define LOAD_BATCH_MAX  64
+
+struct cache_block {
+    lba_t index;                    /* block index, lba / block_sectors */
+    struct cache_block* hash_next;
+    struct cache_block* lru_prev;
+    struct cache_block* lru_next;
+    size_t sector_cnt;              /* less than block_sectors at the end of the drive */
+    uint8_t dirty : 1;
+    uint8_t* data;
+};
+
+struct drive_cache {
+    OFSL_Drive drv;
+    OFSL_Drive* lower;
+    pthread_mutex_t lock;
+    size_t block_sectors;
+    size_t block_size;
+    size_t block_max;
+    size_t block_count;
+    size_t batch_max;
+    int writeback;
+    struct cache_block** hash;
+    unsigned int hash_bits;
+    struct cache_block* lru_head;   /* most recently used */
+    struct cache_block* lru_tail;   /* least recently used */
+};
+
+static size_t hash_index(struct drive_cache* cache, lba_t index)
+{
+    return (index * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - cache->hash_bits);
+}
+
+static struct cache_block* lookup_block(struct drive_cache* cache, lba_t index)
+{
+    struct cache_block* blk = cache->hash[hash_index(cache, index)];
+    while (blk && blk->index != index) {
+        blk = blk->hash_next;
+    }
+    return blk;
+}
+
+static void hash_remove(struct drive_cache* cache, struct cache_block* blk)
+{
+    struct cache_block** link = &cache->hash[hash_index(cache, blk->index)];
+    while (*link != blk) {
+        link = &(*link)->hash_next;
+    }
+    *link = blk->hash_next;
+}
+
+static void lru_unlink(struct drive_cache* cache, struct cache_block* blk)
+{
+    if (blk->lru_prev) {
+        blk->lru_prev->lru_next = blk->lru_next;
+    } else {
+        cache->lru_head = blk->lru_next;
+    }
+    if (blk->lru_next) {
+        blk->lru_next->lru_prev = blk->lru_prev;
+    } else {
+        cache->lru_tail = blk->lru_prev;
+    }
+}
+
+static void lru_push_front(struct drive_cache* cache, struct cache_block* blk)
+{
+    blk->lru_prev = NULL;
+    blk->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = blk;
+    } else {
+        cache->lru_tail = blk;
+    }
+    cache->lru_head = blk;
+}
+
+static void touch_block(struct drive_cache* cache, struct cache_block* blk)
+{
+    if (cache->lru_head != blk) {
+        lru_unlink(cache, blk);
+        lru_push_front(cache, blk);
+    }
+}
+
+static lba_t block_lba(struct drive_cache* cache, struct cache_block* blk)
+{
+    return blk->index * cache->block_sectors;
+}
+
+/**
+ * @brief Write a block back to the lower drive if dirty
+ *
+ * @param cache cache drive object struct
+ * @param blk cached block
+ * @return int 0 if succeed, nonzero otherwise (the block stays dirty)
+ */
+static int write_back_block(struct drive_cache* cache, struct cache_block* blk)
+{
+    if (blk->dirty) {
+        if (ofsl_drive_write_sector(
+                cache->lower,
+                blk->data,
+                block_lba(cache, blk),
+                cache->drv.drvinfo.sector_size,
+                blk->sector_cnt) != (ssize_t)blk->sector_cnt) {
+            return 1;
+        }
+        blk->dirty = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Get an unused block for the given block index
+ *
+ * @param cache cache drive object struct
+ * @param index block index
+ * @return struct cache_block* block which is not loaded yet, NULL if failed
+ *
+ * @details
+ *  A new block is allocated until the budget is reached. After that, the
+ * least recently used block is written back if dirty and reused. Nothing is
+ * reused if the write back fails.
+ */
+static struct cache_block* acquire_block(struct drive_cache* cache, lba_t index)
+{
+    struct cache_block* blk;
+
+    if (cache->block_count < cache->block_max) {
+        blk = malloc(sizeof(struct cache_block));
+        if (!blk) {
+            return NULL;
+        }
+        blk->data = ofsl_drive_alloc_buffer(cache->lower, cache->block_size);
+        if (!blk->data) {
+            free(blk);
+            return NULL;
+        }
+        cache->block_count++;
+    } else {
+        blk = cache->lru_tail;
+        if (write_back_block(cache, blk)) {
+            return NULL;
+        }
+        lru_unlink(cache, blk);
+        hash_remove(cache, blk);
+    }
+
+    const lba_t lba = index * cache->block_sectors;
+    const lba_t avail = cache->drv.drvinfo.lba_max - lba + 1;
+
+    blk->index = index;
+    blk->sector_cnt = avail < cache->block_sectors ? avail : cache->block_sectors;
+    blk->dirty = 0;
+
+    size_t hidx = hash_index(cache, index);
+    blk->hash_next = cache->hash[hidx];
+    cache->hash[hidx] = blk;
+    lru_push_front(cache, blk);
+
+    return blk;
+}
+
+static void release_block(struct drive_cache* cache, struct cache_block* blk)
+{
+    lru_unlink(cache, blk);
+    hash_remove(cache, blk);
+    ofsl_drive_free_buffer(blk->data);
+    free(blk);
+    cache->block_count--;
+}
+
+/**
+ * @brief Copy the part of a block overlapping the requested range
+ *
+ * @param cache cache drive object struct
+ * @param blk cached block
+ * @param buf buffer of the whole request
+ * @param lba LBA address of the first sector of the request
+ * @param cnt number of sectors of the request
+ * @param to_block copy from buf to the block if nonzero, otherwise the other
+ *                 way around
+ */
+static void
+copy_block(
+    struct drive_cache* cache,
+    struct cache_block* blk,
+    uint8_t* buf,
+    lba_t lba,
+    size_t cnt,
+    int to_block)
+{
+    const size_t sector_size = cache->drv.drvinfo.sector_size;
+    const lba_t blk_begin = block_lba(cache, blk);
+    const lba_t blk_end = blk_begin + blk->sector_cnt;
+    const lba_t begin = lba > blk_begin ? lba : blk_begin;
+    const lba_t end = lba + cnt < blk_end ? lba + cnt : blk_end;
+
+    if (begin >= end) {
+        return;
+    }
+
+    uint8_t* bbuf = buf + (begin - lba) * sector_size;
+    uint8_t* bdata = blk->data + (begin - blk_begin) * sector_size;
+    if (to_block) {
+        memcpy(bdata, bbuf, (end - begin) * sector_size);
+    } else {
+        memcpy(bbuf, bdata, (end - begin) * sector_size);
+    }
+}
+
+/**
+ * @brief Load missing blocks from the lower drive and copy them out
+ *
+ * @param cache cache drive object struct
+ * @param batch blocks to load
+ * @param batch_cnt number of blocks
+ * @param buf buffer of the whole request
+ * @param lba LBA address of the first sector of the request
+ * @param cnt number of sectors of the request
+ * @return lba_t LBA address of the first sector failed to load, lba + cnt if
+ *               every block is loaded
+ */
+static lba_t
+load_blocks(
+    struct drive_cache* cache,
+    struct cache_block** batch,
+    size_t batch_cnt,
+    uint8_t* buf,
+    lba_t lba,
+    size_t cnt)
+{
+    OFSL_DriveIOVec iov[LOAD_BATCH_MAX];
+    for (size_t i = 0; i < batch_cnt; i++) {
+        iov[i].lba = block_lba(cache, batch[i]);
+        iov[i].cnt = batch[i]->sector_cnt;
+        iov[i].buf = batch[i]->data;
+    }
+
+    ssize_t ret = ofsl_drive_read_sectorv(
+        cache->lower,
+        iov,
+        batch_cnt,
+        cache->drv.drvinfo.sector_size);
+    size_t loaded = ret > 0 ? ret : 0;
+
+    lba_t fail_lba = lba + cnt;
+    for (size_t i = 0; i < batch_cnt; i++) {
+        if (loaded >= iov[i].cnt) {
+            loaded -= iov[i].cnt;
+            copy_block(cache, batch[i], buf, lba, cnt, 0);
+        } else {
+            /* keep only the blocks loaded entirely */
+            lba_t blk_begin = iov[i].lba > lba ? iov[i].lba : lba;
+            if (blk_begin < fail_lba) {
+                fail_lba = blk_begin;
+            }
+            loaded = 0;
+            release_block(cache, batch[i]);
+        }
+    }
+
+    return fail_lba;
+}
+
+/**
+ * @brief Write back the dirty blocks overlapping a range, optionally dropping
+ *        every overlapping block
+ *
+ * @param cache cache drive object struct
+ * @param lba LBA address of the first sector
+ * @param cnt number of sectors
+ * @param invalidate drop the blocks from the cache if nonzero
+ * @return int 0 if succeed, nonzero if any block failed to be written back
+ */
+static int sync_range(struct drive_cache* cache, lba_t lba, size_t cnt, int invalidate)
+{
+    if (cnt == 0) {
+        return 0;
+    }
+
+    const lba_t first = lba / cache->block_sectors;
+    const lba_t last = (lba + cnt - 1) / cache->block_sectors;
+
+    for (lba_t index = first; index <= last; index++) {
+        struct cache_block* blk = lookup_block(cache, index);
+        if (!blk) continue;
+
+        if (write_back_block(cache, blk)) {
+            /* keep the block, it holds the only copy of the data */
+            return 1;
+        }
+        if (invalidate) {
+            release_block(cache, blk);
+        }
+    }
+    return 0;
+}
+
+static int compare_block_index(const void* a, const void* b)
+{
+    const struct cache_block* blk_a = *(struct cache_block* const*)a;
+    const struct cache_block* blk_b = *(struct cache_block* const*)b;
+
+    if (blk_a->index < blk_b->index) return -1;
+    if (blk_a->index > blk_b->index) return 1;
+    return 0;
+}
+
+/**
+ * @brief Write back every dirty block in LBA order
+ *
+ * @param cache cache drive object struct
+ * @return int 0 if succeed, nonzero otherwise
+ */
+static int flush_blocks(struct drive_cache* cache)
+{
+    struct cache_block** dirty =
+        malloc(sizeof(struct cache_block*) * (cache->block_count + 1));
+    if (!dirty) {
+        return 1;
+    }
+
+    size_t dirty_cnt = 0;
+    for (struct cache_block* blk = cache->lru_head; blk; blk = blk->lru_next) {
+        if (blk->dirty) {
+            dirty[dirty_cnt++] = blk;
+        }
+    }
+    qsort(dirty, dirty_cnt, sizeof(struct cache_block*), compare_block_index);
+
+    OFSL_DriveIOVec* iov = malloc(sizeof(OFSL_DriveIOVec) * (dirty_cnt + 1));
+    if (!iov) {
+        free(dirty);
+        return 1;
+    }
+
+    size_t sector_total = 0;
+    for (size_t i = 0; i < dirty_cnt; i++) {
+        iov[i].lba = block_lba(cache, dirty[i]);
+        iov[i].cnt = dirty[i]->sector_cnt;
+        iov[i].buf = dirty[i]->data;
+        sector_total += iov[i].cnt;
+    }
+
+    ssize_t ret = ofsl_drive_write_sectorv(
+        cache->lower,
+        iov,
+        dirty_cnt,
+        cache->drv.drvinfo.sector_size);
+
+    /* blocks which failed to be written stay dirty */
+    size_t written = ret > 0 ? ret : 0;
+    for (size_t i = 0; i < dirty_cnt && written >= iov[i].cnt; i++) {
+        written -= iov[i].cnt;
+        dirty[i]->dirty = 0;
+    }
+
+    free(iov);
+    free(dirty);
+    return ret < 0 || (size_t)ret < sector_total;
+}
+
+static int update_info(OFSL_Drive* drv_opaque)
+{
+    struct drive_cache* cache = (struct drive_cache*)drv_opaque;
+
+    pthread_mutex_lock(&cache->lock);
+    int ret = ofsl_drive_update_info(cache->lower);
+    if (cache->lower->drvinfo.lba_max != cache->drv.drvinfo.lba_max) {
+        /* the last block may have a different size now */
+        flush_blocks(cache);
+        while (cache->lru_head) {
+            release_block(cache, cache->lru_head);
+        }
+    }
+    cache->drv.drvinfo.lba_max = cache->lower->drvinfo.lba_max;
+    cache->drv.drvinfo.readonly = cache->lower->drvinfo.readonly;
+    pthread_mutex_unlock(&cache->lock);
+
+    return ret;
+}
+
+static ssize_t read_sector(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_cache* cache = (struct drive_cache*)drv_opaque;
+
+    pthread_mutex_lock(&cache->lock);
+
+    if (sector_size != cache->drv.drvinfo.sector_size) {
+        ssize_t ret = 0;
+        if (!sync_range(cache, lba, cnt, 0)) {
+            ret = ofsl_drive_read_sector(cache->lower, buf, lba, sector_size, cnt);
+        }
+        pthread_mutex_unlock(&cache->lock);
+        return ret;
+    }
+
+    cnt = drive_clamp_count(&cache->drv, lba, cnt);
+    if (cnt == 0) {
+        pthread_mutex_unlock(&cache->lock);
+        return 0;
+    }
+
+    struct cache_block* batch[LOAD_BATCH_MAX];
+    size_t batch_cnt = 0;
+    lba_t fail_lba = lba + cnt;
+
+    const lba_t first = lba / cache->block_sectors;
+    const lba_t last = (lba + cnt - 1) / cache->block_sectors;
+    for (lba_t index = first; index <= last; index++) {
+        struct cache_block* blk = lookup_block(cache, index);
+        if (blk) {
+            /*
+             * a batch is a run of consecutive missing blocks, and touching
+             * other blocks may get the blocks of the batch evicted
+             */
+            if (batch_cnt > 0) {
+                lba_t ret = load_blocks(cache, batch, batch_cnt, buf, lba, cnt);
+                if (ret < fail_lba) fail_lba = ret;
+                batch_cnt = 0;
+            }
+            touch_block(cache, blk);
+            copy_block(cache, blk, buf, lba, cnt, 0);
+            continue;
+        }
+
+        blk = acquire_block(cache, index);
+        if (!blk) {
+            if (index * cache->block_sectors < fail_lba) {
+                fail_lba = index * cache->block_sectors;
+            }
+            break;
+        }
+        batch[batch_cnt++] = blk;
+
+        /* load before the blocks of the batch start being evicted */
+        if (batch_cnt == cache->batch_max) {
+            lba_t ret = load_blocks(cache, batch, batch_cnt, buf, lba, cnt);
+            if (ret < fail_lba) fail_lba = ret;
+            batch_cnt = 0;
+        }
+    }
+    if (batch_cnt > 0) {
+        lba_t ret = load_blocks(cache, batch, batch_cnt, buf, lba, cnt);
+        if (ret < fail_lba) fail_lba = ret;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+
+    return fail_lba > lba ? fail_lba - lba : 0;
+}
+
+static ssize_t write_sector(OFSL_Drive* drv_opaque, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_cache* cache = (struct drive_cache*)drv_opaque;
+    ssize_t ret;
+
+    pthread_mutex_lock(&cache->lock);
+
+    if (sector_size != cache->drv.drvinfo.sector_size) {
+        ret = 0;
+        if (!sync_range(cache, lba, cnt, 1)) {
+            ret = ofsl_drive_write_sector(cache->lower, buf, lba, sector_size, cnt);
+        }
+        pthread_mutex_unlock(&cache->lock);
+        return ret;
+    }
+
+    if (!cache->writeback) {
+        ret = ofsl_drive_write_sector(cache->lower, buf, lba, sector_size, cnt);
+        if (ret > 0) {
+            /* keep the cached copies up to date */
+            const lba_t first = lba / cache->block_sectors;
+            const lba_t last = (lba + ret - 1) / cache->block_sectors;
+            for (lba_t index = first; index <= last; index++) {
+                struct cache_block* blk = lookup_block(cache, index);
+                if (blk) {
+                    copy_block(cache, blk, (uint8_t*)buf, lba, ret, 1);
+                }
+            }
+        }
+        pthread_mutex_unlock(&cache->lock);
+        return ret;
+    }
+
+    if (cache->drv.drvinfo.readonly) {
+        pthread_mutex_unlock(&cache->lock);
+        return 0;
+    }
+
+    cnt = drive_clamp_count(&cache->drv, lba, cnt);
+    ret = 0;
+
+    const lba_t first = lba / cache->block_sectors;
+    const lba_t last = cnt ? (lba + cnt - 1) / cache->block_sectors : first;
+    for (lba_t index = first; cnt > 0 && index <= last; index++) {
+        struct cache_block* blk = lookup_block(cache, index);
+        if (blk) {
+            touch_block(cache, blk);
+        } else {
+            blk = acquire_block(cache, index);
+            if (!blk) break;
+
+            /* load the rest of the block unless it is overwritten entirely */
+            const lba_t blk_begin = block_lba(cache, blk);
+            if (lba > blk_begin || lba + cnt < blk_begin + blk->sector_cnt) {
+                if (ofsl_drive_read_sector(
+                        cache->lower,
+                        blk->data,
+                        blk_begin,
+                        sector_size,
+                        blk->sector_cnt) < (ssize_t)blk->sector_cnt) {
+                    release_block(cache, blk);
+                    break;
+                }
+            }
+        }
+
+        copy_block(cache, blk, (uint8_t*)buf, lba, cnt, 1);
+        blk->dirty = 1;
+
+        const lba_t blk_end = block_lba(cache, blk) + blk->sector_cnt;
+        ret = (lba + cnt < blk_end ? lba + cnt : blk_end) - lba;
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+    return ret;
+}
+
+static int flush(OFSL_Drive* drv_opaque)
+{
+    struct drive_cache* cache = (struct drive_cache*)drv_opaque;
+
+    pthread_mutex_lock(&cache->lock);
+    int ret = flush_blocks(cache);
+    pthread_mutex_unlock(&cache->lock);
+
+    return ofsl_drive_flush(cache->lower) || ret;
+}
+
+static void _delete(OFSL_Drive* drv_opaque)
+{
+    struct drive_cache* cache = (struct drive_cache*)drv_opaque;
+
+    flush_blocks(cache);
+    while (cache->lru_head) {
+        release_block(cache, cache->lru_head);
+    }
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->hash);
+    free(cache);
+}
+
+OFSL_EXPORT
+OFSL_Drive* ofsl_drive_cache_create(OFSL_Drive* lower, size_t bytes, size_t block_sectors, int flags)
+{
+    static const struct ofsl_drive_ops drvops = {
+        ._delete = _delete,
+        .update_info = update_info,
+        .read_sector = read_sector,
+        .write_sector = write_sector,
+        .flush = flush,
+    };
+
+    if (!lower || block_sectors == 0) {
+        return NULL;
+    }
+
+    const size_t block_size = block_sectors * lower->drvinfo.sector_size;
+    size_t block_max = bytes / block_size;
+    if (block_max == 0) {
+        block_max = 1;
+    }
+
+    struct drive_cache* cache = malloc(sizeof(struct drive_cache));
+    if (!cache) {
+        return NULL;
+    }
+
+    /* keep the load factor of the hash table at most 1 */
+    cache->hash_bits = 1;
+    while (((size_t)1 << cache->hash_bits) < block_max) {
+        cache->hash_bits++;
+    }
+    cache->hash = calloc((size_t)1 << cache->hash_bits, sizeof(struct cache_block*));
+    if (!cache->hash) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->drv.ops = &drvops;
+    cache->drv.drvinfo = lower->drvinfo;
+    cache->drv.drvinfo.buf_align = 0;
+    cache->lower = lower;
+    pthread_mutex_init(&cache->lock, NULL);
+    cache->block_sectors = block_sectors;
+    cache->block_size = block_size;
+    cache->block_max = block_max;
+    cache->block_count = 0;
+    cache->batch_max = block_max / 2 ? block_max / 2 : 1;
+    if (cache->batch_max > LOAD_BATCH_MAX) {
+        cache->batch_max = LOAD_BATCH_MAX;
+    }
+    cache->writeback = !!(flags & OFSL_DRIVE_CACHE_WRITEBACK);
+    cache->lru_head = NULL;
+    cache->lru_tail = NULL;
+
+    return (OFSL_Drive*)cache;
+}
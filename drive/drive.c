@@ -0,0 +1,185 @@
+#include <ofsl/drive/drive.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "export.h"
+#include "drive/internal.h"
+
+OFSL_EXPORT
+void* ofsl_drive_alloc_buffer(OFSL_Drive* drv, size_t size)
+{
+    size_t align = drv->drvinfo.buf_align;
+
+    if (align <= 1) {
+        return malloc(size);
+    }
+
+    /* posix_memalign() requires a multiple of the pointer size */
+    if (align < sizeof(void*)) {
+        align = sizeof(void*);
+    }
+
+    void* buf;
+    if (posix_memalign(&buf, align, size)) {
+        return NULL;
+    }
+    return buf;
+}
+
+OFSL_EXPORT
+void ofsl_drive_free_buffer(void* buf)
+{
+    free(buf);
+}
+
+OFSL_EXPORT
+ssize_t
+ofsl_drive_read_sectorv(
+    OFSL_Drive* drv,
+    const OFSL_DriveIOVec* iov,
+    size_t iovcnt,
+    size_t sector_size)
+{
+    if (drv->ops->read_sectorv) {
+        return drv->ops->read_sectorv(drv, iov, iovcnt, sector_size);
+    }
+
+    ssize_t total = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        ssize_t ret = ofsl_drive_read_sector(
+            drv,
+            iov[i].buf,
+            iov[i].lba,
+            sector_size,
+            iov[i].cnt);
+        if (ret > 0) {
+            total += ret;
+        }
+        if (ret < (ssize_t)iov[i].cnt) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+OFSL_EXPORT
+ssize_t
+ofsl_drive_write_sectorv(
+    OFSL_Drive* drv,
+    const OFSL_DriveIOVec* iov,
+    size_t iovcnt,
+    size_t sector_size)
+{
+    if (drv->ops->write_sectorv) {
+        return drv->ops->write_sectorv(drv, iov, iovcnt, sector_size);
+    }
+
+    ssize_t total = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        ssize_t ret = ofsl_drive_write_sector(
+            drv,
+            iov[i].buf,
+            iov[i].lba,
+            sector_size,
+            iov[i].cnt);
+        if (ret > 0) {
+            total += ret;
+        }
+        if (ret < (ssize_t)iov[i].cnt) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+OFSL_HIDDEN
+size_t drive_clamp_count(const OFSL_Drive* drv, lba_t lba, size_t cnt)
+{
+    if (lba > drv->drvinfo.lba_max) {
+        return 0;
+    }
+
+    lba_t avail = drv->drvinfo.lba_max - lba + 1;
+    return cnt < avail ? cnt : avail;
+}
+
+OFSL_HIDDEN
+ssize_t
+drive_mem_read(
+    const OFSL_Drive* drv,
+    const uint8_t* data,
+    void* buf,
+    lba_t lba,
+    size_t sector_size,
+    size_t cnt)
+{
+    const uint16_t img_sector_size = drv->drvinfo.sector_size;
+
+    if (sector_size > img_sector_size) {
+        return 0;
+    }
+
+    cnt = drive_clamp_count(drv, lba, cnt);
+    const uint8_t* src = data + lba * img_sector_size;
+
+    if (sector_size == img_sector_size) {
+        memcpy(buf, src, cnt * sector_size);
+        return cnt;
+    }
+
+    uint8_t* bbuf = buf;
+    for (size_t i = 0; i < cnt; i++) {
+        memcpy(bbuf, src, sector_size);
+        bbuf += sector_size;
+        src += img_sector_size;
+    }
+
+    return cnt;
+}
+
+OFSL_HIDDEN
+ssize_t
+drive_mem_write(
+    const OFSL_Drive* drv,
+    uint8_t* data,
+    const void* buf,
+    lba_t lba,
+    size_t sector_size,
+    size_t cnt)
+{
+    const uint16_t img_sector_size = drv->drvinfo.sector_size;
+
+    if (sector_size > img_sector_size || drv->drvinfo.readonly) {
+        return 0;
+    }
+
+    cnt = drive_clamp_count(drv, lba, cnt);
+    uint8_t* dest = data + lba * img_sector_size;
+
+    if (sector_size == img_sector_size) {
+        memcpy(dest, buf, cnt * sector_size);
+        return cnt;
+    }
+
+    const uint8_t* bbuf = buf;
+    for (size_t i = 0; i < cnt; i++) {
+        memcpy(dest, bbuf, sector_size);
+        bbuf += sector_size;
+        dest += img_sector_size;
+    }
+
+    return cnt;
+}
+
+OFSL_HIDDEN
+const void* drive_mem_map(const OFSL_Drive* drv, const uint8_t* data, lba_t lba, size_t cnt)
+{
+    if (cnt == 0 || drive_clamp_count(drv, lba, cnt) < cnt) {
+        return NULL;
+    }
+
+    return data + lba * drv->drvinfo.sector_size;
+}
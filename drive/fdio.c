@@ -0,0 +1,494 @@
+#include "drive/fdio.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define USE_IO_URING
+#endif
+#endif
+
+#define URING_ENTRIES       64
+#define WORKER_COUNT        4
+
+struct fdio_request {
+    struct fdio_request* next;
+    struct iovec iov;
+    off_t offs;
+    int is_write;
+    OFSL_DriveCompletion comp;
+};
+
+#ifdef USE_IO_URING
+struct uring {
+    int fd;
+    void* sq_ptr;
+    size_t sq_len;
+    void* cq_ptr;
+    size_t cq_len;
+    struct io_uring_sqe* sqes;
+    size_t sqes_len;
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned sq_mask;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    unsigned cq_entries;
+    struct io_uring_cqe* cqes;
+};
+#endif
+
+struct fdio_queue {
+    int fd;
+    size_t unit;
+    pthread_mutex_t lock;
+    pthread_cond_t done_cond;       /* signaled when a transfer is completed */
+    pthread_cond_t pending_cond;    /* signaled when a transfer is queued */
+    size_t inflight;                /* submitted but not completed yet */
+
+    /* completed but not reaped yet */
+    struct fdio_request* done_head;
+    struct fdio_request** done_tail;
+
+#ifdef USE_IO_URING
+    int use_uring;
+    struct uring ring;
+#endif
+
+    /* thread pool fallback */
+    struct fdio_request* pending_head;
+    struct fdio_request** pending_tail;
+    pthread_t workers[WORKER_COUNT];
+    int worker_count;
+    int stopping;
+};
+
+OFSL_HIDDEN
+ssize_t fdio_transfer(int fd, struct iovec* iov, int iovcnt, off_t offs, int is_write)
+{
+    size_t done = 0;
+
+    while (iovcnt > 0) {
+        ssize_t ret =
+            is_write ?
+                pwritev(fd, iov, iovcnt, offs + done) :
+                preadv(fd, iov, iovcnt, offs + done);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            if (done == 0) return -1;
+            break;
+        } else if (ret == 0) {
+            break;
+        }
+        done += ret;
+
+        /* skip the buffers already filled */
+        while (iovcnt > 0 && (size_t)ret >= iov->iov_len) {
+            ret -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t*)iov->iov_base + ret;
+            iov->iov_len -= ret;
+        }
+    }
+
+    return done;
+}
+
+static void push_done(struct fdio_queue* queue, struct fdio_request* req)
+{
+    req->next = NULL;
+    *queue->done_tail = req;
+    queue->done_tail = &req->next;
+    queue->inflight--;
+}
+
+static size_t pop_done(struct fdio_queue* queue, OFSL_DriveCompletion* comp, size_t max)
+{
+    size_t cnt = 0;
+
+    while (queue->done_head && cnt < max) {
+        struct fdio_request* req = queue->done_head;
+        queue->done_head = req->next;
+        comp[cnt++] = req->comp;
+        free(req);
+    }
+    if (!queue->done_head) {
+        queue->done_tail = &queue->done_head;
+    }
+
+    return cnt;
+}
+
+#ifdef USE_IO_URING
+static int uring_setup(struct uring* ring)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+    if (ring->fd < 0) {
+        return 1;
+    }
+
+    ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    /* both rings share a single mapping on newer kernels */
+    int single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        if (ring->cq_len > ring->sq_len) {
+            ring->sq_len = ring->cq_len;
+        }
+        ring->cq_len = ring->sq_len;
+    }
+
+    ring->sq_ptr = mmap(
+        NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        goto close_fd;
+    }
+
+    if (single_mmap) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(
+            NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            goto unmap_sq;
+        }
+    }
+
+    ring->sqes = mmap(
+        NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        goto unmap_cq;
+    }
+
+    uint8_t* sq_ptr = ring->sq_ptr;
+    uint8_t* cq_ptr = ring->cq_ptr;
+    ring->sq_tail = (unsigned*)(sq_ptr + params.sq_off.tail);
+    ring->sq_array = (unsigned*)(sq_ptr + params.sq_off.array);
+    ring->sq_mask = *(unsigned*)(sq_ptr + params.sq_off.ring_mask);
+    ring->cq_head = (unsigned*)(cq_ptr + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq_ptr + params.cq_off.tail);
+    ring->cq_mask = *(unsigned*)(cq_ptr + params.cq_off.ring_mask);
+    ring->cq_entries = params.cq_entries;
+    ring->cqes = (struct io_uring_cqe*)(cq_ptr + params.cq_off.cqes);
+
+    return 0;
+
+unmap_cq:
+    if (!single_mmap) {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+unmap_sq:
+    munmap(ring->sq_ptr, ring->sq_len);
+close_fd:
+    close(ring->fd);
+    return 1;
+}
+
+static void uring_teardown(struct uring* ring)
+{
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_len);
+    }
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+}
+
+static int uring_enter(struct uring* ring, unsigned to_submit, unsigned min_complete)
+{
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    int ret;
+
+    do {
+        ret = syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete, flags, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret;
+}
+
+/**
+ * @brief Move the entries of the completion ring to the done list
+ *
+ * @param queue queue object, must be locked
+ * @return size_t number of completions moved
+ */
+static size_t uring_collect(struct fdio_queue* queue)
+{
+    struct uring* ring = &queue->ring;
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    size_t cnt = 0;
+
+    for (; head != tail; head++, cnt++) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+        struct fdio_request* req = (struct fdio_request*)(uintptr_t)cqe->user_data;
+        req->comp.result = cqe->res < 0 ? -1 : (ssize_t)(cqe->res / queue->unit);
+        push_done(queue, req);
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    return cnt;
+}
+
+static int uring_submit(struct fdio_queue* queue, struct fdio_request* req)
+{
+    struct uring* ring = &queue->ring;
+
+    /* keep every completion of the requests in flight fit in the ring */
+    while (queue->inflight >= ring->cq_entries) {
+        if (uring_collect(queue) > 0) break;
+
+        pthread_mutex_unlock(&queue->lock);
+        int ret = uring_enter(ring, 0, 1);
+        pthread_mutex_lock(&queue->lock);
+        if (ret < 0) {
+            return 1;
+        }
+    }
+
+    /* requests are submitted one by one, so the queue is never full */
+    unsigned tail = *ring->sq_tail;
+    unsigned idx = tail & ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = req->is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe->fd = queue->fd;
+    sqe->addr = (uintptr_t)&req->iov;
+    sqe->len = 1;
+    sqe->off = req->offs;
+    sqe->user_data = (uintptr_t)req;
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    if (uring_enter(ring, 1, 0) != 1) {
+        /* the entry has not been consumed by the kernel, take it back */
+        __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+        return 1;
+    }
+
+    queue->inflight++;
+    return 0;
+}
+#endif
+
+static void* worker_main(void* arg)
+{
+    struct fdio_queue* queue = arg;
+
+    pthread_mutex_lock(&queue->lock);
+    while (!queue->stopping) {
+        struct fdio_request* req = queue->pending_head;
+        if (!req) {
+            pthread_cond_wait(&queue->pending_cond, &queue->lock);
+            continue;
+        }
+        queue->pending_head = req->next;
+        if (!queue->pending_head) {
+            queue->pending_tail = &queue->pending_head;
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        ssize_t done = fdio_transfer(queue->fd, &req->iov, 1, req->offs, req->is_write);
+        req->comp.result = done < 0 ? -1 : done / (ssize_t)queue->unit;
+
+        pthread_mutex_lock(&queue->lock);
+        push_done(queue, req);
+        pthread_cond_broadcast(&queue->done_cond);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return NULL;
+}
+
+static int pool_submit(struct fdio_queue* queue, struct fdio_request* req)
+{
+    while (queue->worker_count < WORKER_COUNT) {
+        if (pthread_create(
+                &queue->workers[queue->worker_count],
+                NULL,
+                worker_main,
+                queue)) {
+            break;
+        }
+        queue->worker_count++;
+    }
+    if (queue->worker_count == 0) {
+        return 1;
+    }
+
+    req->next = NULL;
+    *queue->pending_tail = req;
+    queue->pending_tail = &req->next;
+    queue->inflight++;
+    pthread_cond_signal(&queue->pending_cond);
+
+    return 0;
+}
+
+OFSL_HIDDEN
+struct fdio_queue* fdio_queue_create(int fd, size_t unit)
+{
+    struct fdio_queue* queue = malloc(sizeof(struct fdio_queue));
+    if (!queue) {
+        return NULL;
+    }
+
+    queue->fd = fd;
+    queue->unit = unit;
+    queue->inflight = 0;
+    queue->done_head = NULL;
+    queue->done_tail = &queue->done_head;
+    queue->pending_head = NULL;
+    queue->pending_tail = &queue->pending_head;
+    queue->worker_count = 0;
+    queue->stopping = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->done_cond, NULL);
+    pthread_cond_init(&queue->pending_cond, NULL);
+
+#ifdef USE_IO_URING
+    /* io_uring may be unavailable in runtime, e.g. disabled by sysctl */
+    queue->use_uring = !uring_setup(&queue->ring);
+#endif
+
+    return queue;
+}
+
+OFSL_HIDDEN
+int fdio_queue_submit(struct fdio_queue* queue, void* buf, size_t len, off_t offs, int is_write, uint64_t tag)
+{
+    struct fdio_request* req = malloc(sizeof(struct fdio_request));
+    if (!req) {
+        return 1;
+    }
+
+    req->iov.iov_base = buf;
+    req->iov.iov_len = len;
+    req->offs = offs;
+    req->is_write = is_write;
+    req->comp.tag = tag;
+    req->comp.result = 0;
+
+    pthread_mutex_lock(&queue->lock);
+    int ret;
+#ifdef USE_IO_URING
+    if (queue->use_uring) {
+        ret = uring_submit(queue, req);
+    } else
+#endif
+    {
+        ret = pool_submit(queue, req);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    if (ret) {
+        free(req);
+    }
+    return ret;
+}
+
+OFSL_HIDDEN
+ssize_t fdio_queue_reap(struct fdio_queue* queue, OFSL_DriveCompletion* comp, size_t max, size_t min)
+{
+    size_t cnt = 0;
+
+    if (min > max) {
+        min = max;
+    }
+
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+#ifdef USE_IO_URING
+        if (queue->use_uring) {
+            uring_collect(queue);
+        }
+#endif
+        cnt += pop_done(queue, comp + cnt, max - cnt);
+        if (cnt >= min || queue->inflight == 0) {
+            break;
+        }
+
+#ifdef USE_IO_URING
+        if (queue->use_uring) {
+            pthread_mutex_unlock(&queue->lock);
+            int ret = uring_enter(&queue->ring, 0, 1);
+            pthread_mutex_lock(&queue->lock);
+            if (ret < 0) {
+                break;
+            }
+            continue;
+        }
+#endif
+        pthread_cond_wait(&queue->done_cond, &queue->lock);
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return cnt;
+}
+
+OFSL_HIDDEN
+void fdio_queue_delete(struct fdio_queue* queue)
+{
+    pthread_mutex_lock(&queue->lock);
+    queue->stopping = 1;
+    pthread_cond_broadcast(&queue->pending_cond);
+    pthread_mutex_unlock(&queue->lock);
+
+    for (int i = 0; i < queue->worker_count; i++) {
+        pthread_join(queue->workers[i], NULL);
+    }
+
+#ifdef USE_IO_URING
+    if (queue->use_uring) {
+        /* the kernel may still write into the buffers of requests in flight */
+        pthread_mutex_lock(&queue->lock);
+        while (queue->inflight > 0) {
+            if (uring_collect(queue) > 0) continue;
+
+            pthread_mutex_unlock(&queue->lock);
+            int ret = uring_enter(&queue->ring, 0, 1);
+            pthread_mutex_lock(&queue->lock);
+            if (ret < 0) {
+                break;
+            }
+        }
+        pthread_mutex_unlock(&queue->lock);
+        uring_teardown(&queue->ring);
+    }
+#endif
+
+    struct fdio_request* req;
+    while ((req = queue->pending_head)) {
+        queue->pending_head = req->next;
+        free(req);
+    }
+    while ((req = queue->done_head)) {
+        queue->done_head = req->next;
+        free(req);
+    }
+
+    pthread_cond_destroy(&queue->pending_cond);
+    pthread_cond_destroy(&queue->done_cond);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue);
+}
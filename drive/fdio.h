@@ -0,0 +1,88 @@
+#ifndef DRIVE_FDIO_H__
+#define DRIVE_FDIO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <ofsl/drive/drive.h>
+
+#include "config.h"
+#include "export.h"
+
+struct fdio_queue;
+
+/**
+ * @brief Transfer the given ranges of a file entirely
+ *
+ * @param fd file descriptor
+ * @param iov buffer list, modified while the transfer proceeds
+ * @param iovcnt number of buffers
+ * @param offs byte offset in the file
+ * @param is_write write to the file if nonzero, otherwise read from it
+ * @return ssize_t number of bytes transferred, -1 if nothing was transferred
+ * because of an error
+ *
+ * @details
+ *  preadv(2) and pwritev(2) are allowed to transfer less than requested even
+ * if the range is valid, so the call is repeated until the whole range is
+ * transferred, the end of the file is reached or an error other than EINTR
+ * occurs.
+ */
+ssize_t fdio_transfer(int fd, struct iovec* iov, int iovcnt, off_t offs, int is_write);
+
+/**
+ * @brief Create an asynchronous request queue on a file
+ *
+ * @param fd file descriptor, not owned by the queue
+ * @param unit size of the unit the completion results are counted in
+ * @return struct fdio_queue* queue object, NULL if failed
+ *
+ * @details
+ *  Requests are submitted through io_uring if the kernel supports it.
+ * Otherwise they are processed by a small pool of worker threads which is
+ * started on the first request.
+ */
+struct fdio_queue* fdio_queue_create(int fd, size_t unit);
+
+/**
+ * @brief Queue a transfer of a single buffer
+ *
+ * @param queue queue object
+ * @param buf data buffer, must stay valid until the completion is reaped
+ * @param len length of the transfer in bytes
+ * @param offs byte offset in the file
+ * @param is_write write to the file if nonzero, otherwise read from it
+ * @param tag value reported back in the completion
+ * @return int 0 if queued, nonzero otherwise
+ */
+int fdio_queue_submit(struct fdio_queue* queue, void* buf, size_t len, off_t offs, int is_write, uint64_t tag);
+
+/**
+ * @brief Collect the completions of the queued transfers
+ *
+ * @param queue queue object
+ * @param comp completion array
+ * @param max maximum number of completions to store in comp
+ * @param min number of completions to wait for
+ * @return ssize_t number of completions stored, negative if failed
+ *
+ * @details
+ *  Waiting stops early if no transfer is in flight any more.
+ */
+ssize_t fdio_queue_reap(struct fdio_queue* queue, OFSL_DriveCompletion* comp, size_t max, size_t min);
+
+/**
+ * @brief Delete the queue
+ *
+ * @param queue queue object
+ *
+ * @details
+ *  Every submitted transfer should be reaped before deleting the queue. The
+ * transfers still in flight are waited for, and their completions are
+ * discarded.
+ */
+void fdio_queue_delete(struct fdio_queue* queue);
+
+#endif
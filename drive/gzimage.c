@@ -0,0 +1,611 @@
+#include <ofsl/drive/gzimage.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "config.h"
+#include "endian.h"
+#include "export.h"
+
+#ifdef USE_ZLIB
+
+#include <zlib.h>
+
+#define SPAN            (1 << 20)   /* minimum distance between access points */
+#define WINSIZE         32768       /* size of the deflate history */
+#define INBUF_SIZE      16384
+#define CACHE_SPANS     4           /* number of spans kept decompressed */
+
+#define INDEX_MAGIC     "OFSLGZX1"
+
+struct access_point {
+    uint64_t out;       /* offset in the decompressed image */
+    uint64_t in;        /* offset in the compressed file of the next full byte */
+    int bits;           /* number of bits of the byte before `in` not consumed */
+    uint8_t window[WINSIZE];
+};
+
+struct cached_span {
+    size_t point;       /* index of the access point starting the span */
+    uint64_t last_use;
+    uint8_t* data;      /* NULL if the entry is unused */
+};
+
+struct drive_gzimage {
+    OFSL_Drive drv;
+    int fd;
+    pthread_mutex_t lock;
+    uint64_t size;      /* size of the decompressed image */
+    size_t point_cnt;
+    struct access_point* points;
+    uint64_t clock;
+    struct cached_span cache[CACHE_SPANS];
+};
+
+/**
+ * @brief Append an access point to the index
+ *
+ * @param drv drive object struct
+ * @param cap capacity of the point array, updated if grown
+ * @param in offset in the compressed file
+ * @param out offset in the decompressed image
+ * @param bits number of bits of the byte before `in` not consumed
+ * @param window circular buffer of the last decompressed data
+ * @param left number of bytes not filled yet in the circular buffer
+ * @return int 0 if succeed, nonzero otherwise
+ */
+static int
+add_point(
+    struct drive_gzimage* drv,
+    size_t* cap,
+    uint64_t in,
+    uint64_t out,
+    int bits,
+    const uint8_t* window,
+    size_t left)
+{
+    if (drv->point_cnt == *cap) {
+        size_t new_cap = *cap ? *cap * 2 : 16;
+        struct access_point* points =
+            realloc(drv->points, new_cap * sizeof(struct access_point));
+        if (!points) {
+            return 1;
+        }
+        drv->points = points;
+        *cap = new_cap;
+    }
+
+    struct access_point* pt = &drv->points[drv->point_cnt++];
+    pt->out = out;
+    pt->in = in;
+    pt->bits = bits;
+
+    /* oldest data first */
+    memcpy(pt->window, window + WINSIZE - left, left);
+    memcpy(pt->window + left, window, WINSIZE - left);
+
+    return 0;
+}
+
+/**
+ * @brief Decompress the whole image once to build the index
+ *
+ * @param drv drive object struct
+ * @return int 0 if succeed, nonzero otherwise
+ *
+ * @details
+ *  Access points are put on deflate block boundaries, at least SPAN bytes of
+ * decompressed data apart. The first one is at the start of the compressed
+ * data, right after the gzip header.
+ */
+static int build_index(struct drive_gzimage* drv)
+{
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    /* gzip header expected */
+    if (inflateInit2(&strm, 15 + 16) != Z_OK) {
+        return 1;
+    }
+
+    uint8_t* inbuf = malloc(INBUF_SIZE);
+    uint8_t* window = calloc(1, WINSIZE);
+    if (!inbuf || !window) {
+        goto fail;
+    }
+
+    size_t cap = 0;
+    uint64_t totin = 0, totout = 0, last = 0;
+    off_t offs = 0;
+    int ret = Z_OK;
+    strm.avail_out = 0;
+
+    do {
+        if (strm.avail_in == 0) {
+            ssize_t n = pread(drv->fd, inbuf, INBUF_SIZE, offs);
+            if (n <= 0) {
+                /* truncated */
+                goto fail;
+            }
+            offs += n;
+            strm.next_in = inbuf;
+            strm.avail_in = n;
+        }
+
+        do {
+            if (strm.avail_out == 0) {
+                strm.next_out = window;
+                strm.avail_out = WINSIZE;
+            }
+
+            totin += strm.avail_in;
+            totout += strm.avail_out;
+            ret = inflate(&strm, Z_BLOCK);
+            totin -= strm.avail_in;
+            totout -= strm.avail_out;
+
+            if (ret != Z_OK && ret != Z_STREAM_END) {
+                goto fail;
+            }
+            if (ret == Z_STREAM_END) {
+                break;
+            }
+
+            /* at the end of a block which is not the last one */
+            if ((strm.data_type & 128) && !(strm.data_type & 64) &&
+                (totout == 0 || totout - last > SPAN)) {
+                if (add_point(
+                        drv,
+                        &cap,
+                        totin,
+                        totout,
+                        strm.data_type & 7,
+                        window,
+                        strm.avail_out)) {
+                    goto fail;
+                }
+                last = totout;
+            }
+        } while (strm.avail_in != 0);
+    } while (ret != Z_STREAM_END);
+
+    drv->size = totout;
+
+    inflateEnd(&strm);
+    free(window);
+    free(inbuf);
+    return drv->point_cnt == 0;
+
+fail:
+    inflateEnd(&strm);
+    free(window);
+    free(inbuf);
+    free(drv->points);
+    drv->points = NULL;
+    drv->point_cnt = 0;
+    return 1;
+}
+
+/**
+ * @brief Load the index from a file
+ *
+ * @param drv drive object struct
+ * @param index_name path of the index file
+ * @param st status of the compressed file
+ * @return int 0 if succeed, nonzero if the index should be built
+ *
+ * @details
+ *  An index file starts with the magic, the size and the modification time of
+ * the compressed file, the size of the image and the number of points, each
+ * as 64-bit little endian integer. Every point follows as its decompressed
+ * offset, compressed offset and bit count, then its window. The first point
+ * must be at offset 0 and the decompressed offsets must strictly increase.
+ */
+static int load_index(struct drive_gzimage* drv, const char* index_name, const struct stat* st)
+{
+    FILE* fp = fopen(index_name, "rb");
+    if (!fp) {
+        return 1;
+    }
+
+    char magic[8];
+    uint64_t hdr[4];
+    if (fread(magic, sizeof(magic), 1, fp) != 1 ||
+        memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0 ||
+        fread(hdr, sizeof(hdr), 1, fp) != 1) {
+        goto fail;
+    }
+
+    const uint64_t point_cnt = htole64(hdr[3]);
+    if (htole64(hdr[0]) != (uint64_t)st->st_size ||
+        htole64(hdr[1]) != (uint64_t)st->st_mtime ||
+        point_cnt == 0 ||
+        point_cnt > (uint64_t)st->st_size) {
+        goto fail;
+    }
+
+    drv->size = htole64(hdr[2]);
+    drv->points = malloc(point_cnt * sizeof(struct access_point));
+    if (!drv->points) {
+        goto fail;
+    }
+
+    for (size_t i = 0; i < point_cnt; i++) {
+        struct access_point* pt = &drv->points[i];
+        uint64_t rec[3];
+        if (fread(rec, sizeof(rec), 1, fp) != 1 ||
+            fread(pt->window, WINSIZE, 1, fp) != 1) {
+            goto fail;
+        }
+
+        pt->out = htole64(rec[0]);
+        pt->in = htole64(rec[1]);
+        pt->bits = htole64(rec[2]);
+        if (pt->in > (uint64_t)st->st_size ||
+            pt->out > drv->size ||
+            pt->bits > 7 ||
+            (i == 0 && pt->out != 0) ||
+            (i > 0 && pt->out <= drv->points[i - 1].out)) {
+            goto fail;
+        }
+    }
+
+    drv->point_cnt = point_cnt;
+
+    fclose(fp);
+    return 0;
+
+fail:
+    free(drv->points);
+    drv->points = NULL;
+    fclose(fp);
+    return 1;
+}
+
+/**
+ * @brief Write the index to a file
+ *
+ * @param drv drive object struct
+ * @param index_name path of the index file
+ * @param st status of the compressed file
+ */
+static void save_index(struct drive_gzimage* drv, const char* index_name, const struct stat* st)
+{
+    FILE* fp = fopen(index_name, "wb");
+    if (!fp) {
+        return;
+    }
+
+    const uint64_t hdr[4] = {
+        htole64((uint64_t)st->st_size),
+        htole64((uint64_t)st->st_mtime),
+        htole64(drv->size),
+        htole64((uint64_t)drv->point_cnt),
+    };
+    int err = fwrite(INDEX_MAGIC, 8, 1, fp) != 1 ||
+              fwrite(hdr, sizeof(hdr), 1, fp) != 1;
+
+    for (size_t i = 0; !err && i < drv->point_cnt; i++) {
+        const struct access_point* pt = &drv->points[i];
+        const uint64_t rec[3] = {
+            htole64(pt->out),
+            htole64(pt->in),
+            htole64((uint64_t)pt->bits),
+        };
+        err = fwrite(rec, sizeof(rec), 1, fp) != 1 ||
+              fwrite(pt->window, WINSIZE, 1, fp) != 1;
+    }
+
+    if (fclose(fp) || err) {
+        /* do not leave a truncated index */
+        remove(index_name);
+    }
+}
+
+static size_t span_length(struct drive_gzimage* drv, size_t idx)
+{
+    const uint64_t end =
+        idx + 1 < drv->point_cnt ? drv->points[idx + 1].out : drv->size;
+    return end - drv->points[idx].out;
+}
+
+/**
+ * @brief Decompress the span of the image starting at an access point
+ *
+ * @param drv drive object struct
+ * @param idx index of the access point
+ * @param out output buffer, as large as the span
+ * @return int 0 if succeed, nonzero otherwise
+ */
+static int inflate_span(struct drive_gzimage* drv, size_t idx, uint8_t* out)
+{
+    const struct access_point* pt = &drv->points[idx];
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    /* raw deflate from the middle of the stream */
+    if (inflateInit2(&strm, -15) != Z_OK) {
+        return 1;
+    }
+
+    uint8_t* inbuf = malloc(INBUF_SIZE);
+    if (!inbuf) {
+        goto fail;
+    }
+
+    off_t offs = pt->in;
+    if (pt->bits) {
+        uint8_t byte;
+        if (pread(drv->fd, &byte, 1, offs - 1) != 1) {
+            goto fail;
+        }
+        inflatePrime(&strm, pt->bits, byte >> (8 - pt->bits));
+    }
+
+    const size_t dict_len = pt->out < WINSIZE ? pt->out : WINSIZE;
+    if (dict_len) {
+        inflateSetDictionary(&strm, pt->window + WINSIZE - dict_len, dict_len);
+    }
+
+    strm.next_out = out;
+    strm.avail_out = span_length(drv, idx);
+    while (strm.avail_out) {
+        if (strm.avail_in == 0) {
+            ssize_t n = pread(drv->fd, inbuf, INBUF_SIZE, offs);
+            if (n <= 0) {
+                goto fail;
+            }
+            offs += n;
+            strm.next_in = inbuf;
+            strm.avail_in = n;
+        }
+
+        int ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            break;
+        } else if (ret != Z_OK) {
+            goto fail;
+        }
+    }
+
+    inflateEnd(&strm);
+    free(inbuf);
+    return strm.avail_out != 0;
+
+fail:
+    inflateEnd(&strm);
+    free(inbuf);
+    return 1;
+}
+
+/**
+ * @brief Get the decompressed span starting at an access point
+ *
+ * @param drv drive object struct
+ * @param idx index of the access point
+ * @return const uint8_t* decompressed data, NULL if failed
+ *
+ * @details
+ *  The least recently used span is replaced if the span is not cached.
+ */
+static const uint8_t* get_span(struct drive_gzimage* drv, size_t idx)
+{
+    struct cached_span* victim = &drv->cache[0];
+
+    for (int i = 0; i < CACHE_SPANS; i++) {
+        struct cached_span* span = &drv->cache[i];
+        if (span->data && span->point == idx) {
+            span->last_use = ++drv->clock;
+            return span->data;
+        }
+        if (!span->data || (victim->data && span->last_use < victim->last_use)) {
+            victim = span;
+        }
+    }
+
+    uint8_t* data = realloc(victim->data, span_length(drv, idx));
+    if (!data) {
+        return NULL;
+    }
+    victim->data = data;
+
+    if (inflate_span(drv, idx, data)) {
+        free(victim->data);
+        victim->data = NULL;
+        return NULL;
+    }
+
+    victim->point = idx;
+    victim->last_use = ++drv->clock;
+    return data;
+}
+
+/**
+ * @brief Find the access point of the span holding an offset of the image
+ *
+ * @param drv drive object struct
+ * @param offs offset in the decompressed image
+ * @return size_t index of the access point
+ */
+static size_t find_point(struct drive_gzimage* drv, uint64_t offs)
+{
+    size_t lo = 0, hi = drv->point_cnt;
+
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (drv->points[mid].out <= offs) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/**
+ * @brief Copy a byte range of the decompressed image
+ *
+ * @param drv drive object struct
+ * @param buf destination buffer
+ * @param offs offset in the decompressed image
+ * @param len number of bytes, within the image
+ * @return int 0 if succeed, nonzero otherwise
+ */
+static int read_bytes(struct drive_gzimage* drv, uint8_t* buf, uint64_t offs, size_t len)
+{
+    while (len > 0) {
+        size_t idx = find_point(drv, offs);
+        const uint8_t* span = get_span(drv, idx);
+        if (!span) {
+            return 1;
+        }
+
+        const size_t span_offs = offs - drv->points[idx].out;
+        size_t n = span_length(drv, idx) - span_offs;
+        if (n > len) {
+            n = len;
+        }
+
+        memcpy(buf, span + span_offs, n);
+        buf += n;
+        offs += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+static int update_info(OFSL_Drive* drv_opaque)
+{
+    return 0;
+}
+
+static ssize_t read_sector(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_gzimage* drv = (struct drive_gzimage*)drv_opaque;
+    const uint16_t img_sector_size = drv->drv.drvinfo.sector_size;
+
+    if (sector_size > img_sector_size) {
+        return 0;
+    }
+
+    if (lba > drv->drv.drvinfo.lba_max) {
+        return 0;
+    }
+    lba_t avail = drv->drv.drvinfo.lba_max - lba + 1;
+    cnt = cnt < avail ? cnt : avail;
+
+    pthread_mutex_lock(&drv->lock);
+
+    ssize_t done = 0;
+    uint8_t* bbuf = buf;
+    if (sector_size == img_sector_size) {
+        if (!read_bytes(drv, bbuf, lba * img_sector_size, cnt * sector_size)) {
+            done = cnt;
+        }
+    } else {
+        for (; done < (ssize_t)cnt; done++) {
+            if (read_bytes(drv, bbuf, (lba + done) * img_sector_size, sector_size)) {
+                break;
+            }
+            bbuf += sector_size;
+        }
+    }
+
+    pthread_mutex_unlock(&drv->lock);
+
+    return done;
+}
+
+static ssize_t write_sector(OFSL_Drive* drv_opaque, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    return 0;
+}
+
+static void _delete(OFSL_Drive* drv_opaque)
+{
+    struct drive_gzimage* drv = (struct drive_gzimage*)drv_opaque;
+
+    for (int i = 0; i < CACHE_SPANS; i++) {
+        free(drv->cache[i].data);
+    }
+    pthread_mutex_destroy(&drv->lock);
+    free(drv->points);
+    close(drv->fd);
+    free(drv);
+}
+
+OFSL_EXPORT
+OFSL_Drive* ofsl_drive_gzimage_create(const char* name, const char* index_name, size_t sector_size)
+{
+    static const struct ofsl_drive_ops drvops = {
+        ._delete = _delete,
+        .update_info = update_info,
+        .read_sector = read_sector,
+        .write_sector = write_sector,
+    };
+
+    if (sector_size == 0) {
+        return NULL;
+    }
+
+    int fd = open(name, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st)) {
+        close(fd);
+        return NULL;
+    }
+
+    struct drive_gzimage* drv = calloc(1, sizeof(struct drive_gzimage));
+    if (!drv) {
+        close(fd);
+        return NULL;
+    }
+    drv->fd = fd;
+
+    if (!index_name || load_index(drv, index_name, &st)) {
+        if (build_index(drv)) {
+            close(fd);
+            free(drv);
+            return NULL;
+        }
+        if (index_name) {
+            save_index(drv, index_name, &st);
+        }
+    }
+
+    if (drv->size < sector_size || drv->size % sector_size != 0) {
+        free(drv->points);
+        close(fd);
+        free(drv);
+        return NULL;
+    }
+
+    drv->drv.ops = &drvops;
+    drv->drv.drvinfo.sector_size = sector_size;
+    drv->drv.drvinfo.lba_max = drv->size / sector_size - 1;
+    drv->drv.drvinfo.readonly = 1;
+    drv->drv.drvinfo.buf_align = 0;
+    pthread_mutex_init(&drv->lock, NULL);
+
+    return (OFSL_Drive*)drv;
+}
+
+#else
+
+OFSL_EXPORT
+OFSL_Drive* ofsl_drive_gzimage_create(const char* name, const char* index_name, size_t sector_size)
+{
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef DRIVE_INTERNAL_H__
+#define DRIVE_INTERNAL_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <ofsl/drive/drive.h>
+
+#include "config.h"
+#include "export.h"
+
+/**
+ * @brief Clamp a sector count to the end of the drive
+ *
+ * @param drv drive object
+ * @param lba LBA address of the first sector
+ * @param cnt requested sector count
+ * @return size_t number of sectors available from the given lba
+ */
+size_t drive_clamp_count(const OFSL_Drive* drv, lba_t lba, size_t cnt);
+
+/**
+ * @brief Read sectors of a drive whose whole contents are in memory
+ *
+ * @param drv drive object
+ * @param data contents of the drive
+ * @param buf destination buffer
+ * @param lba LBA address of the first sector
+ * @param sector_size sector size of the request, at most the one of the drive
+ * @param cnt number of sectors
+ * @return ssize_t number of sectors read
+ *
+ * @details
+ *  With a smaller sector size, each sector is the head of the drive sector at
+ * the same LBA address.
+ */
+ssize_t drive_mem_read(const OFSL_Drive* drv, const uint8_t* data, void* buf, lba_t lba, size_t sector_size, size_t cnt);
+
+/**
+ * @brief Write sectors of a drive whose whole contents are in memory
+ *
+ * @param drv drive object
+ * @param data contents of the drive
+ * @param buf source buffer
+ * @param lba LBA address of the first sector
+ * @param sector_size sector size of the request, at most the one of the drive
+ * @param cnt number of sectors
+ * @return ssize_t number of sectors written, 0 if the drive is read only
+ */
+ssize_t drive_mem_write(const OFSL_Drive* drv, uint8_t* data, const void* buf, lba_t lba, size_t sector_size, size_t cnt);
+
+/**
+ * @brief Map sectors of a drive whose whole contents are in memory
+ *
+ * @param drv drive object
+ * @param data contents of the drive
+ * @param lba LBA address of the first sector
+ * @param cnt number of sectors
+ * @return const void* data of the sectors, NULL if out of range
+ */
+const void* drive_mem_map(const OFSL_Drive* drv, const uint8_t* data, lba_t lba, size_t cnt);
+
+#endif
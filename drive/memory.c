@@ -0,0 +1,104 @@
+#include <ofsl/drive/memory.h>
+
+#include <stdlib.h>
+
+#include "export.h"
+#include "drive/internal.h"
+
+struct drive_memory {
+    OFSL_Drive drv;
+    uint8_t* data;
+    int owned;      /* data is freed with the drive */
+};
+
+static int update_info(OFSL_Drive* drv_opaque)
+{
+    return 0;
+}
+
+static ssize_t read_sector(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_memory* drv = (struct drive_memory*)drv_opaque;
+    return drive_mem_read(&drv->drv, drv->data, buf, lba, sector_size, cnt);
+}
+
+static ssize_t write_sector(OFSL_Drive* drv_opaque, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_memory* drv = (struct drive_memory*)drv_opaque;
+    return drive_mem_write(&drv->drv, drv->data, buf, lba, sector_size, cnt);
+}
+
+static const void* map_sector(OFSL_Drive* drv_opaque, lba_t lba, size_t cnt)
+{
+    struct drive_memory* drv = (struct drive_memory*)drv_opaque;
+    return drive_mem_map(&drv->drv, drv->data, lba, cnt);
+}
+
+static void _delete(OFSL_Drive* drv_opaque)
+{
+    struct drive_memory* drv = (struct drive_memory*)drv_opaque;
+
+    if (drv->owned) {
+        free(drv->data);
+    }
+    free(drv);
+}
+
+static const struct ofsl_drive_ops drvops = {
+    ._delete = _delete,
+    .update_info = update_info,
+    .read_sector = read_sector,
+    .write_sector = write_sector,
+    .map_sector = map_sector,
+};
+
+static struct drive_memory*
+create_drive(uint8_t* data, size_t len, int readonly, size_t sector_size)
+{
+    struct drive_memory* drv = malloc(sizeof(struct drive_memory));
+    if (!drv) {
+        return NULL;
+    }
+
+    drv->drv.ops = &drvops;
+    drv->drv.drvinfo.sector_size = sector_size;
+    drv->drv.drvinfo.lba_max = len / sector_size - 1;
+    drv->drv.drvinfo.readonly = readonly;
+    drv->drv.drvinfo.buf_align = 0;
+    drv->data = data;
+    drv->owned = 0;
+
+    return drv;
+}
+
+OFSL_EXPORT
+OFSL_Drive* ofsl_drive_memory_create(size_t size, size_t sector_size)
+{
+    if (sector_size == 0 || size == 0 || size % sector_size != 0) {
+        return NULL;
+    }
+
+    uint8_t* data = calloc(1, size);
+    if (!data) {
+        return NULL;
+    }
+
+    struct drive_memory* drv = create_drive(data, size, 0, sector_size);
+    if (!drv) {
+        free(data);
+        return NULL;
+    }
+    drv->owned = 1;
+
+    return (OFSL_Drive*)drv;
+}
+
+OFSL_EXPORT
+OFSL_Drive* ofsl_drive_memory_from_buffer(void* buf, size_t len, int readonly, size_t sector_size)
+{
+    if (!buf || sector_size == 0 || len == 0 || len % sector_size != 0) {
+        return NULL;
+    }
+
+    return (OFSL_Drive*)create_drive(buf, len, readonly, sector_size);
+}
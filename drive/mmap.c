@@ -0,0 +1,110 @@
+#include <ofsl/drive/mmap.h>
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "export.h"
+#include "drive/internal.h"
+
+struct drive_mmap {
+    OFSL_Drive drv;
+    int fd;
+    uint8_t* map;
+    size_t map_size;
+};
+
+static int update_info(OFSL_Drive* drv_opaque)
+{
+    return 0;
+}
+
+static ssize_t read_sector(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_mmap* drv = (struct drive_mmap*)drv_opaque;
+    return drive_mem_read(&drv->drv, drv->map, buf, lba, sector_size, cnt);
+}
+
+static ssize_t write_sector(OFSL_Drive* drv_opaque, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_mmap* drv = (struct drive_mmap*)drv_opaque;
+    return drive_mem_write(&drv->drv, drv->map, buf, lba, sector_size, cnt);
+}
+
+static const void* map_sector(OFSL_Drive* drv_opaque, lba_t lba, size_t cnt)
+{
+    struct drive_mmap* drv = (struct drive_mmap*)drv_opaque;
+    return drive_mem_map(&drv->drv, drv->map, lba, cnt);
+}
+
+static int flush(OFSL_Drive* drv_opaque)
+{
+    struct drive_mmap* drv = (struct drive_mmap*)drv_opaque;
+
+    if (drv->drv.drvinfo.readonly) {
+        return 0;
+    }
+
+    return msync(drv->map, drv->map_size, MS_SYNC) != 0;
+}
+
+static void _delete(OFSL_Drive* drv_opaque)
+{
+    struct drive_mmap* drv = (struct drive_mmap*)drv_opaque;
+
+    munmap(drv->map, drv->map_size);
+    close(drv->fd);
+    free(drv);
+}
+
+OFSL_EXPORT
+OFSL_Drive* ofsl_drive_mmap_create(const char* name, int readonly, size_t sector_size)
+{
+    static const struct ofsl_drive_ops drvops = {
+        ._delete = _delete,
+        .update_info = update_info,
+        .read_sector = read_sector,
+        .write_sector = write_sector,
+        .map_sector = map_sector,
+        .flush = flush,
+    };
+
+    int fd = open(name, readonly ? O_RDONLY : O_RDWR);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) ||
+        st.st_size == 0 ||
+        st.st_size % sector_size != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(
+        NULL,
+        st.st_size,
+        readonly ? PROT_READ : PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        fd,
+        0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    struct drive_mmap* drv = malloc(sizeof(struct drive_mmap));
+    drv->drv.ops = &drvops;
+    drv->drv.drvinfo.sector_size = sector_size;
+    drv->drv.drvinfo.lba_max = st.st_size / sector_size - 1;
+    drv->drv.drvinfo.readonly = readonly;
+    drv->drv.drvinfo.buf_align = 0;
+    drv->fd = fd;
+    drv->map = map;
+    drv->map_size = st.st_size;
+
+    return (OFSL_Drive*)drv;
+}
@@ -0,0 +1,396 @@
+#include <ofsl/drive/overlay.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "endian.h"
+#include "export.h"
+#include "drive/fdio.h"
+#include "drive/internal.h"
+
+#define HEADER_SIZE     4096    /* the bitmap and the data area are aligned to it */
+#define OVERLAY_MAGIC   "OFSLCOW1"
+
+struct overlay_header {
+    char magic[8];
+    uint32_t sector_size;
+    uint32_t block_sectors;
+    uint64_t sector_cnt;
+};
+
+struct drive_overlay {
+    OFSL_Drive drv;
+    OFSL_Drive* base;
+    int fd;
+    pthread_mutex_t lock;
+    size_t block_sectors;
+    uint64_t block_cnt;
+    off_t data_offs;    /* offset of the data area in the overlay file */
+    uint8_t* bitmap;    /* copied blocks */
+    size_t bitmap_len;
+};
+
+static int is_copied(struct drive_overlay* drv, uint64_t block)
+{
+    return (drv->bitmap[block / 8] >> (block % 8)) & 1;
+}
+
+static size_t transfer_file(struct drive_overlay* drv, void* buf, size_t len, off_t offs, int is_write)
+{
+    struct iovec iov = { .iov_base = buf, .iov_len = len };
+    ssize_t ret = fdio_transfer(drv->fd, &iov, 1, offs, is_write);
+    return ret < 0 ? 0 : ret;
+}
+
+/**
+ * @brief Get the LBA address past the end of a block
+ *
+ * @param drv drive object struct
+ * @param block block index
+ * @return lba_t LBA address of the next block, or past the drive if the block
+ *         is the last one
+ */
+static lba_t block_end(struct drive_overlay* drv, uint64_t block)
+{
+    lba_t end = (block + 1) * drv->block_sectors;
+    lba_t sector_cnt = drv->drv.drvinfo.lba_max + 1;
+    return end < sector_cnt ? end : sector_cnt;
+}
+
+/**
+ * @brief Mark blocks as copied in the overlay file
+ *
+ * @param drv drive object struct
+ * @param first first block index
+ * @param last last block index
+ * @return int 0 if succeed, nonzero otherwise
+ */
+static int mark_copied(struct drive_overlay* drv, uint64_t first, uint64_t last)
+{
+    int changed = 0;
+    for (uint64_t block = first; block <= last; block++) {
+        if (!is_copied(drv, block)) {
+            drv->bitmap[block / 8] |= 1 << (block % 8);
+            changed = 1;
+        }
+    }
+
+    if (!changed) {
+        return 0;
+    }
+
+    const size_t len = last / 8 - first / 8 + 1;
+    return transfer_file(
+        drv,
+        drv->bitmap + first / 8,
+        len,
+        HEADER_SIZE + first / 8,
+        1) != len;
+}
+
+/**
+ * @brief Write the part of a block not copied yet along with its base data
+ *
+ * @param drv drive object struct
+ * @param buf data of the written sectors
+ * @param lba LBA address of the first written sector
+ * @param cnt number of written sectors, within the block
+ * @return int 0 if succeed, nonzero otherwise
+ */
+static int copy_block(struct drive_overlay* drv, const uint8_t* buf, lba_t lba, size_t cnt)
+{
+    const size_t sector_size = drv->drv.drvinfo.sector_size;
+    const uint64_t block = lba / drv->block_sectors;
+    const lba_t start = block * drv->block_sectors;
+    const size_t block_cnt = block_end(drv, block) - start;
+
+    uint8_t* bbuf = malloc(block_cnt * sector_size);
+    if (!bbuf) {
+        return 1;
+    }
+
+    int ret = ofsl_drive_read_sector(drv->base, bbuf, start, sector_size, block_cnt) != (ssize_t)block_cnt;
+    if (!ret) {
+        memcpy(bbuf + (lba - start) * sector_size, buf, cnt * sector_size);
+        ret = transfer_file(
+            drv,
+            bbuf,
+            block_cnt * sector_size,
+            drv->data_offs + start * sector_size,
+            1) != block_cnt * sector_size;
+    }
+
+    free(bbuf);
+    return ret;
+}
+
+static int update_info(OFSL_Drive* drv_opaque)
+{
+    return 0;
+}
+
+static ssize_t read_sector(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_overlay* drv = (struct drive_overlay*)drv_opaque;
+
+    if (sector_size != drv->drv.drvinfo.sector_size) {
+        return 0;
+    }
+
+    cnt = drive_clamp_count(&drv->drv, lba, cnt);
+    const lba_t lba_end = lba + cnt;
+
+    pthread_mutex_lock(&drv->lock);
+
+    uint8_t* bbuf = buf;
+    size_t done = 0;
+    while (done < cnt) {
+        const lba_t cur = lba + done;
+        uint64_t block = cur / drv->block_sectors;
+        const int copied = is_copied(drv, block);
+
+        /* run of blocks from the same source */
+        lba_t end = block_end(drv, block);
+        while (end < lba_end && is_copied(drv, ++block) == copied) {
+            end = block_end(drv, block);
+        }
+        if (end > lba_end) {
+            end = lba_end;
+        }
+
+        const size_t n = end - cur;
+        size_t ret;
+        if (copied) {
+            ret = transfer_file(
+                drv,
+                bbuf + done * sector_size,
+                n * sector_size,
+                drv->data_offs + cur * sector_size,
+                0) / sector_size;
+        } else {
+            ssize_t base_ret = ofsl_drive_read_sector(
+                drv->base,
+                bbuf + done * sector_size,
+                cur,
+                sector_size,
+                n);
+            ret = base_ret > 0 ? base_ret : 0;
+        }
+
+        done += ret;
+        if (ret < n) {
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&drv->lock);
+
+    return done;
+}
+
+static ssize_t write_sector(OFSL_Drive* drv_opaque, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_overlay* drv = (struct drive_overlay*)drv_opaque;
+
+    if (sector_size != drv->drv.drvinfo.sector_size) {
+        return 0;
+    }
+
+    cnt = drive_clamp_count(&drv->drv, lba, cnt);
+    const lba_t lba_end = lba + cnt;
+
+    pthread_mutex_lock(&drv->lock);
+
+    const uint8_t* bbuf = buf;
+    size_t done = 0;
+    while (done < cnt) {
+        const lba_t cur = lba + done;
+        const uint64_t first = cur / drv->block_sectors;
+        uint64_t block = first;
+        lba_t end = block_end(drv, block);
+
+        if (!is_copied(drv, block) &&
+            (cur != block * drv->block_sectors || end > lba_end)) {
+            /* partial write to a block of the base */
+            if (end > lba_end) {
+                end = lba_end;
+            }
+            if (copy_block(drv, bbuf + done * sector_size, cur, end - cur)) {
+                break;
+            }
+        } else {
+            /* run of blocks either copied or overwritten entirely */
+            while (end < lba_end) {
+                lba_t next_end = block_end(drv, block + 1);
+                if (!is_copied(drv, block + 1) && next_end > lba_end) {
+                    break;
+                }
+                end = next_end;
+                block++;
+            }
+            if (end > lba_end) {
+                end = lba_end;
+            }
+
+            const size_t len = (end - cur) * sector_size;
+            if (transfer_file(
+                    drv,
+                    (void*)(bbuf + done * sector_size),
+                    len,
+                    drv->data_offs + cur * sector_size,
+                    1) != len) {
+                break;
+            }
+        }
+
+        /* after the data, so a block is never marked without its data */
+        if (mark_copied(drv, first, block)) {
+            break;
+        }
+        done = end - lba;
+    }
+
+    pthread_mutex_unlock(&drv->lock);
+
+    return done;
+}
+
+static int flush(OFSL_Drive* drv_opaque)
+{
+    struct drive_overlay* drv = (struct drive_overlay*)drv_opaque;
+    return fsync(drv->fd) != 0;
+}
+
+static void _delete(OFSL_Drive* drv_opaque)
+{
+    struct drive_overlay* drv = (struct drive_overlay*)drv_opaque;
+
+    pthread_mutex_destroy(&drv->lock);
+    free(drv->bitmap);
+    close(drv->fd);
+    free(drv);
+}
+
+/**
+ * @brief Write the header and an empty bitmap to a new overlay file
+ *
+ * @param drv drive object struct
+ * @param hdr header in the file byte order
+ * @return int 0 if succeed, nonzero otherwise
+ */
+static int init_file(struct drive_overlay* drv, const struct overlay_header* hdr)
+{
+    if (ftruncate(drv->fd, 0)) {
+        return 1;
+    }
+
+    uint8_t* hbuf = calloc(1, HEADER_SIZE);
+    if (!hbuf) {
+        return 1;
+    }
+    memcpy(hbuf, hdr, sizeof(*hdr));
+
+    int ret = transfer_file(drv, hbuf, HEADER_SIZE, 0, 1) != HEADER_SIZE ||
+              transfer_file(drv, drv->bitmap, drv->bitmap_len, HEADER_SIZE, 1) != drv->bitmap_len;
+
+    free(hbuf);
+    return ret;
+}
+
+/**
+ * @brief Load the bitmap of an existing overlay file
+ *
+ * @param drv drive object struct
+ * @param hdr expected header in the file byte order
+ * @return int 0 if succeed, nonzero otherwise
+ */
+static int load_file(struct drive_overlay* drv, const struct overlay_header* hdr)
+{
+    struct overlay_header fhdr;
+    if (transfer_file(drv, &fhdr, sizeof(fhdr), 0, 0) != sizeof(fhdr) ||
+        memcmp(&fhdr, hdr, sizeof(fhdr)) != 0) {
+        return 1;
+    }
+
+    return transfer_file(drv, drv->bitmap, drv->bitmap_len, HEADER_SIZE, 0) != drv->bitmap_len;
+}
+
+OFSL_EXPORT
+OFSL_Drive* ofsl_drive_overlay_create(OFSL_Drive* base, const char* name, size_t block_sectors, int flags)
+{
+    static const struct ofsl_drive_ops drvops = {
+        ._delete = _delete,
+        .update_info = update_info,
+        .read_sector = read_sector,
+        .write_sector = write_sector,
+        .flush = flush,
+    };
+
+    if (!base || block_sectors == 0 || block_sectors > UINT32_MAX) {
+        return NULL;
+    }
+
+    int fd = open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st)) {
+        close(fd);
+        return NULL;
+    }
+
+    struct drive_overlay* drv = malloc(sizeof(struct drive_overlay));
+    if (!drv) {
+        close(fd);
+        return NULL;
+    }
+
+    const uint64_t sector_cnt = base->drvinfo.lba_max + 1;
+    drv->base = base;
+    drv->fd = fd;
+    drv->block_sectors = block_sectors;
+    drv->block_cnt = (sector_cnt + block_sectors - 1) / block_sectors;
+    drv->bitmap_len = (drv->block_cnt + 7) / 8;
+    drv->data_offs =
+        HEADER_SIZE + (drv->bitmap_len + HEADER_SIZE - 1) / HEADER_SIZE * HEADER_SIZE;
+    drv->bitmap = calloc(1, drv->bitmap_len);
+    if (!drv->bitmap) {
+        goto fail;
+    }
+
+    struct overlay_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, OVERLAY_MAGIC, sizeof(hdr.magic));
+    hdr.sector_size = htole32(base->drvinfo.sector_size);
+    hdr.block_sectors = htole32((uint32_t)block_sectors);
+    hdr.sector_cnt = htole64(sector_cnt);
+
+    if ((flags & OFSL_DRIVE_OVERLAY_NEW) || st.st_size == 0) {
+        if (init_file(drv, &hdr)) {
+            goto fail;
+        }
+    } else if (load_file(drv, &hdr)) {
+        goto fail;
+    }
+
+    drv->drv.ops = &drvops;
+    drv->drv.drvinfo = base->drvinfo;
+    drv->drv.drvinfo.readonly = 0;
+    drv->drv.drvinfo.buf_align = 0;
+    pthread_mutex_init(&drv->lock, NULL);
+
+    return (OFSL_Drive*)drv;
+
+fail:
+    free(drv->bitmap);
+    free(drv);
+    close(fd);
+    return NULL;
+}
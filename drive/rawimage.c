@@ -1,106 +1,546 @@
+/* O_DIRECT */
+#define _GNU_SOURCE
+
 #include <ofsl/drive/rawimage.h>
 
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 #include "export.h"
+#include "drive/fdio.h"
 
 struct drive_rawimage {
     OFSL_Drive drv;
-    FILE* fp;
+    int fd;
+    size_t dio_align;   /* offset and length alignment of direct I/O, 0 if buffered */
+    struct fdio_queue* queue;   /* created on the first submission */
+    int queue_failed;
+    pthread_mutex_t queue_lock; /* guards the creation of the queue */
 };
 
-static int update_info(OFSL_Drive* drv_opaque)
+/* maximum number of buffers merged into a single system call */
+#if defined(IOV_MAX) && IOV_MAX < 256
+#define SYSIOV_MAX IOV_MAX
+#else
+#define SYSIOV_MAX 256
+#endif
+
+/**
+ * @brief Check if a transfer can be done directly with the given buffer
+ *
+ * @param drv drive object struct
+ * @param buf data buffer
+ * @param len length of the transfer in bytes
+ * @param offs byte offset in the image file
+ * @return int nonzero if the transfer needs no bounce buffer
+ */
+static int is_aligned(struct drive_rawimage* drv, const void* buf, size_t len, off_t offs)
 {
-    return 0;
+    if (!drv->dio_align) {
+        return 1;
+    }
+
+    return (uintptr_t)buf % drv->drv.drvinfo.buf_align == 0 &&
+           len % drv->dio_align == 0 &&
+           offs % drv->dio_align == 0;
 }
 
-static ssize_t read_sector(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+/**
+ * @brief Transfer an unaligned range of a direct image through an aligned
+ *        buffer
+ *
+ * @param drv drive object struct
+ * @param buf data buffer
+ * @param len length of the transfer in bytes
+ * @param offs byte offset in the image file
+ * @param is_write write to the image if nonzero, otherwise read from it
+ * @return size_t number of bytes transferred
+ *
+ * @details
+ *  The range is extended to the alignment boundaries. When writing, the data
+ * around the range in the first and the last block is read first and written
+ * back along with the new data. Nothing is written if that read fails.
+ */
+static size_t
+transfer_bounce(
+    struct drive_rawimage* drv,
+    const void* buf,
+    size_t len,
+    off_t offs,
+    int is_write)
+{
+    const size_t align = drv->dio_align;
+    const off_t start = offs - offs % align;
+    const size_t head = offs - start;
+    const size_t blen = (head + len + align - 1) / align * align;
+
+    uint8_t* bounce = ofsl_drive_alloc_buffer(&drv->drv, blen);
+    if (!bounce) {
+        return 0;
+    }
+
+    size_t done = 0;
+    struct iovec iov = { .iov_base = bounce, .iov_len = blen };
+    if (!is_write || head != 0 || head + len != blen) {
+        ssize_t ret = fdio_transfer(drv->fd, &iov, 1, start, 0);
+        done = ret < 0 ? 0 : ret;
+        if (done < blen) {
+            if (is_write) {
+                /* writing back a partially read block would corrupt it */
+                ofsl_drive_free_buffer(bounce);
+                return 0;
+            }
+            memset(bounce + done, 0, blen - done);
+        }
+    }
+
+    if (is_write) {
+        memcpy(bounce + head, buf, len);
+        iov.iov_base = bounce;
+        iov.iov_len = blen;
+        ssize_t ret = fdio_transfer(drv->fd, &iov, 1, start, 1);
+        done = ret < 0 ? 0 : ret;
+    }
+
+    done = done > head ? done - head : 0;
+    if (done > len) {
+        done = len;
+    }
+    if (!is_write) {
+        memcpy((void*)buf, bounce + head, done);
+    }
+
+    ofsl_drive_free_buffer(bounce);
+    return done;
+}
+
+static size_t
+transfer_range(
+    struct drive_rawimage* drv,
+    const void* buf,
+    size_t len,
+    off_t offs,
+    int is_write)
+{
+    if (!is_aligned(drv, buf, len, offs)) {
+        return transfer_bounce(drv, buf, len, offs, is_write);
+    }
+
+    struct iovec iov = { .iov_base = (void*)buf, .iov_len = len };
+    ssize_t ret = fdio_transfer(drv->fd, &iov, 1, offs, is_write);
+    return ret < 0 ? 0 : ret;
+}
+
+/**
+ * @brief Transfer sectors of the image file
+ *
+ * @param drv drive object struct
+ * @param buf sector data buffer
+ * @param lba LBA address of the first sector
+ * @param sector_size sector size in bytes
+ * @param cnt number of sectors
+ * @param is_write write to the image if nonzero, otherwise read from it
+ * @return ssize_t number of sectors transferred
+ */
+static ssize_t
+transfer_sector(
+    struct drive_rawimage* drv,
+    const void* buf,
+    lba_t lba,
+    size_t sector_size,
+    size_t cnt,
+    int is_write)
 {
-    struct drive_rawimage* drv = (struct drive_rawimage*)drv_opaque;
     const uint16_t img_sector_size = drv->drv.drvinfo.sector_size;
 
     if (sector_size > img_sector_size) {
         return 0;
     }
 
-    uint8_t* bbuf = buf;
-    for (size_t i = 0; i < cnt; i++) {
-        fseek(drv->fp, lba * img_sector_size, SEEK_SET);
+    if (sector_size == img_sector_size) {
+        /* the whole range is contiguous in the image file */
+        size_t bytes_done = transfer_range(
+            drv,
+            buf,
+            cnt * sector_size,
+            (off_t)lba * img_sector_size,
+            is_write);
+        return bytes_done / sector_size;
+    }
 
-        if (!fread(bbuf, sector_size, 1, drv->fp)) {
+    /* only the head of each sector is transferred */
+    const uint8_t* bbuf = buf;
+    for (size_t i = 0; i < cnt; i++) {
+        if (transfer_range(
+            drv,
+            bbuf,
+            sector_size,
+            (off_t)(lba + i) * img_sector_size,
+            is_write) < sector_size) {
             return i;
-        } else {
-            bbuf += sector_size;
-            lba++;
         }
+        bbuf += sector_size;
     }
 
     return cnt;
 }
 
+/**
+ * @brief Transfer multiple sector ranges of the image file
+ *
+ * @param drv drive object struct
+ * @param iov list of sector segments
+ * @param iovcnt number of segments
+ * @param sector_size sector size in bytes
+ * @param is_write write to the image if nonzero, otherwise read from it
+ * @return ssize_t total number of sectors transferred
+ *
+ * @details
+ *  Consecutive segments which are also adjacent in the image are merged into
+ * a single preadv(2) or pwritev(2) call. On direct images, segments not
+ * meeting the alignment requirement are transferred one by one.
+ */
+static ssize_t
+transfer_sectorv(
+    struct drive_rawimage* drv,
+    const OFSL_DriveIOVec* iov,
+    size_t iovcnt,
+    size_t sector_size,
+    int is_write)
+{
+    const uint16_t img_sector_size = drv->drv.drvinfo.sector_size;
+    ssize_t total = 0;
+
+    if (sector_size != img_sector_size) {
+        for (size_t i = 0; i < iovcnt; i++) {
+            ssize_t ret = transfer_sector(
+                drv,
+                iov[i].buf,
+                iov[i].lba,
+                sector_size,
+                iov[i].cnt,
+                is_write);
+            total += ret;
+            if (ret < (ssize_t)iov[i].cnt) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    struct iovec sysiov[SYSIOV_MAX];
+    size_t seg = 0;
+    while (seg < iovcnt) {
+        lba_t lba_next = iov[seg].lba;
+        off_t offs = (off_t)lba_next * img_sector_size;
+        size_t run_sectors = 0;
+        int run_len = 0;
+
+        if (!is_aligned(drv, iov[seg].buf, iov[seg].cnt * sector_size, offs)) {
+            /* goes through a bounce buffer on its own */
+            size_t bytes_done = transfer_range(
+                drv,
+                iov[seg].buf,
+                iov[seg].cnt * sector_size,
+                offs,
+                is_write);
+            total += bytes_done / sector_size;
+            if (bytes_done < iov[seg].cnt * sector_size) {
+                break;
+            }
+            seg++;
+            continue;
+        }
+
+        while (seg < iovcnt &&
+               run_len < SYSIOV_MAX &&
+               iov[seg].lba == lba_next &&
+               is_aligned(
+                   drv,
+                   iov[seg].buf,
+                   iov[seg].cnt * sector_size,
+                   (off_t)lba_next * img_sector_size)) {
+            sysiov[run_len].iov_base = iov[seg].buf;
+            sysiov[run_len].iov_len = iov[seg].cnt * sector_size;
+            run_sectors += iov[seg].cnt;
+            lba_next += iov[seg].cnt;
+            run_len++;
+            seg++;
+        }
+
+        ssize_t ret = fdio_transfer(drv->fd, sysiov, run_len, offs, is_write);
+        size_t bytes_done = ret < 0 ? 0 : ret;
+        total += bytes_done / sector_size;
+        if (bytes_done < run_sectors * sector_size) {
+            break;
+        }
+    }
+
+    return total;
+}
+
+static int update_info(OFSL_Drive* drv_opaque)
+{
+    return 0;
+}
+
+static ssize_t read_sector(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_rawimage* drv = (struct drive_rawimage*)drv_opaque;
+    return transfer_sector(drv, buf, lba, sector_size, cnt, 0);
+}
+
 static ssize_t write_sector(OFSL_Drive* drv_opaque, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_rawimage* drv = (struct drive_rawimage*)drv_opaque;
+    return transfer_sector(drv, buf, lba, sector_size, cnt, 1);
+}
+
+static ssize_t
+read_sectorv(
+    OFSL_Drive* drv_opaque,
+    const OFSL_DriveIOVec* iov,
+    size_t iovcnt,
+    size_t sector_size)
+{
+    struct drive_rawimage* drv = (struct drive_rawimage*)drv_opaque;
+    return transfer_sectorv(drv, iov, iovcnt, sector_size, 0);
+}
+
+static ssize_t
+write_sectorv(
+    OFSL_Drive* drv_opaque,
+    const OFSL_DriveIOVec* iov,
+    size_t iovcnt,
+    size_t sector_size)
+{
+    struct drive_rawimage* drv = (struct drive_rawimage*)drv_opaque;
+    return transfer_sectorv(drv, iov, iovcnt, sector_size, 1);
+}
+
+/**
+ * @brief Get the asynchronous request queue, creating it if needed
+ *
+ * @param drv drive object struct
+ * @return struct fdio_queue* queue object, NULL if not available
+ *
+ * @details
+ *  Most images are only accessed synchronously, so the io_uring ring or the
+ * worker pool is not set up until the first request is submitted. Threads
+ * submitting at once get the same queue.
+ */
+static struct fdio_queue* get_queue(struct drive_rawimage* drv)
+{
+    pthread_mutex_lock(&drv->queue_lock);
+    if (!drv->queue && !drv->queue_failed) {
+        drv->queue = fdio_queue_create(drv->fd, drv->drv.drvinfo.sector_size);
+        drv->queue_failed = !drv->queue;
+    }
+    struct fdio_queue* queue = drv->queue;
+    pthread_mutex_unlock(&drv->queue_lock);
+    return queue;
+}
+
+static int
+submit_read(
+    OFSL_Drive* drv_opaque,
+    void* buf,
+    lba_t lba,
+    size_t sector_size,
+    size_t cnt,
+    uint64_t tag)
 {
     struct drive_rawimage* drv = (struct drive_rawimage*)drv_opaque;
     const uint16_t img_sector_size = drv->drv.drvinfo.sector_size;
 
-    if (sector_size > img_sector_size) {
-        return 0;
+    if (sector_size != img_sector_size ||
+        !is_aligned(drv, buf, cnt * sector_size, (off_t)lba * img_sector_size)) {
+        return 1;
     }
 
-    const uint8_t* bbuf = buf;
-    for (size_t i = 0; i < cnt; i++) {
-        fseek(drv->fp, lba * img_sector_size, SEEK_SET);
+    struct fdio_queue* queue = get_queue(drv);
+    if (!queue) {
+        return 1;
+    }
 
-        if (!fwrite(bbuf, sector_size, 1, drv->fp)) {
-            return i;
-        } else {
-            bbuf += sector_size;
-            lba++;
-        }
+    return fdio_queue_submit(
+        queue,
+        buf,
+        cnt * sector_size,
+        (off_t)lba * img_sector_size,
+        0,
+        tag);
+}
+
+static int
+submit_write(
+    OFSL_Drive* drv_opaque,
+    const void* buf,
+    lba_t lba,
+    size_t sector_size,
+    size_t cnt,
+    uint64_t tag)
+{
+    struct drive_rawimage* drv = (struct drive_rawimage*)drv_opaque;
+    const uint16_t img_sector_size = drv->drv.drvinfo.sector_size;
+
+    if (sector_size != img_sector_size ||
+        !is_aligned(drv, buf, cnt * sector_size, (off_t)lba * img_sector_size)) {
+        return 1;
     }
 
-    return cnt;
+    struct fdio_queue* queue = get_queue(drv);
+    if (!queue) {
+        return 1;
+    }
+
+    return fdio_queue_submit(
+        queue,
+        (void*)buf,
+        cnt * sector_size,
+        (off_t)lba * img_sector_size,
+        1,
+        tag);
+}
+
+static ssize_t
+reap_completion(
+    OFSL_Drive* drv_opaque,
+    OFSL_DriveCompletion* comp,
+    size_t max,
+    size_t min)
+{
+    struct drive_rawimage* drv = (struct drive_rawimage*)drv_opaque;
+
+    pthread_mutex_lock(&drv->queue_lock);
+    struct fdio_queue* queue = drv->queue;
+    const int queue_failed = drv->queue_failed;
+    pthread_mutex_unlock(&drv->queue_lock);
+
+    if (!queue) {
+        /* nothing can be in flight before the first submission */
+        return queue_failed ? -1 : 0;
+    }
+
+    return fdio_queue_reap(queue, comp, max, min);
+}
+
+static int flush(OFSL_Drive* drv_opaque)
+{
+    struct drive_rawimage* drv = (struct drive_rawimage*)drv_opaque;
+
+    if (drv->drv.drvinfo.readonly) {
+        return 0;
+    }
+
+    return fsync(drv->fd) != 0;
 }
 
 static void _delete(OFSL_Drive* drv_opaque)
 {
     struct drive_rawimage* drv = (struct drive_rawimage*)drv_opaque;
 
-    fclose(drv->fp);
+    if (drv->queue) {
+        fdio_queue_delete(drv->queue);
+    }
+    pthread_mutex_destroy(&drv->queue_lock);
+    close(drv->fd);
     free(drv);
 }
 
+/**
+ * @brief Turn off the page cache on the opened image
+ *
+ * @param fd file descriptor of the image
+ * @param dio_align alignment required for the offsets and the lengths
+ * @return int 0 if succeed, nonzero otherwise
+ *
+ * @details
+ *  With O_DIRECT, the actual requirement depends on the filesystem holding the
+ * image. The page size is used for both the memory and the file alignment
+ * since it satisfies every filesystem in practice.
+ */
+static int enable_direct_io(int fd, size_t* dio_align)
+{
+#if defined(O_DIRECT)
+    long page_size = sysconf(_SC_PAGESIZE);
+    *dio_align = page_size > 0 ? page_size : 4096;
+    return 0;
+#elif defined(F_NOCACHE)
+    /* no alignment requirement */
+    *dio_align = 0;
+    return fcntl(fd, F_NOCACHE, 1) == -1;
+#else
+    return 1;
+#endif
+}
+
 OFSL_EXPORT
-OFSL_Drive* ofsl_drive_rawimage_create(const char* name, int readonly, size_t sector_size)
+OFSL_Drive* ofsl_drive_rawimage_create(const char* name, int flags, size_t sector_size)
 {
     static const struct ofsl_drive_ops drvops = {
         ._delete = _delete,
         .update_info = update_info,
         .read_sector = read_sector,
         .write_sector = write_sector,
+        .read_sectorv = read_sectorv,
+        .write_sectorv = write_sectorv,
+        .submit_read = submit_read,
+        .submit_write = submit_write,
+        .reap_completion = reap_completion,
+        .flush = flush,
     };
 
-    FILE* fp = fopen(name, readonly ? "rb" : "rb+");
-    if (fp == NULL) {
+    const int readonly = !!(flags & OFSL_DRIVE_RAWIMAGE_READONLY);
+    const int direct = !!(flags & OFSL_DRIVE_RAWIMAGE_DIRECT);
+
+    int open_flags = readonly ? O_RDONLY : O_RDWR;
+#ifdef O_DIRECT
+    if (direct) {
+        open_flags |= O_DIRECT;
+    }
+#endif
+
+    int fd = open(name, open_flags);
+    if (fd < 0) {
         return NULL;
     }
 
-    fseek(fp, 0, SEEK_END);
-    size_t filesz = ftell(fp);
-    if (filesz % sector_size != 0) {
-        fclose(fp);
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size % sector_size != 0) {
+        close(fd);
         return NULL;
     }
 
-    lba_t lba_max = filesz / sector_size - 1;
+    size_t dio_align = 0;
+    if (direct) {
+        /* blocks past the end of the image cannot be rewritten as a whole */
+        if (enable_direct_io(fd, &dio_align) ||
+            (dio_align && st.st_size % dio_align != 0)) {
+            close(fd);
+            return NULL;
+        }
+    }
+
+    lba_t lba_max = st.st_size / sector_size - 1;
 
     struct drive_rawimage* drv = malloc(sizeof(struct drive_rawimage));
     drv->drv.ops = &drvops;
     drv->drv.drvinfo.sector_size = sector_size;
     drv->drv.drvinfo.lba_max = lba_max;
     drv->drv.drvinfo.readonly = readonly;
-    drv->fp = fp;
+    drv->drv.drvinfo.buf_align = dio_align;
+    drv->fd = fd;
+    drv->dio_align = dio_align;
+    drv->queue = NULL;
+    drv->queue_failed = 0;
+    pthread_mutex_init(&drv->queue_lock, NULL);
 
     return (OFSL_Drive*)drv;
 }
@@ -0,0 +1,226 @@
+#include <ofsl/drive/readahead.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "export.h"
+#include "drive/internal.h"
+
+/* window of the first readahead after a sequential read is detected */
+#define WINDOW_MIN      8
+
+struct drive_readahead {
+    OFSL_Drive drv;
+    OFSL_Drive* lower;
+    pthread_mutex_t lock;
+    size_t window_max;
+    size_t window;      /* current window, 0 if the reads are not sequential */
+    lba_t next_lba;     /* LBA address expected by the next sequential read */
+    lba_t buf_lba;      /* LBA address of the first sector read ahead */
+    size_t buf_cnt;     /* number of sectors read ahead */
+    uint8_t* buf;
+};
+
+/**
+ * @brief Replace the sectors read ahead with the given range
+ *
+ * @param drv drive object struct
+ * @param lba LBA address of the first sector
+ * @param cnt number of sectors, at most `window_max`
+ */
+static void fill_buffer(struct drive_readahead* drv, lba_t lba, size_t cnt)
+{
+    cnt = drive_clamp_count(&drv->drv, lba, cnt);
+
+    ssize_t ret = ofsl_drive_read_sector(
+        drv->lower,
+        drv->buf,
+        lba,
+        drv->drv.drvinfo.sector_size,
+        cnt);
+    drv->buf_lba = lba;
+    drv->buf_cnt = ret > 0 ? ret : 0;
+}
+
+/**
+ * @brief Copy the sectors read ahead overlapping the head of a request
+ *
+ * @param drv drive object struct
+ * @param buf request buffer
+ * @param lba LBA address of the first sector of the request
+ * @param cnt number of sectors of the request
+ * @return size_t number of sectors copied
+ */
+static size_t copy_buffer(struct drive_readahead* drv, uint8_t* buf, lba_t lba, size_t cnt)
+{
+    const size_t sector_size = drv->drv.drvinfo.sector_size;
+
+    if (drv->buf_cnt == 0 ||
+        lba < drv->buf_lba ||
+        lba >= drv->buf_lba + drv->buf_cnt) {
+        return 0;
+    }
+
+    size_t avail = drv->buf_lba + drv->buf_cnt - lba;
+    size_t n = cnt < avail ? cnt : avail;
+    memcpy(buf, drv->buf + (lba - drv->buf_lba) * sector_size, n * sector_size);
+
+    return n;
+}
+
+static int update_info(OFSL_Drive* drv_opaque)
+{
+    struct drive_readahead* drv = (struct drive_readahead*)drv_opaque;
+
+    pthread_mutex_lock(&drv->lock);
+    int ret = ofsl_drive_update_info(drv->lower);
+    drv->drv.drvinfo.lba_max = drv->lower->drvinfo.lba_max;
+    drv->drv.drvinfo.readonly = drv->lower->drvinfo.readonly;
+    drv->buf_cnt = 0;
+    pthread_mutex_unlock(&drv->lock);
+
+    return ret;
+}
+
+static ssize_t read_sector(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_readahead* drv = (struct drive_readahead*)drv_opaque;
+
+    if (sector_size != drv->drv.drvinfo.sector_size) {
+        return ofsl_drive_read_sector(drv->lower, buf, lba, sector_size, cnt);
+    }
+
+    cnt = drive_clamp_count(&drv->drv, lba, cnt);
+    if (cnt == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&drv->lock);
+
+    uint8_t* bbuf = buf;
+    size_t done = copy_buffer(drv, bbuf, lba, cnt);
+    const int sequential = done > 0 || lba == drv->next_lba;
+
+    if (!sequential) {
+        drv->window = 0;
+    }
+
+    if (done < cnt) {
+        const lba_t rem_lba = lba + done;
+        const size_t rem = cnt - done;
+
+        /* the window grows only when the lower drive is read */
+        if (sequential) {
+            drv->window = drv->window ? drv->window * 2 : WINDOW_MIN;
+            if (drv->window > drv->window_max) {
+                drv->window = drv->window_max;
+            }
+        }
+
+        if (drv->window == 0 || rem >= drv->window) {
+            /* too large to go through the buffer, read ahead in the same request */
+            OFSL_DriveIOVec iov[2] = {
+                { .lba = rem_lba, .cnt = rem, .buf = bbuf + done * sector_size },
+                { .lba = rem_lba + rem, .cnt = 0, .buf = drv->buf },
+            };
+            if (drv->window) {
+                iov[1].cnt = drive_clamp_count(&drv->drv, rem_lba + rem, drv->window);
+                drv->buf_cnt = 0;
+            }
+
+            ssize_t ret = ofsl_drive_read_sectorv(
+                drv->lower,
+                iov,
+                iov[1].cnt ? 2 : 1,
+                sector_size);
+            size_t got = ret > 0 ? ret : 0;
+            if (got > rem) {
+                drv->buf_lba = iov[1].lba;
+                drv->buf_cnt = got - rem;
+                got = rem;
+            }
+            done += got;
+        } else {
+            fill_buffer(drv, rem_lba, drv->window);
+            done += copy_buffer(drv, bbuf + done * sector_size, rem_lba, rem);
+        }
+    }
+
+    drv->next_lba = lba + done;
+
+    pthread_mutex_unlock(&drv->lock);
+
+    return done;
+}
+
+static ssize_t write_sector(OFSL_Drive* drv_opaque, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_readahead* drv = (struct drive_readahead*)drv_opaque;
+
+    pthread_mutex_lock(&drv->lock);
+    ssize_t ret = ofsl_drive_write_sector(drv->lower, buf, lba, sector_size, cnt);
+    if (drv->buf_cnt &&
+        lba < drv->buf_lba + drv->buf_cnt &&
+        lba + cnt > drv->buf_lba) {
+        drv->buf_cnt = 0;
+    }
+    pthread_mutex_unlock(&drv->lock);
+
+    return ret;
+}
+
+static int flush(OFSL_Drive* drv_opaque)
+{
+    struct drive_readahead* drv = (struct drive_readahead*)drv_opaque;
+    return ofsl_drive_flush(drv->lower);
+}
+
+static void _delete(OFSL_Drive* drv_opaque)
+{
+    struct drive_readahead* drv = (struct drive_readahead*)drv_opaque;
+
+    pthread_mutex_destroy(&drv->lock);
+    ofsl_drive_free_buffer(drv->buf);
+    free(drv);
+}
+
+OFSL_EXPORT
+OFSL_Drive* ofsl_drive_readahead_create(OFSL_Drive* lower, size_t window_max)
+{
+    static const struct ofsl_drive_ops drvops = {
+        ._delete = _delete,
+        .update_info = update_info,
+        .read_sector = read_sector,
+        .write_sector = write_sector,
+        .flush = flush,
+    };
+
+    if (!lower || window_max == 0) {
+        return NULL;
+    }
+
+    struct drive_readahead* drv = malloc(sizeof(struct drive_readahead));
+    if (!drv) {
+        return NULL;
+    }
+
+    drv->buf = ofsl_drive_alloc_buffer(lower, window_max * lower->drvinfo.sector_size);
+    if (!drv->buf) {
+        free(drv);
+        return NULL;
+    }
+
+    drv->drv.ops = &drvops;
+    drv->drv.drvinfo = lower->drvinfo;
+    drv->drv.drvinfo.buf_align = 0;
+    drv->lower = lower;
+    pthread_mutex_init(&drv->lock, NULL);
+    drv->window_max = window_max;
+    drv->window = 0;
+    drv->next_lba = 0;
+    drv->buf_lba = 0;
+    drv->buf_cnt = 0;
+
+    return (OFSL_Drive*)drv;
+}
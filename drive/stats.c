@@ -0,0 +1,314 @@
+#include <ofsl/drive/stats.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "export.h"
+
+struct drive_stats {
+    OFSL_Drive drv;
+    OFSL_Drive* lower;
+    pthread_mutex_t lock;   /* held only while updating the counters */
+    lba_t next_lba[2];      /* end of the previous read and write */
+    OFSL_DriveStats stats;
+};
+
+/* asynchronous request passed to the lower drive, tagged with its address */
+struct stats_request {
+    uint64_t tag;           /* tag given by the caller */
+    int is_write;
+    lba_t lba;
+    size_t cnt;
+    uint64_t start;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static unsigned int hist_bucket(uint64_t latency_ns)
+{
+    uint64_t us = latency_ns / 1000;
+    unsigned int bucket = 0;
+
+    while (us > 1 && bucket < OFSL_DRIVE_STATS_HIST_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+/**
+ * @brief Account a finished request
+ *
+ * @param drv drive object struct
+ * @param is_write account a write if nonzero, otherwise a read
+ * @param lba LBA address of the first sector
+ * @param lba_end LBA address past the last sector
+ * @param cnt number of sectors requested
+ * @param ret return value of the lower drive
+ * @param start time the request started at
+ */
+static void
+record(
+    struct drive_stats* drv,
+    int is_write,
+    lba_t lba,
+    lba_t lba_end,
+    size_t cnt,
+    ssize_t ret,
+    uint64_t start)
+{
+    const uint64_t latency = now_ns() - start;
+    OFSL_DriveOpStats* op = is_write ? &drv->stats.write : &drv->stats.read;
+
+    pthread_mutex_lock(&drv->lock);
+    op->ops++;
+    if (ret > 0) {
+        op->sectors += ret;
+    }
+    if (ret < (ssize_t)cnt) {
+        op->errors++;
+    }
+    if (lba == drv->next_lba[is_write]) {
+        op->sequential++;
+    }
+    drv->next_lba[is_write] = lba_end;
+    op->latency_ns += latency;
+    op->latency_hist[hist_bucket(latency)]++;
+    pthread_mutex_unlock(&drv->lock);
+}
+
+static int update_info(OFSL_Drive* drv_opaque)
+{
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+
+    int ret = ofsl_drive_update_info(drv->lower);
+    drv->drv.drvinfo.lba_max = drv->lower->drvinfo.lba_max;
+    drv->drv.drvinfo.readonly = drv->lower->drvinfo.readonly;
+
+    return ret;
+}
+
+static ssize_t read_sector(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+
+    uint64_t start = now_ns();
+    ssize_t ret = ofsl_drive_read_sector(drv->lower, buf, lba, sector_size, cnt);
+    record(drv, 0, lba, lba + cnt, cnt, ret, start);
+
+    return ret;
+}
+
+static ssize_t write_sector(OFSL_Drive* drv_opaque, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+
+    uint64_t start = now_ns();
+    ssize_t ret = ofsl_drive_write_sector(drv->lower, buf, lba, sector_size, cnt);
+    record(drv, 1, lba, lba + cnt, cnt, ret, start);
+
+    return ret;
+}
+
+static size_t count_sectors(const OFSL_DriveIOVec* iov, size_t iovcnt)
+{
+    size_t cnt = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        cnt += iov[i].cnt;
+    }
+    return cnt;
+}
+
+static ssize_t
+read_sectorv(
+    OFSL_Drive* drv_opaque,
+    const OFSL_DriveIOVec* iov,
+    size_t iovcnt,
+    size_t sector_size)
+{
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+
+    uint64_t start = now_ns();
+    ssize_t ret = ofsl_drive_read_sectorv(drv->lower, iov, iovcnt, sector_size);
+    if (iovcnt > 0) {
+        const OFSL_DriveIOVec* last = &iov[iovcnt - 1];
+        record(drv, 0, iov[0].lba, last->lba + last->cnt, count_sectors(iov, iovcnt), ret, start);
+    }
+
+    return ret;
+}
+
+static ssize_t
+write_sectorv(
+    OFSL_Drive* drv_opaque,
+    const OFSL_DriveIOVec* iov,
+    size_t iovcnt,
+    size_t sector_size)
+{
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+
+    uint64_t start = now_ns();
+    ssize_t ret = ofsl_drive_write_sectorv(drv->lower, iov, iovcnt, sector_size);
+    if (iovcnt > 0) {
+        const OFSL_DriveIOVec* last = &iov[iovcnt - 1];
+        record(drv, 1, iov[0].lba, last->lba + last->cnt, count_sectors(iov, iovcnt), ret, start);
+    }
+
+    return ret;
+}
+
+static const void* map_sector(OFSL_Drive* drv_opaque, lba_t lba, size_t cnt)
+{
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+    return ofsl_drive_map_sector(drv->lower, lba, cnt);
+}
+
+static int
+submit_request(
+    struct drive_stats* drv,
+    const void* buf,
+    lba_t lba,
+    size_t sector_size,
+    size_t cnt,
+    uint64_t tag,
+    int is_write)
+{
+    struct stats_request* req = malloc(sizeof(struct stats_request));
+    if (!req) {
+        return 1;
+    }
+    req->tag = tag;
+    req->is_write = is_write;
+    req->lba = lba;
+    req->cnt = cnt;
+    req->start = now_ns();
+
+    int ret =
+        is_write ?
+            ofsl_drive_submit_write(drv->lower, buf, lba, sector_size, cnt, (uintptr_t)req) :
+            ofsl_drive_submit_read(drv->lower, (void*)buf, lba, sector_size, cnt, (uintptr_t)req);
+    if (ret) {
+        free(req);
+    }
+
+    return ret;
+}
+
+static int submit_read(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt, uint64_t tag)
+{
+    return submit_request((struct drive_stats*)drv_opaque, buf, lba, sector_size, cnt, tag, 0);
+}
+
+static int submit_write(OFSL_Drive* drv_opaque, const void* buf, lba_t lba, size_t sector_size, size_t cnt, uint64_t tag)
+{
+    return submit_request((struct drive_stats*)drv_opaque, buf, lba, sector_size, cnt, tag, 1);
+}
+
+static ssize_t reap_completion(OFSL_Drive* drv_opaque, OFSL_DriveCompletion* comp, size_t max, size_t min)
+{
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+
+    ssize_t ret = ofsl_drive_reap_completion(drv->lower, comp, max, min);
+    for (ssize_t i = 0; i < ret; i++) {
+        struct stats_request* req = (struct stats_request*)(uintptr_t)comp[i].tag;
+        record(drv, req->is_write, req->lba, req->lba + req->cnt, req->cnt, comp[i].result, req->start);
+        comp[i].tag = req->tag;
+        free(req);
+    }
+
+    return ret;
+}
+
+static int flush(OFSL_Drive* drv_opaque)
+{
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+
+    pthread_mutex_lock(&drv->lock);
+    drv->stats.flushes++;
+    pthread_mutex_unlock(&drv->lock);
+
+    return ofsl_drive_flush(drv->lower);
+}
+
+static void _delete(OFSL_Drive* drv_opaque)
+{
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+
+    pthread_mutex_destroy(&drv->lock);
+    free(drv);
+}
+
+static const struct ofsl_drive_ops drvops = {
+    ._delete = _delete,
+    .update_info = update_info,
+    .read_sector = read_sector,
+    .write_sector = write_sector,
+    .map_sector = map_sector,
+    .read_sectorv = read_sectorv,
+    .write_sectorv = write_sectorv,
+    .submit_read = submit_read,
+    .submit_write = submit_write,
+    .reap_completion = reap_completion,
+    .flush = flush,
+};
+
+OFSL_EXPORT
+OFSL_Drive* ofsl_drive_stats_create(OFSL_Drive* lower)
+{
+    if (!lower) {
+        return NULL;
+    }
+
+    struct drive_stats* drv = malloc(sizeof(struct drive_stats));
+    if (!drv) {
+        return NULL;
+    }
+
+    drv->drv.ops = &drvops;
+    drv->drv.drvinfo = lower->drvinfo;
+    drv->lower = lower;
+    pthread_mutex_init(&drv->lock, NULL);
+    drv->next_lba[0] = 0;
+    drv->next_lba[1] = 0;
+    memset(&drv->stats, 0, sizeof(drv->stats));
+
+    return (OFSL_Drive*)drv;
+}
+
+OFSL_EXPORT
+int ofsl_drive_stats_get(OFSL_Drive* drv_opaque, OFSL_DriveStats* stats)
+{
+    if (!drv_opaque || drv_opaque->ops != &drvops) {
+        return 1;
+    }
+
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+    pthread_mutex_lock(&drv->lock);
+    *stats = drv->stats;
+    pthread_mutex_unlock(&drv->lock);
+
+    return 0;
+}
+
+OFSL_EXPORT
+int ofsl_drive_stats_reset(OFSL_Drive* drv_opaque)
+{
+    if (!drv_opaque || drv_opaque->ops != &drvops) {
+        return 1;
+    }
+
+    struct drive_stats* drv = (struct drive_stats*)drv_opaque;
+    pthread_mutex_lock(&drv->lock);
+    memset(&drv->stats, 0, sizeof(drv->stats));
+    pthread_mutex_unlock(&drv->lock);
+
+    return 0;
+}
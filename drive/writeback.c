@@ -0,0 +1,312 @@
+#include <ofsl/drive/writeback.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "export.h"
+#include "drive/internal.h"
+
+struct dirty_sector {
+    lba_t lba;
+    struct dirty_sector* hash_next;
+    uint8_t data[];
+};
+
+struct drive_writeback {
+    OFSL_Drive drv;
+    OFSL_Drive* lower;
+    pthread_mutex_t lock;
+    size_t dirty_max;       /* in sectors */
+    size_t dirty_cnt;
+    struct dirty_sector** hash;
+    unsigned int hash_bits;
+};
+
+static size_t hash_index(struct drive_writeback* drv, lba_t lba)
+{
+    return (lba * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - drv->hash_bits);
+}
+
+static struct dirty_sector* lookup_sector(struct drive_writeback* drv, lba_t lba)
+{
+    struct dirty_sector* sect = drv->hash[hash_index(drv, lba)];
+    while (sect && sect->lba != lba) {
+        sect = sect->hash_next;
+    }
+    return sect;
+}
+
+static int compare_sector_lba(const void* a, const void* b)
+{
+    const struct dirty_sector* sect_a = *(struct dirty_sector* const*)a;
+    const struct dirty_sector* sect_b = *(struct dirty_sector* const*)b;
+
+    if (sect_a->lba < sect_b->lba) return -1;
+    if (sect_a->lba > sect_b->lba) return 1;
+    return 0;
+}
+
+/**
+ * @brief Write back every held sector
+ *
+ * @param drv drive object struct
+ * @return int 0 if succeed, nonzero otherwise
+ *
+ * @details
+ *  Runs of adjacent sectors are gathered into one staging buffer so each run
+ * is a single segment of the vectored write, whatever the lower drive does
+ * with the segments. Sectors which failed to be written are kept.
+ */
+static int flush_sectors(struct drive_writeback* drv)
+{
+    const size_t sector_size = drv->drv.drvinfo.sector_size;
+
+    if (drv->dirty_cnt == 0) {
+        return 0;
+    }
+
+    struct dirty_sector** sorted = malloc(sizeof(struct dirty_sector*) * drv->dirty_cnt);
+    OFSL_DriveIOVec* iov = malloc(sizeof(OFSL_DriveIOVec) * drv->dirty_cnt);
+    uint8_t* staging = ofsl_drive_alloc_buffer(drv->lower, drv->dirty_cnt * sector_size);
+    if (!sorted || !iov || !staging) {
+        free(sorted);
+        free(iov);
+        ofsl_drive_free_buffer(staging);
+        return 1;
+    }
+
+    size_t cnt = 0;
+    for (size_t i = 0; i < ((size_t)1 << drv->hash_bits); i++) {
+        for (struct dirty_sector* sect = drv->hash[i]; sect; sect = sect->hash_next) {
+            sorted[cnt++] = sect;
+        }
+    }
+    qsort(sorted, cnt, sizeof(struct dirty_sector*), compare_sector_lba);
+
+    size_t iovcnt = 0;
+    for (size_t i = 0; i < cnt; i++) {
+        uint8_t* dest = staging + i * sector_size;
+        memcpy(dest, sorted[i]->data, sector_size);
+
+        if (iovcnt > 0 &&
+            iov[iovcnt - 1].lba + iov[iovcnt - 1].cnt == sorted[i]->lba) {
+            iov[iovcnt - 1].cnt++;
+        } else {
+            iov[iovcnt].lba = sorted[i]->lba;
+            iov[iovcnt].cnt = 1;
+            iov[iovcnt].buf = dest;
+            iovcnt++;
+        }
+    }
+
+    ssize_t ret = ofsl_drive_write_sectorv(drv->lower, iov, iovcnt, sector_size);
+    const size_t written = ret > 0 ? ret : 0;
+
+    /* sectors are written in the sorted order */
+    for (size_t i = 0; i < written; i++) {
+        struct dirty_sector** link = &drv->hash[hash_index(drv, sorted[i]->lba)];
+        while (*link != sorted[i]) {
+            link = &(*link)->hash_next;
+        }
+        *link = sorted[i]->hash_next;
+        free(sorted[i]);
+    }
+    drv->dirty_cnt -= written;
+
+    ofsl_drive_free_buffer(staging);
+    free(iov);
+    free(sorted);
+    return written < cnt;
+}
+
+static int update_info(OFSL_Drive* drv_opaque)
+{
+    struct drive_writeback* drv = (struct drive_writeback*)drv_opaque;
+
+    pthread_mutex_lock(&drv->lock);
+    flush_sectors(drv);
+    int ret = ofsl_drive_update_info(drv->lower);
+    drv->drv.drvinfo.lba_max = drv->lower->drvinfo.lba_max;
+    drv->drv.drvinfo.readonly = drv->lower->drvinfo.readonly;
+    pthread_mutex_unlock(&drv->lock);
+
+    return ret;
+}
+
+static ssize_t read_sector(OFSL_Drive* drv_opaque, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_writeback* drv = (struct drive_writeback*)drv_opaque;
+    ssize_t ret;
+
+    pthread_mutex_lock(&drv->lock);
+
+    if (sector_size != drv->drv.drvinfo.sector_size) {
+        /* the held sectors would be stale or overwritten otherwise */
+        if (flush_sectors(drv)) {
+            pthread_mutex_unlock(&drv->lock);
+            return -1;
+        }
+        ret = ofsl_drive_read_sector(drv->lower, buf, lba, sector_size, cnt);
+        pthread_mutex_unlock(&drv->lock);
+        return ret;
+    }
+
+    cnt = drive_clamp_count(&drv->drv, lba, cnt);
+    ret = cnt ? ofsl_drive_read_sector(drv->lower, buf, lba, sector_size, cnt) : 0;
+    if (ret < 0) {
+        ret = 0;
+    }
+
+    /* held sectors are newer, and may extend a short read */
+    uint8_t* bbuf = buf;
+    for (size_t i = 0; drv->dirty_cnt > 0 && i < cnt; i++) {
+        struct dirty_sector* sect = lookup_sector(drv, lba + i);
+        if (sect) {
+            memcpy(bbuf + i * sector_size, sect->data, sector_size);
+            if ((ssize_t)i == ret) {
+                ret++;
+            }
+        } else if ((ssize_t)i >= ret) {
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&drv->lock);
+
+    return ret;
+}
+
+static ssize_t write_sector(OFSL_Drive* drv_opaque, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct drive_writeback* drv = (struct drive_writeback*)drv_opaque;
+    ssize_t ret;
+
+    pthread_mutex_lock(&drv->lock);
+
+    if (sector_size != drv->drv.drvinfo.sector_size) {
+        /* the held sectors would be stale or overwritten otherwise */
+        if (flush_sectors(drv)) {
+            pthread_mutex_unlock(&drv->lock);
+            return 0;
+        }
+        ret = ofsl_drive_write_sector(drv->lower, buf, lba, sector_size, cnt);
+        pthread_mutex_unlock(&drv->lock);
+        return ret;
+    }
+
+    if (drv->drv.drvinfo.readonly) {
+        pthread_mutex_unlock(&drv->lock);
+        return 0;
+    }
+
+    cnt = drive_clamp_count(&drv->drv, lba, cnt);
+
+    const uint8_t* bbuf = buf;
+    for (ret = 0; ret < (ssize_t)cnt; ret++) {
+        struct dirty_sector* sect = lookup_sector(drv, lba + ret);
+        if (!sect) {
+            if (drv->dirty_cnt >= drv->dirty_max && flush_sectors(drv)) {
+                break;
+            }
+
+            sect = malloc(sizeof(struct dirty_sector) + sector_size);
+            if (!sect) {
+                break;
+            }
+            sect->lba = lba + ret;
+
+            size_t hidx = hash_index(drv, sect->lba);
+            sect->hash_next = drv->hash[hidx];
+            drv->hash[hidx] = sect;
+            drv->dirty_cnt++;
+        }
+
+        memcpy(sect->data, bbuf + ret * sector_size, sector_size);
+    }
+
+    if (drv->dirty_cnt >= drv->dirty_max) {
+        flush_sectors(drv);
+    }
+
+    pthread_mutex_unlock(&drv->lock);
+
+    return ret;
+}
+
+static int flush(OFSL_Drive* drv_opaque)
+{
+    struct drive_writeback* drv = (struct drive_writeback*)drv_opaque;
+
+    pthread_mutex_lock(&drv->lock);
+    int ret = flush_sectors(drv);
+    pthread_mutex_unlock(&drv->lock);
+
+    return ofsl_drive_flush(drv->lower) || ret;
+}
+
+static void _delete(OFSL_Drive* drv_opaque)
+{
+    struct drive_writeback* drv = (struct drive_writeback*)drv_opaque;
+
+    flush_sectors(drv);
+    for (size_t i = 0; i < ((size_t)1 << drv->hash_bits); i++) {
+        struct dirty_sector* sect = drv->hash[i];
+        while (sect) {
+            struct dirty_sector* next = sect->hash_next;
+            free(sect);
+            sect = next;
+        }
+    }
+
+    pthread_mutex_destroy(&drv->lock);
+    free(drv->hash);
+    free(drv);
+}
+
+OFSL_EXPORT
+OFSL_Drive* ofsl_drive_writeback_create(OFSL_Drive* lower, size_t dirty_max)
+{
+    static const struct ofsl_drive_ops drvops = {
+        ._delete = _delete,
+        .update_info = update_info,
+        .read_sector = read_sector,
+        .write_sector = write_sector,
+        .flush = flush,
+    };
+
+    if (!lower) {
+        return NULL;
+    }
+
+    size_t sector_max = dirty_max / lower->drvinfo.sector_size;
+    if (sector_max == 0) {
+        sector_max = 1;
+    }
+
+    struct drive_writeback* drv = malloc(sizeof(struct drive_writeback));
+    if (!drv) {
+        return NULL;
+    }
+
+    /* keep the load factor of the hash table at most 1 */
+    drv->hash_bits = 1;
+    while (((size_t)1 << drv->hash_bits) < sector_max) {
+        drv->hash_bits++;
+    }
+    drv->hash = calloc((size_t)1 << drv->hash_bits, sizeof(struct dirty_sector*));
+    if (!drv->hash) {
+        free(drv);
+        return NULL;
+    }
+
+    drv->drv.ops = &drvops;
+    drv->drv.drvinfo = lower->drvinfo;
+    drv->drv.drvinfo.buf_align = 0;
+    drv->lower = lower;
+    pthread_mutex_init(&drv->lock, NULL);
+    drv->dirty_max = sector_max;
+    drv->dirty_cnt = 0;
+
+    return (OFSL_Drive*)drv;
+}
@@ -0,0 +1,218 @@
+#include "fs/dcache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct dcache_entry {
+    struct dcache_entry* hash_next;
+    struct dcache_entry* lru_prev;      /* more recently used */
+    struct dcache_entry* lru_next;
+    uint64_t parent;
+    uint64_t hash;
+    uint8_t negative : 1;
+    unsigned char data[];               /* value, then the name */
+};
+
+struct dcache {
+    struct dcache_entry** hash;
+    unsigned int hash_bits;
+    struct dcache_entry* lru_head;      /* most recently used */
+    struct dcache_entry* lru_tail;
+    size_t entry_cnt;
+    size_t entry_max;
+    size_t value_size;
+};
+
+static uint64_t hash_key(uint64_t parent, const char* name)
+{
+    /* FNV-1a over the name, started from the directory */
+    uint64_t hash = UINT64_C(0xCBF29CE484222325) ^ (parent * UINT64_C(0x9E3779B97F4A7C15));
+    for (; *name; name++) {
+        hash = (hash ^ (uint8_t)*name) * UINT64_C(0x100000001B3);
+    }
+    return hash;
+}
+
+static size_t hash_index(const struct dcache* cache, uint64_t hash)
+{
+    return (hash * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - cache->hash_bits);
+}
+
+static const char* entry_name(const struct dcache* cache, const struct dcache_entry* entry)
+{
+    return (const char*)entry->data + cache->value_size;
+}
+
+static struct dcache_entry*
+find_entry(const struct dcache* cache, uint64_t parent, const char* name, uint64_t hash)
+{
+    struct dcache_entry* entry = cache->hash[hash_index(cache, hash)];
+    while (entry &&
+           (entry->hash != hash || entry->parent != parent ||
+            strcmp(entry_name(cache, entry), name) != 0)) {
+        entry = entry->hash_next;
+    }
+    return entry;
+}
+
+static void lru_unlink(struct dcache* cache, struct dcache_entry* entry)
+{
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+}
+
+static void lru_push_front(struct dcache* cache, struct dcache_entry* entry)
+{
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    } else {
+        cache->lru_tail = entry;
+    }
+    cache->lru_head = entry;
+}
+
+static void evict_entry(struct dcache* cache, struct dcache_entry* entry)
+{
+    struct dcache_entry** link = &cache->hash[hash_index(cache, entry->hash)];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+
+    lru_unlink(cache, entry);
+    cache->entry_cnt--;
+    free(entry);
+}
+
+struct dcache* dcache_create(size_t entry_max, size_t value_size)
+{
+    if (entry_max == 0) {
+        return NULL;
+    }
+
+    struct dcache* cache = malloc(sizeof(struct dcache));
+    if (!cache) {
+        return NULL;
+    }
+
+    /* keep the load factor of the hash table at most 1 */
+    cache->hash_bits = 1;
+    while (((size_t)1 << cache->hash_bits) < entry_max) {
+        cache->hash_bits++;
+    }
+    cache->hash = calloc((size_t)1 << cache->hash_bits, sizeof(struct dcache_entry*));
+    if (!cache->hash) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->lru_head = NULL;
+    cache->lru_tail = NULL;
+    cache->entry_cnt = 0;
+    cache->entry_max = entry_max;
+    cache->value_size = value_size;
+
+    return cache;
+}
+
+void dcache_delete(struct dcache* cache)
+{
+    if (!cache) return;
+
+    struct dcache_entry* entry = cache->lru_head;
+    while (entry) {
+        struct dcache_entry* next = entry->lru_next;
+        free(entry);
+        entry = next;
+    }
+    free(cache->hash);
+    free(cache);
+}
+
+int dcache_lookup(struct dcache* cache, uint64_t parent, const char* name, void* value)
+{
+    struct dcache_entry* entry = find_entry(cache, parent, name, hash_key(parent, name));
+    if (!entry) {
+        return DCACHE_MISS;
+    }
+
+    lru_unlink(cache, entry);
+    lru_push_front(cache, entry);
+
+    if (entry->negative) {
+        return DCACHE_NEGATIVE;
+    }
+    memcpy(value, entry->data, cache->value_size);
+    return DCACHE_POSITIVE;
+}
+
+int dcache_insert(struct dcache* cache, uint64_t parent, const char* name, const void* value)
+{
+    const uint64_t hash = hash_key(parent, name);
+    struct dcache_entry* entry = find_entry(cache, parent, name, hash);
+
+    if (entry) {
+        lru_unlink(cache, entry);
+    } else {
+        if (cache->entry_cnt >= cache->entry_max) {
+            evict_entry(cache, cache->lru_tail);
+        }
+
+        const size_t name_len = strlen(name) + 1;
+        entry = malloc(sizeof(struct dcache_entry) + cache->value_size + name_len);
+        if (!entry) {
+            return 1;
+        }
+        entry->parent = parent;
+        entry->hash = hash;
+        memcpy(entry->data + cache->value_size, name, name_len);
+
+        size_t hidx = hash_index(cache, hash);
+        entry->hash_next = cache->hash[hidx];
+        cache->hash[hidx] = entry;
+        cache->entry_cnt++;
+    }
+
+    entry->negative = value == NULL;
+    if (value) {
+        memcpy(entry->data, value, cache->value_size);
+    }
+    lru_push_front(cache, entry);
+
+    return 0;
+}
+
+int dcache_path_next(const char** path, char* buf, size_t len)
+{
+    const char* p = *path;
+    while (*p == '/') {
+        p++;
+    }
+    if (!*p) {
+        *path = p;
+        return 1;
+    }
+
+    size_t comp_len = 0;
+    while (p[comp_len] && p[comp_len] != '/') {
+        comp_len++;
+    }
+    *path = p + comp_len;
+    if (comp_len >= len) {
+        return -1;
+    }
+
+    memcpy(buf, p, comp_len);
+    buf[comp_len] = '\0';
+    return 0;
+}
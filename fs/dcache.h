@@ -0,0 +1,72 @@
+#ifndef FS_DCACHE_H__
+#define FS_DCACHE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* results of dcache_lookup() */
+#define DCACHE_MISS         0   /* nothing known about the name */
+#define DCACHE_NEGATIVE     1   /* the name is known not to exist */
+#define DCACHE_POSITIVE     2   /* the name exists, its value is copied */
+
+struct dcache;
+
+/**
+ * @brief Create a cache of directory entries
+ *
+ * @param entry_max number of entries kept, the least recently used one is
+ *        dropped for a new one
+ * @param value_size size of the value stored with an existing name
+ * @return struct dcache* cache object, NULL if failed
+ *
+ * @details
+ *  Entries are keyed by the directory they are in, any number the filesystem
+ * identifies a directory with, and their name. Names are compared as they
+ * are, so they should be folded by the filesystem first.
+ */
+struct dcache* dcache_create(size_t entry_max, size_t value_size);
+
+/**
+ * @brief Delete a cache and every entry of it
+ *
+ * @param cache cache object
+ */
+void dcache_delete(struct dcache* cache);
+
+/**
+ * @brief Look up a name
+ *
+ * @param cache cache object
+ * @param parent key of the directory
+ * @param name name in the directory
+ * @param value output of the value, if the name exists
+ * @return int one of DCACHE_MISS, DCACHE_NEGATIVE and DCACHE_POSITIVE
+ */
+int dcache_lookup(struct dcache* cache, uint64_t parent, const char* name, void* value);
+
+/**
+ * @brief Add or replace an entry
+ *
+ * @param cache cache object
+ * @param parent key of the directory
+ * @param name name in the directory
+ * @param value value of the name, NULL if the name does not exist
+ * @return int 0 if succeed, nonzero otherwise
+ */
+int dcache_insert(struct dcache* cache, uint64_t parent, const char* name, const void* value);
+
+/**
+ * @brief Take the next component of a path
+ *
+ * @param path path, advanced past the component
+ * @param buf output of the component
+ * @param len size of the buffer
+ * @return int 0 if a component is taken, 1 at the end of the path, -1 if the
+ *         component does not fit in the buffer
+ *
+ * @details
+ *  Components are separated by '/', empty ones are skipped.
+ */
+int dcache_path_next(const char** path, char* buf, size_t len);
+
+#endif
@@ -1,7 +1,14 @@
 #ifndef FS_FAT_DEFAULTS_H__
 #define FS_FAT_DEFAULTS_H__
 
-#define DEFAULT_DISKBUF_ENTRY_COUNT     32
+#define DEFAULT_DISKBUF_ENTRY_COUNT     8
+#define DEFAULT_FAT_DISKBUF_COUNT       16
+#define DEFAULT_DIR_DISKBUF_COUNT       8
+#define DEFAULT_DISKBUF_HUGEPAGE        0
+#define DEFAULT_FAT_IN_MEMORY           0
+#define DEFAULT_MAX_IO_SIZE             (4 * 1024 * 1024)
+#define DEFAULT_DCACHE_COUNT            1024
+#define DEFAULT_CACHE_POLICY            OFSL_CACHE_LRU
 #define DEFAULT_LFN_ENABLED             1
 #define DEFAULT_READONLY                0
 #define DEFAULT_CODEPAGE                437
@@ -1,3 +1,6 @@
+/* MAP_ANONYMOUS, MAP_HUGETLB */
+#define _GNU_SOURCE
+
 #include <ofsl/fs/fat.h>
 
 #include <stdlib.h>
@@ -5,11 +8,13 @@
 #include <ctype.h>
 #include <time.h>
 #include <stdio.h>
+#include <sys/mman.h>
 
 #include <ofsl/drive/drive.h>
 #include <ofsl/time.h>
 
 #include "endian.h"
+#include "fs/dcache.h"
 #include "fs/fat/config.h"
 #include "fs/fat/internal.h"
 #include "fs/fat/defaults.h"
@@ -18,11 +23,19 @@
 #define DISKBUF_TYPE_SECTOR     0
 #define DISKBUF_TYPE_CLUSTER    1
 
-#define USAGE_TAG_MAX           8191
+#define DISKBUF_QUEUE_A1IN      0   /* entries referenced once, in FIFO order */
+#define DISKBUF_QUEUE_AM        1   /* entries referenced again, in LRU order */
+
+#define DISKBUF_POOL_FAT        0   /* sectors of the FAT */
+#define DISKBUF_POOL_DIR        1   /* directories and the other sectors */
+#define DISKBUF_POOL_DATA       2   /* file data */
+#define DISKBUF_POOL_COUNT      3
 
-#define SHOULD_REALLOC  0
-#define SHOULD_ALLOC    1
-#define CACHED          2
+#define DISKBUF_SLAB_SECTOR     0   /* slots of the FAT pool */
+#define DISKBUF_SLAB_CLUSTER    1   /* slots of the other pools */
+#define DISKBUF_SLAB_COUNT      2
+
+#define HUGEPAGE_SIZE           (2 * 1024 * 1024)
 
 #define test_bitfield(value, mask) (((value) & (mask)) == (mask))
 
@@ -30,12 +43,52 @@ struct diskbuf_entry {
     uint16_t type : 1;
     uint16_t dirty : 1;
     uint16_t data_valid : 1;
-    uint16_t usage_tag : 13;
+    uint16_t queue : 1;
+    uint16_t pool : 2;
+    unsigned int index;                 /* slot in fs->diskbuf */
+    struct diskbuf_entry* hash_next;
+    struct diskbuf_entry* lru_prev;
+    struct diskbuf_entry* lru_next;
     union {
         fatcluster_t cluster;
         lba_t lba;
     };
-    uint8_t data[];
+    uint8_t* data;  /* points to buf or to the memory mapped by the drive */
+    uint8_t* buf;   /* slot of the entry in a slab */
+};
+
+/* buffers of the same size carved from one allocation */
+struct diskbuf_slab {
+    uint8_t* mem;
+    size_t len;
+    size_t stride;                      /* buffer size rounded to the alignment */
+    uint8_t hugepage : 1;               /* mapped with huge pages */
+};
+
+struct diskbuf_queue {
+    struct diskbuf_entry* head;         /* most recently inserted or used */
+    struct diskbuf_entry* tail;
+    unsigned int count;
+};
+
+/* key of an entry recently evicted from A1in */
+struct diskbuf_ghost {
+    uint8_t type : 1;
+    uint8_t valid : 1;
+    uint64_t key;
+    struct diskbuf_ghost* hash_next;
+};
+
+/* entries replaced only by each other, in the slots from `base` */
+struct diskbuf_pool {
+    unsigned int base;
+    unsigned int count;
+    unsigned int used;                  /* slots filled so far */
+    struct diskbuf_queue queue[2];
+    unsigned int a1in_max;
+    struct diskbuf_ghost* ghost;        /* ring of A1out, NULL unless 2Q */
+    unsigned int ghost_max;
+    unsigned int ghost_pos;             /* oldest ghost */
 };
 
 enum error_fat {
@@ -49,7 +102,14 @@ static const char* error_str_list[] = {
 struct fs_fat {
     OFSL_FileSystem fs;
     OFSL_Partition part;
-    struct diskbuf_entry** diskbuf;
+    struct diskbuf_entry** diskbuf;     /* NULL until the slot is used */
+    struct diskbuf_entry* diskbuf_entries;
+    unsigned int diskbuf_count;         /* slots of every pool */
+    struct diskbuf_slab diskbuf_slab[DISKBUF_SLAB_COUNT];
+    struct diskbuf_entry** diskbuf_hash;
+    struct diskbuf_ghost** diskbuf_ghost_hash;  /* NULL unless 2Q */
+    unsigned int diskbuf_hash_bits;
+    struct diskbuf_pool diskbuf_pool[DISKBUF_POOL_COUNT];
     char        volume_label[FAT_FILENAME_BUF_LEN];
     uint32_t    volume_serial;
     uint16_t    reserved_sectors;
@@ -66,9 +126,33 @@ struct fs_fat {
     uint32_t    root_cluster;
     uint16_t    root_entry_count;
     uint16_t    root_sector_count;
+    struct extent_map* extent_maps;     /* maps of the open files */
+    void*       fat_table;              /* whole FAT, NULL unless fat_in_memory */
+    uint32_t    fat_entry_count;
+    uint32_t    cluster_count;          /* clusters of the data area */
+    uint64_t*   free_bitmap;            /* set bits are free clusters, NULL until built */
+    struct dcache* dcache;              /* entries by directory head cluster, NULL if disabled */
     struct ofsl_fs_fat_option options;
 };
 
+/* physically contiguous run of clusters in a chain */
+struct fat_extent {
+    uint32_t logical;                   /* index of the first cluster in the chain */
+    fatcluster_t physical;              /* first cluster */
+    uint32_t length;                    /* number of clusters */
+};
+
+/* cluster chain of a file, shared by every handle opened on it */
+struct extent_map {
+    struct extent_map* next;
+    fatcluster_t head_cluster;
+    unsigned int refcnt;
+    uint32_t mapped;                    /* clusters of the chain mapped so far */
+    size_t extent_cnt;
+    size_t extent_max;
+    struct fat_extent* extents;         /* sorted by logical index */
+};
+
 struct file_fat {
     OFSL_File file;
     uint32_t head_cluster;
@@ -77,6 +161,21 @@ struct file_fat {
     uint8_t direntry_idx;
     struct fat_direntry_file direntry;
     uint32_t cursor;
+    struct extent_map* extmap;          /* NULL if the file has no cluster */
+};
+
+/* entry of a directory found by its folded name */
+struct name_index_entry {
+    struct name_index_entry* hash_next;
+    uint64_t hash;
+    struct fat_direntry_file direntry;
+    char name[];
+};
+
+/* names of a directory, built on the first lookup */
+struct name_index {
+    struct name_index_entry** hash;
+    unsigned int hash_bits;
 };
 
 struct dir_fat {
@@ -84,6 +183,7 @@ struct dir_fat {
     uint32_t head_cluster;
     struct dir_fat* parent;
     uint32_t child_count;
+    struct name_index* name_index;      /* NULL until the first lookup */
     struct fat_direntry_file direntry;
 };
 
@@ -91,14 +191,17 @@ struct dirit_fat {
     OFSL_DirectoryIterator dirit;
     struct dir_fat* parent;
     uint32_t current_block_idx;
-    uint8_t current_entry_idx;
+    fatcluster_t current_cluster;       /* cluster of the current block */
+    uint16_t current_entry_idx;
     int valid;
+    int error;      /* stopped on an error rather than the end of entries */
     char filename[FAT_FILENAME_BUF_LEN];
     struct fat_direntry_file direntry;
 };
 
 static int read_fat(struct fs_fat*, unsigned int*, uint32_t);
 static int match_name(struct dir_fat*, const char*, struct fat_direntry_file*);
+static void free_name_index(struct dir_fat*);
 static int file_iseof(OFSL_File* file_opaque);
 
 static size_t
@@ -190,6 +293,55 @@ static int cluster_to_sector(struct fs_fat* fs, lba_t* lba, fatcluster_t cluster
     }
 }
 
+/**
+ * @brief Follow the cluster chain in the in-memory FAT
+ *
+ * @param fs filesystem object struct
+ * @param cluster cluster index, replaced with the one `num` hops later
+ * @param num number of hops
+ * @return int 0 if success, nonzero if the chain ended or is invalid
+ *
+ * @details
+ *  Behaves the same as the diskbuf path of get_next_cluster(). FAT12 entries
+ * are unpacked into 16-bit ones when the table is loaded.
+ */
+static int
+get_next_cluster_table(
+    struct fs_fat* fs,
+    fatcluster_t* cluster,
+    uint32_t num)
+{
+    fatcluster_t max_cluster;
+    switch (fs->fat_type) {
+        case FAT_TYPE_FAT12:
+            max_cluster = FAT12_MAX_CLUSTER;
+            break;
+        case FAT_TYPE_FAT16:
+            max_cluster = FAT16_MAX_CLUSTER;
+            break;
+        default:
+            max_cluster = FAT32_MAX_CLUSTER;
+            break;
+    }
+
+    while (num-- > 0) {
+        if (*cluster > max_cluster || *cluster >= fs->fat_entry_count) {
+            fs->fs.error = OFSL_FSE_ICLUSTER;
+            return 1;
+        }
+
+        if (fs->fat_type == FAT_TYPE_FAT32) {
+            *cluster = ((const uint32_t*)fs->fat_table)[*cluster];
+        } else {
+            *cluster = ((const uint16_t*)fs->fat_table)[*cluster];
+        }
+        if (*cluster > max_cluster) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 static int
 get_next_cluster(
     struct fs_fat* fs,
@@ -197,6 +349,10 @@ get_next_cluster(
     uint32_t num
 )
 {
+    if (fs->fat_table) {
+        return get_next_cluster_table(fs, cluster, num);
+    }
+
     switch (fs->fat_type) {
         case FAT_TYPE_FAT12:
             while (num-- > 0) {
@@ -210,14 +366,18 @@ get_next_cluster(
                 byte_idx %= fs->sector_size;
 
                 unsigned int entry_idx;
-                read_fat(fs, &entry_idx, sector_idx);
+                if (read_fat(fs, &entry_idx, sector_idx)) {
+                    return 1;
+                }
 
                 uint8_t fatentry_buf[2];
 
                 fatentry_buf[0] = fs->diskbuf[entry_idx]->data[byte_idx];
                 if (byte_idx == fs->sector_size - 1) {
                     unsigned int entry_idx;
-                    read_fat(fs, &entry_idx, sector_idx + 1);
+                    if (read_fat(fs, &entry_idx, sector_idx + 1)) {
+                        return 1;
+                    }
                     fatentry_buf[1] = fs->diskbuf[entry_idx]->data[0];
                 } else {
                     fatentry_buf[1] =
@@ -234,7 +394,7 @@ get_next_cluster(
                         ((fatentry_buf[1] & 0x0F) << 8);
                 }
 
-                if (*cluster > FAT16_MAX_CLUSTER) {
+                if (*cluster > FAT12_MAX_CLUSTER) {
                     return 1;
                 }
             }
@@ -251,7 +411,9 @@ get_next_cluster(
                 fatentry_idx %= fs->sector_size >> 1;
 
                 unsigned int entry_idx;
-                read_fat(fs, &entry_idx, sector_idx);
+                if (read_fat(fs, &entry_idx, sector_idx)) {
+                    return 1;
+                }
 
                 *cluster =
                     ((uint16_t*)fs->diskbuf[entry_idx]->data)[fatentry_idx];
@@ -271,7 +433,9 @@ get_next_cluster(
                 fatentry_idx %= fs->sector_size >> 2;
 
                 unsigned int entry_idx;
-                read_fat(fs, &entry_idx, sector_idx);
+                if (read_fat(fs, &entry_idx, sector_idx)) {
+                    return 1;
+                }
 
                 *cluster =
                     ((uint32_t*)fs->diskbuf[entry_idx]->data)[fatentry_idx];
@@ -294,108 +458,446 @@ static int flush_diskbuf_entry(struct fs_fat* fs, unsigned int entry) {
     }
 
     if (fs->diskbuf[entry]->dirty) {
+        lba_t lba = 0;
+        size_t cnt = 0;
         switch (fs->diskbuf[entry]->type) {
+            case DISKBUF_TYPE_CLUSTER:
+                if (cluster_to_sector(fs, &lba, fs->diskbuf[entry]->cluster)) {
+                    return 1;
+                }
+                cnt = fs->sectors_per_cluster;
+                break;
+            case DISKBUF_TYPE_SECTOR:
+                lba = fs->diskbuf[entry]->lba;
+                cnt = 1;
+                break;
+        }
+
+        if (ofsl_drive_write_sector(
+                fs->part.drv,
+                fs->diskbuf[entry]->data,
+                fs->part.lba_start + lba,
+                fs->sector_size,
+                cnt) != (ssize_t)cnt) {
+            /* stays dirty, so a later flush retries it */
+            return 1;
+        }
+        fs->diskbuf[entry]->dirty = 0;
+    }
+
+    return 0;
+}
+
+struct flush_item {
+    OFSL_DriveIOVec iov;
+    struct diskbuf_entry* entry;
+};
+
+static int compare_flush_item(const void* a, const void* b)
+{
+    const struct flush_item* item_a = a;
+    const struct flush_item* item_b = b;
+
+    if (item_a->iov.lba < item_b->iov.lba) return -1;
+    if (item_a->iov.lba > item_b->iov.lba) return 1;
+    return 0;
+}
+
+/**
+ * @brief Write back every dirty diskbuf entry
+ *
+ * @param fs filesystem object struct
+ * @return int 0 if succeed, nonzero otherwise
+ *
+ * @details
+ *  Dirty entries are sorted by their LBA address and submitted with a single
+ * vectored write, so the drive is able to merge adjacent entries into one
+ * request. Entries which were not completely written stay dirty.
+ */
+static int flush_diskbuf(struct fs_fat* fs)
+{
+    struct flush_item* items =
+        malloc(sizeof(struct flush_item) * fs->diskbuf_count);
+    OFSL_DriveIOVec* iov =
+        malloc(sizeof(OFSL_DriveIOVec) * fs->diskbuf_count);
+    if (!items || !iov) {
+        free(items);
+        free(iov);
+
+        /* flush entries one by one instead */
+        int ret = 0;
+        for (int i = 0; i < fs->diskbuf_count; i++) {
+            if (fs->diskbuf[i] && flush_diskbuf_entry(fs, i)) {
+                ret = 1;
+            }
+        }
+        return ret;
+    }
+
+    int ret = 0;
+    size_t iovcnt = 0;
+    for (int i = 0; i < fs->diskbuf_count; i++) {
+        struct diskbuf_entry* entry = fs->diskbuf[i];
+        if (!entry || !entry->dirty) continue;
+
+        switch (entry->type) {
             case DISKBUF_TYPE_CLUSTER: {
                 lba_t clus_head_lba = 0;
-                cluster_to_sector(
-                    fs,
-                    &clus_head_lba,
-                    fs->diskbuf[entry]->cluster);
-                ofsl_drive_write_sector(
-                    fs->part.drv,
-                    fs->diskbuf[entry]->data,
-                    fs->part.lba_start + clus_head_lba,
-                    fs->sector_size,
-                    fs->sectors_per_cluster);
-                fs->diskbuf[entry]->dirty = 0;
+                if (cluster_to_sector(fs, &clus_head_lba, entry->cluster)) {
+                    ret = 1;
+                    continue;
+                }
+                items[iovcnt].iov.lba = fs->part.lba_start + clus_head_lba;
+                items[iovcnt].iov.cnt = fs->sectors_per_cluster;
                 break;
             }
             case DISKBUF_TYPE_SECTOR:
-                ofsl_drive_write_sector(
-                    fs->part.drv,
-                    fs->diskbuf[entry]->data,
-                    fs->part.lba_start + fs->diskbuf[entry]->lba,
-                    fs->sector_size,
-                    1);
-                fs->diskbuf[entry]->dirty = 0;
+                items[iovcnt].iov.lba = fs->part.lba_start + entry->lba;
+                items[iovcnt].iov.cnt = 1;
                 break;
         }
+        items[iovcnt].iov.buf = entry->data;
+        items[iovcnt].entry = entry;
+        iovcnt++;
+    }
+
+    qsort(items, iovcnt, sizeof(struct flush_item), compare_flush_item);
+    for (size_t i = 0; i < iovcnt; i++) {
+        iov[i] = items[i].iov;
+    }
+
+    ssize_t written =
+        ofsl_drive_write_sectorv(fs->part.drv, iov, iovcnt, fs->sector_size);
+
+    /* the segments complete in order, so the written ones form a prefix */
+    for (size_t i = 0; i < iovcnt; i++) {
+        if (written < (ssize_t)items[i].iov.cnt) {
+            ret = 1;
+            break;
+        }
+        written -= items[i].iov.cnt;
+        items[i].entry->dirty = 0;
     }
 
-    fs->diskbuf[entry]->usage_tag = USAGE_TAG_MAX;
+    free(items);
+    free(iov);
+    return ret;
+}
 
-    return 0;
+static size_t
+diskbuf_hash_index(struct fs_fat* fs, unsigned int type, uint64_t key)
+{
+    return ((key << 1 | type) * UINT64_C(0x9E3779B97F4A7C15)) >>
+           (64 - fs->diskbuf_hash_bits);
+}
+
+static uint64_t diskbuf_entry_key(struct diskbuf_entry* entry)
+{
+    return entry->type == DISKBUF_TYPE_CLUSTER ? entry->cluster : entry->lba;
+}
+
+static struct diskbuf_entry*
+lookup_diskbuf_entry(struct fs_fat* fs, unsigned int type, uint64_t key)
+{
+    struct diskbuf_entry* entry =
+        fs->diskbuf_hash[diskbuf_hash_index(fs, type, key)];
+    while (entry && (entry->type != type || diskbuf_entry_key(entry) != key)) {
+        entry = entry->hash_next;
+    }
+    return entry;
+}
+
+static void diskbuf_hash_remove(struct fs_fat* fs, struct diskbuf_entry* entry)
+{
+    struct diskbuf_entry** link = &fs->diskbuf_hash[
+        diskbuf_hash_index(fs, entry->type, diskbuf_entry_key(entry))];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+}
+
+static void diskbuf_queue_unlink(struct fs_fat* fs, struct diskbuf_entry* entry)
+{
+    struct diskbuf_queue* queue =
+        &fs->diskbuf_pool[entry->pool].queue[entry->queue];
+
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        queue->head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        queue->tail = entry->lru_prev;
+    }
+    queue->count--;
+}
+
+static void
+diskbuf_queue_push_front(
+    struct fs_fat* fs,
+    struct diskbuf_entry* entry,
+    unsigned int queue_idx)
+{
+    struct diskbuf_queue* queue = &fs->diskbuf_pool[entry->pool].queue[queue_idx];
+
+    entry->queue = queue_idx;
+    entry->lru_prev = NULL;
+    entry->lru_next = queue->head;
+    if (queue->head) {
+        queue->head->lru_prev = entry;
+    } else {
+        queue->tail = entry;
+    }
+    queue->head = entry;
+    queue->count++;
 }
 
 /**
- * @brief Allocate diskbuf sector entry
+ * @brief Take the key out of the A1out ghost list if it is there
+ *
+ * @param fs filesystem object struct
+ * @param type DISKBUF_TYPE_SECTOR or DISKBUF_TYPE_CLUSTER
+ * @param key LBA address of the sector or cluster index
+ * @return int 1 if the key was found, 0 otherwise
+ */
+static int diskbuf_ghost_take(struct fs_fat* fs, unsigned int type, uint64_t key)
+{
+    if (!fs->diskbuf_ghost_hash) {
+        return 0;
+    }
+
+    struct diskbuf_ghost** link =
+        &fs->diskbuf_ghost_hash[diskbuf_hash_index(fs, type, key)];
+    while (*link && ((*link)->type != type || (*link)->key != key)) {
+        link = &(*link)->hash_next;
+    }
+    if (!*link) {
+        return 0;
+    }
+
+    (*link)->valid = 0;
+    *link = (*link)->hash_next;
+    return 1;
+}
+
+/**
+ * @brief Remember the key of an entry evicted from A1in
+ *
+ * @param fs filesystem object struct
+ * @param pool pool of the entry
+ * @param entry evicted entry
+ *
+ * @details
+ *  The ghost list is a ring, the oldest key is forgotten when it is full.
+ */
+static void
+diskbuf_ghost_add(
+    struct fs_fat* fs,
+    struct diskbuf_pool* pool,
+    struct diskbuf_entry* entry)
+{
+    struct diskbuf_ghost* ghost = &pool->ghost[pool->ghost_pos];
+    pool->ghost_pos = (pool->ghost_pos + 1) % pool->ghost_max;
+
+    if (ghost->valid) {
+        diskbuf_ghost_take(fs, ghost->type, ghost->key);
+    }
+
+    const size_t hidx =
+        diskbuf_hash_index(fs, entry->type, diskbuf_entry_key(entry));
+    ghost->type = entry->type;
+    ghost->key = diskbuf_entry_key(entry);
+    ghost->valid = 1;
+    ghost->hash_next = fs->diskbuf_ghost_hash[hidx];
+    fs->diskbuf_ghost_hash[hidx] = ghost;
+}
+
+/**
+ * @brief Allocate diskbuf entry
  * 
  * @param fs filesystem object struct
- * @param entry_idx entry index output (NULL if not needed)
- * @param lba LBA address of the sector
+ * @param entry_idx entry index output
+ * @param pool_idx DISKBUF_POOL_FAT, DISKBUF_POOL_DIR or DISKBUF_POOL_DATA
+ * @param type DISKBUF_TYPE_SECTOR or DISKBUF_TYPE_CLUSTER
+ * @param key LBA address of the sector or cluster index
  * @return int 0 if success, otherwise failed
  * 
  * @details
- *  This function finds, replaces, or allocates a diskbuf sector entry by the
- * given lba value and decreases the `usage_tag` member of each entries for
- * further entry replacement.
- *  Flushes old entry when replacement is required.
+ *  This function finds, replaces, or allocates a diskbuf entry by the given
+ * type and key. Entries are looked up in a hash table and kept in recency
+ * queues, so both hits and replacements take constant time.
+ *  A missed entry is placed in the given pool, or in the data pool if the
+ * given one has no slots. A pool only replaces its own entries, so reading
+ * file data never evicts the FAT sectors and the directories. An entry found
+ * in another pool is used where it is.
+ *  Until every slot of the pool is filled, a new slot is taken. After that, an
+ * entry chosen by the cache policy is flushed and replaced. The buffer of a
+ * slot is large enough for every type the pool holds, so it is never
+ * reallocated:
+ * - OFSL_CACHE_LRU: every entry is kept in the Am queue, and the least
+ *   recently used one is replaced.
+ * - OFSL_CACHE_2Q: a new entry goes to the A1in queue first. Hits in A1in do
+ *   not promote it, and once A1in holds more than a quarter of the slots its
+ *   oldest entry is replaced and remembered in the A1out ghost list. Only an
+ *   entry missed again while its key is in A1out goes to the Am queue. A
+ *   sequential scan thus cycles through A1in and leaves the entries in Am,
+ *   such as the FAT sectors and the directory clusters, in place.
  */
 static int
-allocate_diskbuf_sector_entry(
+allocate_diskbuf_entry(
     struct fs_fat* fs,
     unsigned int* entry_idx,
-    lba_t lba)
+    unsigned int pool_idx,
+    unsigned int type,
+    uint64_t key)
 {
-    unsigned int status = SHOULD_REALLOC;
-    int target_entry_idx = -1;
-    uint16_t usage_tag_min = USAGE_TAG_MAX;
+    const size_t hidx = diskbuf_hash_index(fs, type, key);
+
+    struct diskbuf_entry* entry = lookup_diskbuf_entry(fs, type, key);
+    if (entry) {
+        if (entry->queue == DISKBUF_QUEUE_AM &&
+            fs->diskbuf_pool[entry->pool].queue[DISKBUF_QUEUE_AM].head != entry) {
+            diskbuf_queue_unlink(fs, entry);
+            diskbuf_queue_push_front(fs, entry, DISKBUF_QUEUE_AM);
+        }
+        *entry_idx = entry->index;
+        return 0;
+    }
 
-    for (int i = 0; i < fs->options.diskbuf_count; i++) {
-        if (fs->diskbuf[i] == NULL) {
-            if (status < SHOULD_ALLOC) {
-                target_entry_idx = i;
-                status = SHOULD_ALLOC;
-            }
-        } else {
-            if ((fs->diskbuf[i]->type == DISKBUF_TYPE_SECTOR) &&
-                (fs->diskbuf[i]->lba == lba)) {
-                target_entry_idx = i;
-                status = CACHED;
-            } else if (
-                (fs->diskbuf[i]->usage_tag < usage_tag_min) &&
-                (status == SHOULD_REALLOC)) {
-                usage_tag_min = fs->diskbuf[i]->usage_tag;
-                target_entry_idx = i;
-            }
+    if (fs->diskbuf_pool[pool_idx].count == 0) {
+        pool_idx = DISKBUF_POOL_DATA;
+    }
+    struct diskbuf_pool* pool = &fs->diskbuf_pool[pool_idx];
 
-            if (fs->diskbuf[i]->usage_tag > 0) {
-                fs->diskbuf[i]->usage_tag--;
-            }
-        } 
+    unsigned int queue_idx = DISKBUF_QUEUE_AM;
+    if (pool->ghost && !diskbuf_ghost_take(fs, type, key)) {
+        queue_idx = DISKBUF_QUEUE_A1IN;
     }
 
-    if (status < CACHED) {
-        if (status == SHOULD_REALLOC) {
-            flush_diskbuf_entry(fs, target_entry_idx);
-            if (fs->diskbuf[target_entry_idx]->type != DISKBUF_TYPE_SECTOR) {
-                fs->diskbuf[target_entry_idx] = realloc(
-                    fs->diskbuf[target_entry_idx],
-                    sizeof(struct diskbuf_entry) + fs->sector_size);
-            }
+    if (pool->used < pool->count) {
+        entry = &fs->diskbuf_entries[pool->base + pool->used++];
+        fs->diskbuf[entry->index] = entry;
+    } else {
+        const struct diskbuf_queue* a1in = &pool->queue[DISKBUF_QUEUE_A1IN];
+        if (a1in->count > pool->a1in_max ||
+            (a1in->count > 0 && !pool->queue[DISKBUF_QUEUE_AM].tail)) {
+            entry = a1in->tail;
         } else {
-            fs->diskbuf[target_entry_idx] =
-                malloc(sizeof(struct diskbuf_entry) + fs->sector_size);
+            entry = pool->queue[DISKBUF_QUEUE_AM].tail;
         }
+        if (flush_diskbuf_entry(fs, entry->index)) {
+            return 1;
+        }
+        if (entry->queue == DISKBUF_QUEUE_A1IN) {
+            diskbuf_ghost_add(fs, pool, entry);
+        }
+        diskbuf_queue_unlink(fs, entry);
+        diskbuf_hash_remove(fs, entry);
+    }
+
+    entry->type = type;
+    entry->pool = pool_idx;
+    entry->dirty = 0;
+    entry->data_valid = 0;
+    if (type == DISKBUF_TYPE_CLUSTER) {
+        entry->cluster = key;
+    } else {
+        entry->lba = key;
+    }
+    entry->data = entry->buf;
+
+    entry->hash_next = fs->diskbuf_hash[hidx];
+    fs->diskbuf_hash[hidx] = entry;
+    diskbuf_queue_push_front(fs, entry, queue_idx);
+
+    *entry_idx = entry->index;
+    return 0;
+}
+
+/**
+ * @brief Allocate diskbuf sector entry
+ * 
+ * @param fs filesystem object struct
+ * @param entry_idx entry index output
+ * @param pool DISKBUF_POOL_FAT, DISKBUF_POOL_DIR or DISKBUF_POOL_DATA
+ * @param lba LBA address of the sector
+ * @return int 0 if success, otherwise failed
+ */
+static int
+allocate_diskbuf_sector_entry(
+    struct fs_fat* fs,
+    unsigned int* entry_idx,
+    unsigned int pool,
+    lba_t lba)
+{
+    return allocate_diskbuf_entry(fs, entry_idx, pool, DISKBUF_TYPE_SECTOR, lba);
+}
+
+/**
+ * @brief Load the data of a diskbuf entry from the drive
+ * 
+ * @param fs filesystem object struct
+ * @param entry entry index
+ * @param lba LBA address of the first sector on the drive
+ * @param cnt number of sectors
+ * @return int 0 if success, otherwise failed
+ * 
+ * @details
+ *  If the drive can map the sectors in memory, the entry points to the mapped
+ * data instead of copying it into the buffer of the entry.
+ */
+static int
+fill_diskbuf_entry(
+    struct fs_fat* fs,
+    unsigned int entry,
+    lba_t lba,
+    size_t cnt)
+{
+    const void* mapped = NULL;
+    if (fs->part.drv->drvinfo.sector_size == fs->sector_size) {
+        mapped = ofsl_drive_map_sector(fs->part.drv, lba, cnt);
+    }
 
-        fs->diskbuf[target_entry_idx]->type = DISKBUF_TYPE_SECTOR;
-        fs->diskbuf[target_entry_idx]->dirty = 0;
-        fs->diskbuf[target_entry_idx]->data_valid = 0;
-        fs->diskbuf[target_entry_idx]->lba = lba;
+    if (mapped) {
+        fs->diskbuf[entry]->data = (uint8_t*)mapped;
+    } else {
+        fs->diskbuf[entry]->data = fs->diskbuf[entry]->buf;
+        if (ofsl_drive_read_sector(
+                fs->part.drv,
+                fs->diskbuf[entry]->data,
+                lba,
+                fs->sector_size,
+                cnt) != (ssize_t)cnt) {
+            /* left invalid, so the next access reads it again */
+            fs->fs.error = OFSL_FSE_IO;
+            return 1;
+        }
     }
-    fs->diskbuf[target_entry_idx]->usage_tag = USAGE_TAG_MAX;
+    fs->diskbuf[entry]->data_valid = 1;
+
+    return 0;
+}
 
-    *entry_idx = target_entry_idx;
+/**
+ * @brief Copy the mapped data of a diskbuf entry into its own buffer
+ * 
+ * @param fs filesystem object struct
+ * @param entry entry index
+ * @return int 0 if success, otherwise failed
+ */
+static int detach_diskbuf_entry(struct fs_fat* fs, unsigned int entry)
+{
+    if (fs->diskbuf[entry]->data != fs->diskbuf[entry]->buf) {
+        memcpy(
+            fs->diskbuf[entry]->buf,
+            fs->diskbuf[entry]->data,
+            fs->diskbuf[entry]->type == DISKBUF_TYPE_CLUSTER ?
+                fs->cluster_size : fs->sector_size);
+        fs->diskbuf[entry]->data = fs->diskbuf[entry]->buf;
+    }
     return 0;
 }
 
@@ -404,22 +906,25 @@ allocate_diskbuf_sector_entry(
  * 
  * @param fs filesystem object struct
  * @param entry_idx entry index output (NULL if not needed)
+ * @param pool DISKBUF_POOL_FAT, DISKBUF_POOL_DIR or DISKBUF_POOL_DATA
  * @param lba LBA address of the sector
  * @return int 0 if success, otherwise failed
  */
-static int read_sector(struct fs_fat* fs, unsigned int* entry_idx, lba_t lba)
+static int
+read_sector(
+    struct fs_fat* fs,
+    unsigned int* entry_idx,
+    unsigned int pool,
+    lba_t lba)
 {
     unsigned int target_entry_idx;
-    allocate_diskbuf_sector_entry(fs, &target_entry_idx, lba);
+    if (allocate_diskbuf_sector_entry(fs, &target_entry_idx, pool, lba)) {
+        return 1;
+    }
 
-    if (!fs->diskbuf[target_entry_idx]->data_valid) {
-        ofsl_drive_read_sector(
-            fs->part.drv,
-            fs->diskbuf[target_entry_idx]->data,
-            fs->part.lba_start + lba,
-            fs->sector_size,
-            1);
-        fs->diskbuf[target_entry_idx]->data_valid = 1;
+    if (!fs->diskbuf[target_entry_idx]->data_valid &&
+        fill_diskbuf_entry(fs, target_entry_idx, fs->part.lba_start + lba, 1)) {
+        return 1;
     }
 
     if (entry_idx) {
@@ -433,6 +938,7 @@ static int read_sector(struct fs_fat* fs, unsigned int* entry_idx, lba_t lba)
  * 
  * @param fs filesystem object struct
  * @param entry_idx  entry index output (NULL if not needed)
+ * @param pool DISKBUF_POOL_FAT, DISKBUF_POOL_DIR or DISKBUF_POOL_DATA
  * @param buf sector data buffer. The size of the buffer should equal or greater
  *            than the size of the sector.
  * @param lba LBA address of the sector
@@ -443,6 +949,7 @@ static int read_sector(struct fs_fat* fs, unsigned int* entry_idx, lba_t lba)
  * buffer.
  * If you want to make changes in smaller units, follow these methods:
  * - Call read_sector() with desired lba and get entry index.
+ * - Call detach_diskbuf_entry() since the data may be mapped by the drive.
  * - Make changes to the data of the entry and set the dirty bit. e.g.
  *   `fs->diskbuf[entry_idx]->dirty = 1`
  * - The changes will be written to the disk when the entry is flushed.
@@ -451,12 +958,16 @@ static int
 write_sector(
     struct fs_fat* fs,
     unsigned int* entry_idx,
+    unsigned int pool,
     const void* buf,
     lba_t lba)
 {
     unsigned int target_entry_idx;
-    allocate_diskbuf_sector_entry(fs, &target_entry_idx, lba);
+    if (allocate_diskbuf_sector_entry(fs, &target_entry_idx, pool, lba)) {
+        return 1;
+    }
 
+    fs->diskbuf[target_entry_idx]->data = fs->diskbuf[target_entry_idx]->buf;
     memcpy(fs->diskbuf[target_entry_idx]->data, buf, fs->sector_size);
     fs->diskbuf[target_entry_idx]->dirty = 1;
 
@@ -470,71 +981,24 @@ write_sector(
  * @brief Allocate diskbuf cluster entry
  * 
  * @param fs filesystem object struct
- * @param entry_idx entry index output (NULL if not needed)
+ * @param entry_idx entry index output
+ * @param pool DISKBUF_POOL_DIR or DISKBUF_POOL_DATA
  * @param cluster cluster index
  * @return int 0 if success, otherwise failed
- * 
- * @details
- *  This function finds, replaces, or allocates a diskbuf cluster entry by the
- * given lba value and decreases the `usage_tag` member of each entries for
- * further entry replacement.
- *  Flushes old entry when replacement is required.
  */
 static int
 allocate_diskbuf_cluster_entry(
     struct fs_fat* fs,
     unsigned int* entry_idx,
+    unsigned int pool,
     fatcluster_t cluster)
 {
-    unsigned int status = SHOULD_REALLOC;
-    int target_entry_idx = -1;
-    uint16_t usage_tag_min = USAGE_TAG_MAX;
-
-    for (int i = 0; i < fs->options.diskbuf_count; i++) {
-        if (fs->diskbuf[i] == NULL) {
-            if (status < SHOULD_ALLOC) {
-                target_entry_idx = i;
-                status = SHOULD_ALLOC;
-            }
-        } else {
-            if ((fs->diskbuf[i]->type == DISKBUF_TYPE_CLUSTER) &&
-                (fs->diskbuf[i]->cluster == cluster)) {
-                target_entry_idx = i;
-                status = CACHED;
-            } else if (
-                (fs->diskbuf[i]->usage_tag < usage_tag_min) &&
-                (status == SHOULD_REALLOC)) {
-                usage_tag_min = fs->diskbuf[i]->usage_tag;
-                target_entry_idx = i;
-            }
-
-            if (fs->diskbuf[i]->usage_tag > 0) {
-                fs->diskbuf[i]->usage_tag--;
-            }
-        } 
-    }
-
-    if (status < CACHED) {
-        if (status == SHOULD_REALLOC) {
-            flush_diskbuf_entry(fs, target_entry_idx);
-            if (fs->diskbuf[target_entry_idx]->type != DISKBUF_TYPE_CLUSTER) {
-                fs->diskbuf[target_entry_idx] = realloc(
-                    fs->diskbuf[target_entry_idx],
-                    sizeof(struct diskbuf_entry) + fs->cluster_size);
-            }
-        } else {
-            fs->diskbuf[target_entry_idx] = 
-                malloc(sizeof(struct diskbuf_entry) + fs->cluster_size);
-        }
-        fs->diskbuf[target_entry_idx]->type = DISKBUF_TYPE_CLUSTER;
-        fs->diskbuf[target_entry_idx]->dirty = 0;
-        fs->diskbuf[target_entry_idx]->data_valid = 0;
-        fs->diskbuf[target_entry_idx]->cluster = cluster;
-    }
-    fs->diskbuf[target_entry_idx]->usage_tag = USAGE_TAG_MAX;
-
-    *entry_idx = target_entry_idx;
-    return 0;
+    return allocate_diskbuf_entry(
+        fs,
+        entry_idx,
+        pool,
+        DISKBUF_TYPE_CLUSTER,
+        cluster);
 }
 
 
@@ -543,6 +1007,7 @@ allocate_diskbuf_cluster_entry(
  * 
  * @param fs filesystem object struct
  * @param entry_idx entry index output (NULL if not needed)
+ * @param pool DISKBUF_POOL_DIR or DISKBUF_POOL_DATA
  * @param cluster cluster index
  * @return int 0 if success, otherwise failed
  */
@@ -550,22 +1015,26 @@ static int
 read_cluster(
     struct fs_fat* fs,
     unsigned int* entry_idx,
+    unsigned int pool,
     fatcluster_t cluster)
 {
     unsigned int target_entry_idx;
-    allocate_diskbuf_cluster_entry(fs, &target_entry_idx, cluster);
+    if (allocate_diskbuf_cluster_entry(fs, &target_entry_idx, pool, cluster)) {
+        return 1;
+    }
 
     lba_t lba = 0;
-    cluster_to_sector(fs, &lba, cluster);
+    if (cluster_to_sector(fs, &lba, cluster)) {
+        return 1;
+    }
 
-    if (!fs->diskbuf[target_entry_idx]->data_valid) {
-        ofsl_drive_read_sector(
-            fs->part.drv,
-            fs->diskbuf[target_entry_idx]->data,
+    if (!fs->diskbuf[target_entry_idx]->data_valid &&
+        fill_diskbuf_entry(
+            fs,
+            target_entry_idx,
             fs->part.lba_start + lba,
-            fs->sector_size,
-            fs->sectors_per_cluster);
-        fs->diskbuf[target_entry_idx]->data_valid = 1;
+            fs->sectors_per_cluster)) {
+        return 1;
     }
 
     if (entry_idx) {
@@ -579,6 +1048,7 @@ read_cluster(
  * 
  * @param fs filesystem object struct
  * @param entry_idx  entry index output (NULL if not needed)
+ * @param pool DISKBUF_POOL_DIR or DISKBUF_POOL_DATA
  * @param buf cluster data buffer. The size of the buffer should equal or
  *            greater than the size of the cluster in bytes.
  * @param cluster cluster index
@@ -589,6 +1059,7 @@ read_cluster(
  * buffer.
  * If you want to make changes in smaller units, follow these methods:
  * - Call read_cluster() with desired lba and get entry index.
+ * - Call detach_diskbuf_entry() since the data may be mapped by the drive.
  * - Make changes to the data of the entry and set the dirty bit. e.g.
  *   `fs->diskbuf[entry_idx]->dirty = 1`
  * - The changes will be written to the disk when the entry is flushed.
@@ -597,12 +1068,16 @@ static int
 write_cluster(
     struct fs_fat* fs,
     unsigned int* entry_idx,
+    unsigned int pool,
     const void* buf,
     lba_t lba)
 {
     unsigned int target_entry_idx;
-    allocate_diskbuf_cluster_entry(fs, &target_entry_idx, lba);
-
+    if (allocate_diskbuf_cluster_entry(fs, &target_entry_idx, pool, lba)) {
+        return 1;
+    }
+
+    fs->diskbuf[target_entry_idx]->data = fs->diskbuf[target_entry_idx]->buf;
     memcpy(fs->diskbuf[target_entry_idx]->data, buf, fs->cluster_size);
     fs->diskbuf[target_entry_idx]->dirty = 1;
 
@@ -618,7 +1093,11 @@ read_fat(
     unsigned int* entry_idx,
     uint32_t sector_idx)
 {
-    return read_sector(fs, entry_idx, fs->reserved_sectors + sector_idx);
+    return read_sector(
+        fs,
+        entry_idx,
+        DISKBUF_POOL_FAT,
+        fs->reserved_sectors + sector_idx);
 }
 
 static int validate_sfn(const char* str, size_t len)
@@ -828,20 +1307,465 @@ static const char* get_error_string(OFSL_FileSystem* fs_opaque)
     return error_str_list[-fs->fs.error - 1];
 }
 
-static int mount(OFSL_FileSystem* fs_opaque)
+/**
+ * @brief Allocate the buffers of a slab
+ *
+ * @param fs filesystem object struct
+ * @param slab slab to allocate
+ * @param count number of buffers
+ * @param size size of a buffer in bytes
+ * @return int 0 if success, otherwise failed
+ *
+ * @details
+ *  Large slabs are mapped with huge pages if the `diskbuf_hugepage` option is
+ * set and the system has them available, and allocated as usual otherwise.
+ */
+static int
+alloc_diskbuf_slab(
+    struct fs_fat* fs,
+    struct diskbuf_slab* slab,
+    unsigned int count,
+    size_t size)
 {
-    struct fs_fat* fs = (struct fs_fat*)fs_opaque;
+    const size_t align = fs->part.drv->drvinfo.buf_align;
+
+    slab->stride = align > 1 ? (size + align - 1) / align * align : size;
+    slab->len = slab->stride * count;
+    slab->mem = NULL;
+    slab->hugepage = 0;
+    if (count == 0) {
+        return 0;
+    }
+
+#ifdef MAP_HUGETLB
+    if (fs->options.diskbuf_hugepage && slab->len >= HUGEPAGE_SIZE) {
+        const size_t len =
+            (slab->len + HUGEPAGE_SIZE - 1) / HUGEPAGE_SIZE * HUGEPAGE_SIZE;
+        void* mem = mmap(
+            NULL,
+            len,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+            -1,
+            0);
+        if (mem != MAP_FAILED) {
+            slab->mem = mem;
+            slab->len = len;
+            slab->hugepage = 1;
+            return 0;
+        }
+    }
+#endif
+
+    slab->mem = ofsl_drive_alloc_buffer(fs->part.drv, slab->len);
+    return slab->mem == NULL;
+}
+
+static void free_diskbuf_slab(struct diskbuf_slab* slab)
+{
+    if (slab->hugepage) {
+        munmap(slab->mem, slab->len);
+    } else {
+        ofsl_drive_free_buffer(slab->mem);
+    }
+}
+
+static void free_diskbuf(struct fs_fat* fs)
+{
+    free(fs->diskbuf);
+    free(fs->diskbuf_entries);
+    free(fs->diskbuf_hash);
+    free(fs->diskbuf_ghost_hash);
+    for (int i = 0; i < DISKBUF_POOL_COUNT; i++) {
+        free(fs->diskbuf_pool[i].ghost);
+    }
+    for (int i = 0; i < DISKBUF_SLAB_COUNT; i++) {
+        free_diskbuf_slab(&fs->diskbuf_slab[i]);
+    }
+}
+
+/**
+ * @brief Allocate the slots, the hash tables and the pools of diskbuf
+ *
+ * @param fs filesystem object struct
+ * @return int 0 if success, otherwise failed
+ *
+ * @details
+ *  Pools are given their slots from the options. The FAT and the directory
+ * pools may have none, and the data pool takes their entries then.
+ *  Every buffer is carved from one of two slabs allocated here: the FAT pool
+ * only holds sectors and gets sector-sized buffers, the other pools get
+ * cluster-sized ones. The sector and cluster sizes must be known already.
+ */
+static int alloc_diskbuf(struct fs_fat* fs)
+{
+    if (fs->options.diskbuf_count == 0) {
+        return 1;
+    }
+
+    fs->diskbuf_pool[DISKBUF_POOL_FAT].count = fs->options.fat_diskbuf_count;
+    fs->diskbuf_pool[DISKBUF_POOL_DIR].count = fs->options.dir_diskbuf_count;
+    fs->diskbuf_pool[DISKBUF_POOL_DATA].count = fs->options.diskbuf_count;
+
+    int failed = 0;
+    fs->diskbuf_count = 0;
+    for (int i = 0; i < DISKBUF_POOL_COUNT; i++) {
+        struct diskbuf_pool* pool = &fs->diskbuf_pool[i];
+
+        pool->base = fs->diskbuf_count;
+        pool->used = 0;
+        memset(pool->queue, 0, sizeof(pool->queue));
+        pool->ghost = NULL;
+        if (fs->options.cache_policy == OFSL_CACHE_2Q && pool->count > 0) {
+            /* A1in takes a quarter of the slots, A1out remembers half of them */
+            pool->a1in_max = pool->count / 4 ? pool->count / 4 : 1;
+            pool->ghost_max = pool->count / 2 ? pool->count / 2 : 1;
+            pool->ghost_pos = 0;
+            pool->ghost = calloc(pool->ghost_max, sizeof(struct diskbuf_ghost));
+            failed |= !pool->ghost;
+        }
+        fs->diskbuf_count += pool->count;
+    }
+
+    fs->diskbuf = calloc(fs->diskbuf_count, sizeof(struct diskbuf_entry*));
+    fs->diskbuf_entries =
+        calloc(fs->diskbuf_count, sizeof(struct diskbuf_entry));
+
+    /* keep the load factor of the hash tables at most 1 */
+    fs->diskbuf_hash_bits = 1;
+    while ((1U << fs->diskbuf_hash_bits) < fs->diskbuf_count) {
+        fs->diskbuf_hash_bits++;
+    }
+    fs->diskbuf_hash = calloc(
+        (size_t)1 << fs->diskbuf_hash_bits,
+        sizeof(struct diskbuf_entry*));
+    fs->diskbuf_ghost_hash = NULL;
+    if (fs->options.cache_policy == OFSL_CACHE_2Q) {
+        fs->diskbuf_ghost_hash = calloc(
+            (size_t)1 << fs->diskbuf_hash_bits,
+            sizeof(struct diskbuf_ghost*));
+        failed |= !fs->diskbuf_ghost_hash;
+    }
+
+    const unsigned int fat_count = fs->diskbuf_pool[DISKBUF_POOL_FAT].count;
+    failed |= alloc_diskbuf_slab(
+        fs,
+        &fs->diskbuf_slab[DISKBUF_SLAB_SECTOR],
+        fat_count,
+        fs->sector_size);
+    failed |= alloc_diskbuf_slab(
+        fs,
+        &fs->diskbuf_slab[DISKBUF_SLAB_CLUSTER],
+        fs->diskbuf_count - fat_count,
+        fs->cluster_size);
+
+    if (failed || !fs->diskbuf || !fs->diskbuf_entries || !fs->diskbuf_hash) {
+        free_diskbuf(fs);
+        return 1;
+    }
+
+    for (unsigned int i = 0; i < fs->diskbuf_count; i++) {
+        const struct diskbuf_slab* slab = i < fat_count ?
+            &fs->diskbuf_slab[DISKBUF_SLAB_SECTOR] :
+            &fs->diskbuf_slab[DISKBUF_SLAB_CLUSTER];
+        const unsigned int slot = i < fat_count ? i : i - fat_count;
+
+        fs->diskbuf_entries[i].index = i;
+        fs->diskbuf_entries[i].buf = slab->mem + slot * slab->stride;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Get the number of units a single bulk read may span
+ *
+ * @param fs filesystem object struct
+ * @param unit_size size of a sector or a cluster
+ * @return size_t number of units within `max_io_size`, at least 1
+ */
+static size_t max_io_count(struct fs_fat* fs, size_t unit_size)
+{
+    if (fs->options.max_io_size == 0) {
+        return SIZE_MAX;
+    }
+    if (fs->options.max_io_size < unit_size) {
+        return 1;
+    }
+    return fs->options.max_io_size / unit_size;
+}
+
+/**
+ * @brief Unpack an entry of a FAT12 table
+ *
+ * @param fat packed entries, starting at an even-numbered one
+ * @param idx entry index from `fat`
+ * @return uint16_t entry value
+ */
+static uint16_t fat12_entry(const uint8_t* fat, uint32_t idx)
+{
+    const uint8_t* packed = fat + idx + (idx >> 1);
+    if (idx & 1) {  /* odd-numbered cluster */
+        return ((packed[0] & 0xF0) >> 4) | (packed[1] << 4);
+    } else {  /* even-numbered cluster */
+        return packed[0] | ((packed[1] & 0x0F) << 8);
+    }
+}
+
+/**
+ * @brief Read the first FAT into memory
+ *
+ * @param fs filesystem object struct
+ * @return int 0 if success, otherwise failed
+ *
+ * @details
+ *  The FAT is read with sequential requests of at most `max_io_size` bytes.
+ * FAT16 and FAT32 tables are used as read, FAT12 entries are unpacked into
+ * an array of 16-bit entries.
+ */
+static int load_fat_table(struct fs_fat* fs)
+{
+    const size_t fat_bytes = (size_t)fs->fat_size * fs->sector_size;
+    const size_t chunk_sectors = max_io_count(fs, fs->sector_size);
+
+    uint8_t* raw = ofsl_drive_alloc_buffer(fs->part.drv, fat_bytes);
+    if (!raw) {
+        return 1;
+    }
+
+    for (size_t done = 0; done < fs->fat_size; done += chunk_sectors) {
+        size_t cnt = fs->fat_size - done;
+        if (cnt > chunk_sectors) {
+            cnt = chunk_sectors;
+        }
+        if (ofsl_drive_read_sector(
+                fs->part.drv,
+                raw + done * fs->sector_size,
+                fs->part.lba_start + fs->reserved_sectors + done,
+                fs->sector_size,
+                cnt) != (ssize_t)cnt) {
+            ofsl_drive_free_buffer(raw);
+            return 1;
+        }
+    }
+
+    switch (fs->fat_type) {
+        case FAT_TYPE_FAT12: {
+            fs->fat_entry_count = fat_bytes * 2 / 3;
+            uint16_t* table = malloc(sizeof(uint16_t) * fs->fat_entry_count);
+            if (!table) {
+                ofsl_drive_free_buffer(raw);
+                return 1;
+            }
+            for (uint32_t i = 0; i < fs->fat_entry_count; i++) {
+                table[i] = fat12_entry(raw, i);
+            }
+            ofsl_drive_free_buffer(raw);
+            fs->fat_table = table;
+            return 0;
+        }
+        case FAT_TYPE_FAT16:
+            fs->fat_entry_count = fat_bytes / sizeof(uint16_t);
+            break;
+        default:
+            fs->fat_entry_count = fat_bytes / sizeof(uint32_t);
+            break;
+    }
+
+    fs->fat_table = raw;
+    return 0;
+}
+
+static void free_fat_table(struct fs_fat* fs)
+{
+    if (fs->fat_type == FAT_TYPE_FAT12) {
+        free(fs->fat_table);
+    } else {
+        ofsl_drive_free_buffer(fs->fat_table);
+    }
+    fs->fat_table = NULL;
+}
+
+/**
+ * @brief Mark the free clusters among 16-bit or 32-bit FAT entries
+ *
+ * @param bitmap free cluster bitmap
+ * @param entries FAT entries from `first`
+ * @param entry_size 2 for FAT16, 4 for FAT32
+ * @param first index of the first entry
+ * @param cnt number of entries
+ *
+ * @details
+ *  Entries are tested for zero eight bytes at a time, so runs of allocated
+ * clusters are skipped a word at a time and only words holding a free entry
+ * are looked into.
+ */
+static void
+scan_free_entries(
+    uint64_t* bitmap,
+    const uint8_t* entries,
+    unsigned int entry_size,
+    uint32_t first,
+    uint32_t cnt)
+{
+    /* the upper 4 bits of FAT32 entries are reserved */
+    const uint64_t mask = entry_size == 4 ? UINT64_C(0x0FFFFFFF0FFFFFFF) : UINT64_MAX;
+    const uint64_t high = entry_size == 4 ? UINT64_C(0x8000000080000000) : UINT64_C(0x8000800080008000);
+    const uint64_t low = ~high;
+    const uint32_t per_word = sizeof(uint64_t) / entry_size;
+
+    uint32_t i = 0;
+    while (i < cnt) {
+        if (cnt - i >= per_word) {
+            uint64_t word;
+            memcpy(&word, entries + (size_t)i * entry_size, sizeof(word));
+            word &= mask;
+            /* the top bit of every nonzero entry */
+            if (((((word & low) + low) | word) & high) == high) {
+                i += per_word;
+                continue;
+            }
+        }
+
+        const uint32_t end = cnt - i < per_word ? cnt : i + per_word;
+        for (; i < end; i++) {
+            uint32_t value;
+            if (entry_size == 4) {
+                memcpy(&value, entries + (size_t)i * 4, 4);
+                value &= 0x0FFFFFFF;
+            } else {
+                uint16_t value16;
+                memcpy(&value16, entries + (size_t)i * 2, 2);
+                value = value16;
+            }
+            if (value == 0) {
+                bitmap[(first + i) / 64] |= UINT64_C(1) << ((first + i) % 64);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Build the free cluster bitmap from the FAT
+ *
+ * @param fs filesystem object struct
+ * @return int 0 if success, otherwise failed
+ *
+ * @details
+ *  The in-memory FAT is scanned if there is one, otherwise the FAT is read
+ * with sequential requests of at most `max_io_size` bytes, bypassing diskbuf.
+ * The free cluster count of FSINFO is replaced with the counted one.
+ */
+static int build_free_bitmap(struct fs_fat* fs)
+{
+    const unsigned int entry_bits =
+        fs->fat_type == FAT_TYPE_FAT12 ? 12 :
+        fs->fat_type == FAT_TYPE_FAT16 ? 16 : 32;
+    const uint32_t fat_entries = (uint64_t)fs->fat_size * fs->sector_size * 8 / entry_bits;
+    const uint32_t end = fs->cluster_count + 2 < fat_entries ? fs->cluster_count + 2 : fat_entries;
+    const size_t word_cnt = ((size_t)fs->cluster_count + 2 + 63) / 64;
+
+    uint64_t* bitmap = calloc(word_cnt, sizeof(uint64_t));
+    if (!bitmap) {
+        return 1;
+    }
+
+    if (fs->fat_table) {
+        const unsigned int entry_size = fs->fat_type == FAT_TYPE_FAT32 ? 4 : 2;
+        scan_free_entries(
+            bitmap,
+            (const uint8_t*)fs->fat_table + 2 * entry_size,
+            entry_size,
+            2,
+            end - 2);
+    } else {
+        size_t chunk_sectors = max_io_count(fs, fs->sector_size);
+        if (chunk_sectors > fs->fat_size) {
+            chunk_sectors = fs->fat_size;
+        }
+        if (fs->fat_type == FAT_TYPE_FAT12) {
+            /* every 3 sectors hold a whole number of entries */
+            chunk_sectors = chunk_sectors < 3 ? 3 : chunk_sectors - chunk_sectors % 3;
+        }
+
+        uint8_t* chunk = ofsl_drive_alloc_buffer(fs->part.drv, chunk_sectors * fs->sector_size);
+        if (!chunk) {
+            free(bitmap);
+            return 1;
+        }
+
+        for (size_t done = 0; done < fs->fat_size; done += chunk_sectors) {
+            size_t cnt = fs->fat_size - done;
+            if (cnt > chunk_sectors) {
+                cnt = chunk_sectors;
+            }
+            if (ofsl_drive_read_sector(
+                    fs->part.drv,
+                    chunk,
+                    fs->part.lba_start + fs->reserved_sectors + done,
+                    fs->sector_size,
+                    cnt) != (ssize_t)cnt) {
+                ofsl_drive_free_buffer(chunk);
+                free(bitmap);
+                return 1;
+            }
 
-    fs->diskbuf =
-        calloc(fs->options.diskbuf_count, sizeof(struct diskbuf_entry*));
+            const uint32_t chunk_first = (uint64_t)done * fs->sector_size * 8 / entry_bits;
+            uint32_t lo = chunk_first < 2 ? 2 : chunk_first;
+            uint32_t hi = chunk_first + (uint64_t)cnt * fs->sector_size * 8 / entry_bits;
+            if (hi > end) {
+                hi = end;
+            }
+            if (lo >= hi) {
+                continue;
+            }
+
+            if (fs->fat_type == FAT_TYPE_FAT12) {
+                for (uint32_t i = lo; i < hi; i++) {
+                    if (fat12_entry(chunk, i - chunk_first) == 0) {
+                        bitmap[i / 64] |= UINT64_C(1) << (i % 64);
+                    }
+                }
+            } else {
+                const unsigned int entry_size = entry_bits / 8;
+                scan_free_entries(
+                    bitmap,
+                    chunk + (size_t)(lo - chunk_first) * entry_size,
+                    entry_size,
+                    lo,
+                    hi - lo);
+            }
+        }
+        ofsl_drive_free_buffer(chunk);
+    }
 
-    fs->sector_size = 512;
+    uint32_t free_cnt = 0;
+    for (size_t i = 0; i < word_cnt; i++) {
+        for (uint64_t word = bitmap[i]; word; word &= word - 1) {
+            free_cnt++;
+        }
+    }
+
+    fs->free_bitmap = bitmap;
+    fs->free_clusters = free_cnt;
+    return 0;
+}
 
-    /* Read sector 0 (BPB) */
-    unsigned int entry_idx;
-    read_sector(fs, &entry_idx, 0);
+static int mount(OFSL_FileSystem* fs_opaque)
+{
+    struct fs_fat* fs = (struct fs_fat*)fs_opaque;
 
-    const struct fat_bpb_sector* bpb = (void*)fs->diskbuf[entry_idx]->data;
+    /* Read sector 0 (BPB), before the disk buffer is sized from it */
+    struct fat_bpb_sector* bpb = ofsl_drive_alloc_buffer(fs->part.drv, 512);
+    if (!bpb) {
+        return 1;
+    }
+    if (ofsl_drive_read_sector(fs->part.drv, bpb, fs->part.lba_start, 512, 1) != 1 ||
+        bpb->bytes_per_sector < 512 ||
+        bpb->sectors_per_cluster == 0) {
+        ofsl_drive_free_buffer(bpb);
+        return 1;
+    }
 
     fs->sector_size = bpb->bytes_per_sector;
     fs->sectors_per_cluster = bpb->sectors_per_cluster;
@@ -860,6 +1784,7 @@ static int mount(OFSL_FileSystem* fs_opaque)
         fs->total_sector_count -
         (fs->data_area_begin + fs->root_sector_count);
     uint32_t cluster_count = data_sectors / fs->sectors_per_cluster;
+    fs->cluster_count = cluster_count;
 
     /* Determine FAT type */
     if (cluster_count < 4085) {
@@ -870,17 +1795,39 @@ static int mount(OFSL_FileSystem* fs_opaque)
         fs->fat_type = FAT_TYPE_FAT32;
     }
 
-    /* Read FSINFO if FAT32 */
     if (fs->fat_type == FAT_TYPE_FAT32) {
         fs->root_cluster = bpb->fat32.root_cluster;
+    } else {
+        /* root directory is placed before the data area */
+        fs->root_cluster = 0;
+    }
+    ofsl_drive_free_buffer(bpb);
+
+    if (alloc_diskbuf(fs)) {
+        return 1;
+    }
 
-        read_sector(fs, &entry_idx, 1);
+    /* Read FSINFO if FAT32 */
+    if (fs->fat_type == FAT_TYPE_FAT32) {
+        unsigned int entry_idx;
+        if (read_sector(fs, &entry_idx, DISKBUF_POOL_DIR, 1)) {
+            free_diskbuf(fs);
+            return 1;
+        }
         const struct fat_fsinfo* fsinfo = (void*)fs->diskbuf[entry_idx]->data;
 
         fs->free_clusters = fsinfo->free_clusters;
         fs->next_free_cluster = fsinfo->next_free_cluster;
     }
 
+    if (fs->options.fat_in_memory && load_fat_table(fs)) {
+        free_diskbuf(fs);
+        return 1;
+    }
+
+    /* path lookups go without the cache if it cannot be allocated */
+    fs->dcache = dcache_create(fs->options.dcache_count, sizeof(struct fat_direntry_file));
+
     fs->mounted = 1;
 
     return 0;
@@ -891,15 +1838,22 @@ static int unmount(OFSL_FileSystem* fs_opaque)
     struct fs_fat* fs = check_fs_mounted(fs_opaque);
     if (!fs) return 1;
 
-    for (int i = 0; i < fs->options.diskbuf_count; i++) {
-        if (fs->diskbuf[i] != NULL) {
-            free(fs->diskbuf[i]);
-        }
+    int ret = flush_diskbuf(fs);
+    if (ofsl_drive_flush(fs->part.drv)) {
+        ret = 1;
     }
-    free(fs->diskbuf);
+
+    free_diskbuf(fs);
+    if (fs->fat_table) {
+        free_fat_table(fs);
+    }
+    free(fs->free_bitmap);
+    fs->free_bitmap = NULL;
+    dcache_delete(fs->dcache);
+    fs->dcache = NULL;
     fs->mounted = 0;
 
-    return 0;
+    return ret;
 }
 
 static const char* get_fs_name(OFSL_FileSystem* fs_opaque)
@@ -934,6 +1888,7 @@ get_volume_string(
             fs->sector_size : fs->cluster_size;
     uint16_t entries_per_block = block_size / sizeof(union fat_dir_entry);
     uint32_t current_block_idx = 0;
+    fatcluster_t current_cluster = fs->root_cluster;
     uint16_t current_entry_idx = 0;
     union fat_dir_entry* entries;
     int entry_found = 0, end_seek = 0;
@@ -944,7 +1899,11 @@ get_volume_string(
 
     unsigned int diskbuf_entry_idx;
     while (!end_seek) {
-        if (current_block_idx >= entries_per_block) {
+        if (current_entry_idx >= entries_per_block) {
+            if ((fs->fat_type == FAT_TYPE_FAT32 || fs->root_cluster != 0) &&
+                get_next_cluster(fs, &current_cluster, 1)) {
+                break;
+            }
             current_block_idx++;
             current_entry_idx = 0;
         }
@@ -953,16 +1912,19 @@ get_volume_string(
         if (fs->fat_type != FAT_TYPE_FAT32 && fs->root_cluster == 0) {
             /* root directory */
             if (current_block_idx >= fs->root_sector_count) break;
-            read_sector(
+            if (read_sector(
+                    fs,
+                    &diskbuf_entry_idx,
+                    DISKBUF_POOL_DIR,
+                    fs->data_area_begin + current_block_idx)) {
+                return 1;
+            }
+        } else if (read_cluster(
                 fs,
                 &diskbuf_entry_idx,
-                fs->data_area_begin + current_block_idx);
-        } else {
-            fatcluster_t current_cluster = fs->root_cluster;
-            if (get_next_cluster(fs, &current_cluster, current_block_idx)) {
-                break;
-            }
-            read_cluster(fs, &diskbuf_entry_idx, current_cluster);
+                DISKBUF_POOL_DIR,
+                current_cluster)) {
+            return 1;
         }
         entries = (union fat_dir_entry*)fs->diskbuf[diskbuf_entry_idx]->data;
 
@@ -993,6 +1955,7 @@ get_volume_string(
                 break;
             } else {
                 /* root directory does not have volume id entry */
+                end_seek = 1;
                 break;
             }
             current_entry_idx++;
@@ -1019,7 +1982,7 @@ get_volume_string(
         }
     }
 
-    read_sector(fs, &diskbuf_entry_idx, 0);
+    if (read_sector(fs, &diskbuf_entry_idx, DISKBUF_POOL_DIR, 0)) return 1;
     const struct fat_bpb_sector* bpb =
         (void*)fs->diskbuf[diskbuf_entry_idx]->data;
 
@@ -1084,11 +2047,66 @@ static OFSL_Directory* rootdir_open(OFSL_FileSystem* fs_opaque)
     dir->dir.fs = (OFSL_FileSystem*)fs;
     dir->child_count = 0;
     dir->parent = NULL;
+    dir->name_index = NULL;
     dir->head_cluster = fs->fat_type == FAT_TYPE_FAT32 ? fs->root_cluster : 0;
 
     return (OFSL_Directory*)dir;
 }
 
+/**
+ * @brief Get the head cluster of the directory an entry points to
+ *
+ * @param fs filesystem object struct
+ * @param dirent directory entry
+ * @return fatcluster_t head cluster, as dir_fat keeps it
+ *
+ * @details
+ *  ".." entries of the subdirectories of the root directory hold 0, even on
+ * FAT32 whose root directory is a cluster chain.
+ */
+static fatcluster_t
+dir_head_cluster(struct fs_fat* fs, const struct fat_direntry_file* dirent)
+{
+    const fatcluster_t cluster =
+        ((fatcluster_t)dirent->cluster_location_high << 16) | dirent->cluster_location;
+
+    if (cluster == 0 && fs->fat_type == FAT_TYPE_FAT32) {
+        return fs->root_cluster;
+    }
+    return cluster;
+}
+
+/**
+ * @brief Create a directory object of an entry
+ *
+ * @param fs filesystem object struct
+ * @param parent directory the entry is in, NULL if opened by path
+ * @param dirent directory entry
+ * @return OFSL_Directory* directory object, NULL if failed
+ */
+static OFSL_Directory*
+open_dir_entry(
+    struct fs_fat* fs,
+    struct dir_fat* parent,
+    const struct fat_direntry_file* dirent)
+{
+    struct dir_fat* dir = malloc(sizeof(struct dir_fat));
+    if (!dir) return NULL;
+    dir->dir.ops = fs->fs.ops;
+    dir->dir.fs = (OFSL_FileSystem*)fs;
+    dir->head_cluster = dir_head_cluster(fs, dirent);
+    dir->parent = parent;
+    dir->child_count = 0;
+    dir->name_index = NULL;
+    memcpy(&dir->direntry, dirent, sizeof(*dirent));
+
+    if (parent) {
+        parent->child_count++;
+    }
+
+    return (OFSL_Directory*)dir;
+}
+
 static OFSL_Directory* dir_open(OFSL_Directory* parent_opaque, const char* name)
 {
     struct dir_fat* parent = check_dir(parent_opaque);
@@ -1102,20 +2120,7 @@ static OFSL_Directory* dir_open(OFSL_Directory* parent_opaque, const char* name)
         return NULL;
     }
 
-    const uint16_t head_cluster_lo = dirent.cluster_location;
-    const uint16_t head_cluster_hi = dirent.cluster_location_high;
-    const uint32_t head_cluster = (head_cluster_hi << 16) | head_cluster_lo;
-
-    struct dir_fat* dir = malloc(sizeof(struct dir_fat));
-    dir->dir.ops = fs->fs.ops;
-    dir->dir.fs = parent->dir.fs;
-    dir->head_cluster = head_cluster;
-    dir->parent = parent;
-    memcpy(&dir->direntry, &dirent, sizeof(dirent));
-
-    parent->child_count++;
-
-    return (OFSL_Directory*)dir;
+    return open_dir_entry(fs, parent, &dirent);
 }
 
 static int dir_close(OFSL_Directory* dir_opaque)
@@ -1129,6 +2134,7 @@ static int dir_close(OFSL_Directory* dir_opaque)
         parent->child_count--;
     }
 
+    free_name_index(dir);
     free(dir);
     return 0;
 }
@@ -1145,7 +2151,9 @@ static OFSL_DirectoryIterator* dir_iter_start(OFSL_Directory* dir_opaque)
     it->dirit.ops = fs->fs.ops;
     it->parent = dir;
     it->valid = 0;
+    it->error = 0;
     it->current_block_idx = 0;
+    it->current_cluster = dir->head_cluster;
     it->current_entry_idx = 0;
 
     return (OFSL_DirectoryIterator*)it;
@@ -1172,7 +2180,17 @@ static int dir_iter_next(OFSL_DirectoryIterator* it_opaque)
 
     unsigned int diskbuf_entry_idx;
     while (!entry_found) {
-        if (it->current_block_idx >= entries_per_block) {
+        if (it->current_entry_idx >= entries_per_block) {
+            if (fs->fat_type == FAT_TYPE_FAT32 || dir->head_cluster != 0) {
+                /* one hop from the current cluster, kept on the end of chain */
+                fatcluster_t next_cluster = it->current_cluster;
+                if (get_next_cluster(fs, &next_cluster, 1)) {
+                    /* the cluster is replaced only if the end was read */
+                    it->error = next_cluster == it->current_cluster;
+                    return 1;
+                }
+                it->current_cluster = next_cluster;
+            }
             it->current_block_idx++;
             it->current_entry_idx = 0;
         }
@@ -1181,16 +2199,21 @@ static int dir_iter_next(OFSL_DirectoryIterator* it_opaque)
         if (fs->fat_type != FAT_TYPE_FAT32 && dir->head_cluster == 0) {
             /* root directory */
             if (it->current_block_idx >= fs->root_sector_count) return 1;
-            read_sector(
-                fs,
-                &diskbuf_entry_idx,
-                fs->data_area_begin + it->current_block_idx);
-        } else {
-            fatcluster_t current_cluster = dir->head_cluster;
-            if (get_next_cluster(fs, &current_cluster, it->current_block_idx)) {
+            if (read_sector(
+                    fs,
+                    &diskbuf_entry_idx,
+                    DISKBUF_POOL_DIR,
+                    fs->data_area_begin + it->current_block_idx)) {
+                it->error = 1;
                 return 1;
             }
-            read_cluster(fs, &diskbuf_entry_idx, current_cluster);
+        } else if (read_cluster(
+                fs,
+                &diskbuf_entry_idx,
+                DISKBUF_POOL_DIR,
+                it->current_cluster)) {
+            it->error = 1;
+            return 1;
         }
         entries = (union fat_dir_entry*)fs->diskbuf[diskbuf_entry_idx]->data;
 
@@ -1348,52 +2371,525 @@ static int dir_iter_get_size(OFSL_DirectoryIterator* it_opaque, size_t* size)
     return 0;
 }
 
-static int
-match_name(
-    struct dir_fat* parent,
-    const char* name,
-    struct fat_direntry_file* direntry_buf)
+/**
+ * @brief Fold a file name the way names are compared
+ *
+ * @param fs filesystem object struct
+ * @param dest output buffer of FAT_FILENAME_BUF_LEN bytes
+ * @param name file name
+ * @return int 0 if success, nonzero if the name does not fit in the buffer
+ *
+ * @details
+ *  Names are kept as they are if `case_sensitive` is set, otherwise they are
+ * converted to upper case with the table of the codepage.
+ */
+static int fold_name(struct fs_fat* fs, char* dest, const char* name)
 {
-    if (!parent) return 0;
-    struct fs_fat* fs = check_fs_mounted(parent->dir.fs);
-    int match = 0;
+    const char* uctable = fs->options.case_sensitive ?
+        NULL : (const char*)get_uppercase_table(fs->options.codepage);
 
-    struct dirit_fat* it =
-        (struct dirit_fat*)dir_iter_start((OFSL_Directory*)parent);
-    while (!dir_iter_next((OFSL_DirectoryIterator*)it)) {
-        if (fs->options.case_sensitive) {
-            if (strncmp(name, it->filename, sizeof(it->filename)) == 0) {
-                match = 1;
-                goto cmp_end;
-            }
+    for (size_t i = 0; i < FAT_FILENAME_BUF_LEN; i++) {
+        if (!uctable) {
+            dest[i] = name[i];
         } else {
-            const char* uctable = (const char*)get_uppercase_table(fs->options.codepage);
-            for (int i = 0; i < sizeof(it->filename); i++) {
-                char a, b;
-                a = (uint8_t)name[i] >= 0x80 ?
-                        uctable[(uint8_t)name[i] - 0x80] :
-                        toupper(name[i]);
-                b = (uint8_t)it->filename[i] >= 0x80 ?
-                        uctable[(uint8_t)it->filename[i] - 0x80] :
-                        toupper(it->filename[i]);
-                if (a != b) {
-                    break;
-                } else if (!a) {
-                    match = 1;
-                    goto cmp_end;
-                }
-            }
+            dest[i] = (uint8_t)name[i] >= 0x80 ?
+                uctable[(uint8_t)name[i] - 0x80] :
+                toupper(name[i]);
         }
+        if (!name[i]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint64_t hash_name(const char* name)
+{
+    /* FNV-1a */
+    uint64_t hash = UINT64_C(0xCBF29CE484222325);
+    for (; *name; name++) {
+        hash = (hash ^ (uint8_t)*name) * UINT64_C(0x100000001B3);
+    }
+    return hash;
+}
+
+static size_t name_hash_index(const struct name_index* index, uint64_t hash)
+{
+    return (hash * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - index->hash_bits);
+}
+
+static struct name_index_entry*
+lookup_name_index(const struct name_index* index, const char* folded, uint64_t hash)
+{
+    struct name_index_entry* entry = index->hash[name_hash_index(index, hash)];
+    while (entry && (entry->hash != hash || strcmp(entry->name, folded) != 0)) {
+        entry = entry->hash_next;
+    }
+    return entry;
+}
+
+static void free_name_index(struct dir_fat* dir)
+{
+    struct name_index* index = dir->name_index;
+    if (!index) return;
+
+    for (size_t i = 0; i < ((size_t)1 << index->hash_bits); i++) {
+        struct name_index_entry* entry = index->hash[i];
+        while (entry) {
+            struct name_index_entry* next = entry->hash_next;
+            free(entry);
+            entry = next;
+        }
+    }
+    free(index->hash);
+    free(index);
+    dir->name_index = NULL;
+}
+
+/**
+ * @brief Index the names of a directory
+ *
+ * @param fs filesystem object struct
+ * @param dir directory object struct
+ * @return int 0 if success, otherwise failed
+ *
+ * @details
+ *  The directory is iterated once and every name is stored folded with a
+ * copy of its entry. The first entry of a name wins, as with a linear scan.
+ * Nothing is kept if the iteration stops on an error.
+ */
+static int build_name_index(struct fs_fat* fs, struct dir_fat* dir)
+{
+    struct dirit_fat* it =
+        (struct dirit_fat*)dir_iter_start((OFSL_Directory*)dir);
+    if (!it) return 1;
+
+    /* collect the entries first to size the table */
+    struct name_index_entry* list = NULL;
+    size_t entry_cnt = 0;
+    char folded[FAT_FILENAME_BUF_LEN];
+    int ret = 0;
+
+    while (!dir_iter_next((OFSL_DirectoryIterator*)it)) {
+        fold_name(fs, folded, it->filename);
+        const size_t name_len = strlen(folded) + 1;
+
+        struct name_index_entry* entry =
+            malloc(sizeof(struct name_index_entry) + name_len);
+        if (!entry) {
+            ret = 1;
+            break;
+        }
+        entry->hash = hash_name(folded);
+        memcpy(&entry->direntry, &it->direntry, sizeof(entry->direntry));
+        memcpy(entry->name, folded, name_len);
+        entry->hash_next = list;
+        list = entry;
+        entry_cnt++;
+    }
+    if (it->error) {
+        /* a partial index would answer the missing names as absent */
+        ret = 1;
+    }
+    dir_iter_end((OFSL_DirectoryIterator*)it);
+
+    struct name_index* index = NULL;
+    if (!ret) {
+        index = malloc(sizeof(struct name_index));
     }
+    if (index) {
+        /* keep the load factor of the hash table at most 1 */
+        index->hash_bits = 1;
+        while (((size_t)1 << index->hash_bits) < entry_cnt) {
+            index->hash_bits++;
+        }
+        index->hash = calloc((size_t)1 << index->hash_bits, sizeof(struct name_index_entry*));
+        if (!index->hash) {
+            free(index);
+            index = NULL;
+        }
+    }
+    if (!index) {
+        while (list) {
+            struct name_index_entry* next = list->hash_next;
+            free(list);
+            list = next;
+        }
+        return 1;
+    }
+
+    /* the list is in reverse order, so later duplicates are replaced */
+    while (list) {
+        struct name_index_entry* entry = list;
+        list = entry->hash_next;
+
+        struct name_index_entry** link = &index->hash[name_hash_index(index, entry->hash)];
+        while (*link && ((*link)->hash != entry->hash || strcmp((*link)->name, entry->name) != 0)) {
+            link = &(*link)->hash_next;
+        }
+        if (*link) {
+            entry->hash_next = (*link)->hash_next;
+            free(*link);
+        } else {
+            entry->hash_next = NULL;
+        }
+        *link = entry;
+    }
+
+    dir->name_index = index;
+    return 0;
+}
+
+/**
+ * @brief Scan a directory for a name
+ *
+ * @param fs filesystem object struct
+ * @param dir directory object struct
+ * @param folded name folded by fold_name()
+ * @param direntry_buf output of the entry found
+ * @return int 1 if found, 0 if not, -1 if the directory could not be read
+ */
+static int
+scan_name(
+    struct fs_fat* fs,
+    struct dir_fat* dir,
+    const char* folded,
+    struct fat_direntry_file* direntry_buf)
+{
+    char it_folded[FAT_FILENAME_BUF_LEN];
+    int match = 0;
 
-cmp_end:
-    if (match) {
-        memcpy(direntry_buf, &it->direntry, sizeof(*direntry_buf));
+    struct dirit_fat* it =
+        (struct dirit_fat*)dir_iter_start((OFSL_Directory*)dir);
+    while (!dir_iter_next((OFSL_DirectoryIterator*)it)) {
+        fold_name(fs, it_folded, it->filename);
+        if (strcmp(folded, it_folded) == 0) {
+            match = 1;
+            memcpy(direntry_buf, &it->direntry, sizeof(*direntry_buf));
+            break;
+        }
+    }
+    if (!match && it->error) {
+        match = -1;
     }
     dir_iter_end((OFSL_DirectoryIterator*)it);
     return match;
 }
 
+/**
+ * @brief Find an entry of a directory by its name
+ *
+ * @param parent directory object struct
+ * @param name file name
+ * @param direntry_buf output of the entry found
+ * @return int 1 if found, 0 otherwise
+ *
+ * @details
+ *  Lookups are answered by the name index of the directory, which is built
+ * on the first one. The directory is scanned if the index cannot be built.
+ */
+static int
+match_name(
+    struct dir_fat* parent,
+    const char* name,
+    struct fat_direntry_file* direntry_buf)
+{
+    if (!parent) return 0;
+    struct fs_fat* fs = check_fs_mounted(parent->dir.fs);
+
+    char folded[FAT_FILENAME_BUF_LEN];
+    if (fold_name(fs, folded, name)) {
+        /* longer than any name in the directory */
+        return 0;
+    }
+
+    if (parent->name_index || !build_name_index(fs, parent)) {
+        const struct name_index_entry* entry =
+            lookup_name_index(parent->name_index, folded, hash_name(folded));
+        if (entry) {
+            memcpy(direntry_buf, &entry->direntry, sizeof(*direntry_buf));
+        }
+        return entry != NULL;
+    }
+
+    return scan_name(fs, parent, folded, direntry_buf) > 0;
+}
+
+/**
+ * @brief Find an entry of a directory through the dentry cache
+ *
+ * @param fs filesystem object struct
+ * @param head_cluster head cluster of the directory
+ * @param folded name folded by fold_name()
+ * @param direntry_buf output of the entry found
+ * @return int 1 if found, 0 if not, -1 if the directory could not be read
+ *
+ * @details
+ *  Misses scan the directory, and the result is cached whether the name was
+ * found or not. A scan stopped by an error caches nothing.
+ */
+static int
+lookup_dentry(
+    struct fs_fat* fs,
+    fatcluster_t head_cluster,
+    const char* folded,
+    struct fat_direntry_file* direntry_buf)
+{
+    if (fs->dcache) {
+        switch (dcache_lookup(fs->dcache, head_cluster, folded, direntry_buf)) {
+            case DCACHE_POSITIVE:
+                return 1;
+            case DCACHE_NEGATIVE:
+                return 0;
+            default:
+                break;
+        }
+    }
+
+    struct dir_fat dir = {
+        .dir = { .ops = fs->fs.ops, .fs = (OFSL_FileSystem*)fs },
+        .head_cluster = head_cluster,
+    };
+    const int match = scan_name(fs, &dir, folded, direntry_buf);
+    if (match < 0) {
+        return -1;
+    }
+
+    if (fs->dcache) {
+        dcache_insert(fs->dcache, head_cluster, folded, match ? direntry_buf : NULL);
+    }
+    return match;
+}
+
+/**
+ * @brief Resolve a path from the root directory
+ *
+ * @param fs filesystem object struct
+ * @param path components separated by '/'
+ * @param direntry_buf output of the entry of the last component
+ * @return int 0 if resolved, 1 if the path names the root directory,
+ *         -1 if failed with the error set
+ */
+static int
+resolve_path(
+    struct fs_fat* fs,
+    const char* path,
+    struct fat_direntry_file* direntry_buf)
+{
+    fatcluster_t head_cluster =
+        fs->fat_type == FAT_TYPE_FAT32 ? fs->root_cluster : 0;
+    char name[FAT_FILENAME_BUF_LEN];
+    char folded[FAT_FILENAME_BUF_LEN];
+    int is_root = 1;
+
+    int ret;
+    while ((ret = dcache_path_next(&path, name, sizeof(name))) == 0) {
+        if (!is_root) {
+            if (!test_bitfield(direntry_buf->attribute, FAT_ATTR_DIRECTORY)) {
+                fs->fs.error = OFSL_FSE_NOENT;
+                return -1;
+            }
+            head_cluster = dir_head_cluster(fs, direntry_buf);
+        }
+
+        fold_name(fs, folded, name);
+        const int found = lookup_dentry(fs, head_cluster, folded, direntry_buf);
+        if (found <= 0) {
+            /* a read error keeps the error of the failed read */
+            if (found == 0) {
+                fs->fs.error = OFSL_FSE_NOENT;
+            }
+            return -1;
+        }
+        is_root = 0;
+    }
+    if (ret < 0) {
+        fs->fs.error = OFSL_FSE_IENTNAME;
+        return -1;
+    }
+
+    return is_root;
+}
+
+/**
+ * @brief Get the extent map of a file, creating it if no handle has one
+ *
+ * @param fs filesystem object struct
+ * @param head_cluster first cluster of the file
+ * @return struct extent_map* extent map, NULL if failed
+ *
+ * @details
+ *  A new map only holds the head cluster. It is extended by
+ * extend_extent_map() as the file is read, so opening a file never walks
+ * its chain.
+ */
+static struct extent_map*
+acquire_extent_map(struct fs_fat* fs, fatcluster_t head_cluster)
+{
+    struct extent_map* map = fs->extent_maps;
+    while (map && map->head_cluster != head_cluster) {
+        map = map->next;
+    }
+    if (map) {
+        map->refcnt++;
+        return map;
+    }
+
+    map = malloc(sizeof(struct extent_map));
+    if (!map) {
+        return NULL;
+    }
+    map->extent_max = 4;
+    map->extents = malloc(sizeof(struct fat_extent) * map->extent_max);
+    if (!map->extents) {
+        free(map);
+        return NULL;
+    }
+
+    map->head_cluster = head_cluster;
+    map->refcnt = 1;
+    map->mapped = 1;
+    map->extent_cnt = 1;
+    map->extents[0].logical = 0;
+    map->extents[0].physical = head_cluster;
+    map->extents[0].length = 1;
+
+    map->next = fs->extent_maps;
+    fs->extent_maps = map;
+    return map;
+}
+
+static void release_extent_map(struct fs_fat* fs, struct extent_map* map)
+{
+    if (--map->refcnt > 0) {
+        return;
+    }
+
+    struct extent_map** link = &fs->extent_maps;
+    while (*link != map) {
+        link = &(*link)->next;
+    }
+    *link = map->next;
+
+    free(map->extents);
+    free(map);
+}
+
+/**
+ * @brief Walk the cluster chain until the map covers the given clusters
+ *
+ * @param fs filesystem object struct
+ * @param map extent map
+ * @param cluster_cnt number of clusters from the head to map
+ * @return int 0 if success, otherwise failed
+ */
+static int
+extend_extent_map(
+    struct fs_fat* fs,
+    struct extent_map* map,
+    uint32_t cluster_cnt)
+{
+    while (map->mapped < cluster_cnt) {
+        struct fat_extent* last = &map->extents[map->extent_cnt - 1];
+        fatcluster_t cluster = last->physical + last->length - 1;
+        if (get_next_cluster(fs, &cluster, 1)) {
+            return 1;
+        }
+
+        if (cluster == last->physical + last->length) {
+            last->length++;
+        } else {
+            if (map->extent_cnt == map->extent_max) {
+                struct fat_extent* extents = realloc(
+                    map->extents,
+                    sizeof(struct fat_extent) * map->extent_max * 2);
+                if (!extents) {
+                    return 1;
+                }
+                map->extents = extents;
+                map->extent_max *= 2;
+            }
+
+            struct fat_extent* ext = &map->extents[map->extent_cnt++];
+            ext->logical = map->mapped;
+            ext->physical = cluster;
+            ext->length = 1;
+        }
+        map->mapped++;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Find the extent holding a mapped cluster with a binary search
+ *
+ * @param map extent map
+ * @param cluster_idx index of the cluster in the chain, less than `mapped`
+ * @return const struct fat_extent* extent holding the cluster
+ */
+static const struct fat_extent*
+find_extent(const struct extent_map* map, uint32_t cluster_idx)
+{
+    size_t lo = 0;
+    size_t hi = map->extent_cnt;
+
+    /* last extent starting at or before the cluster */
+    while (hi - lo > 1) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (map->extents[mid].logical <= cluster_idx) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return &map->extents[lo];
+}
+
+/**
+ * @brief Create a file object of an entry
+ *
+ * @param fs filesystem object struct
+ * @param parent directory the entry is in, NULL if opened by path
+ * @param dirent directory entry
+ * @return OFSL_File* file object, NULL if failed
+ */
+static OFSL_File*
+open_file_entry(
+    struct fs_fat* fs,
+    struct dir_fat* parent,
+    const struct fat_direntry_file* dirent)
+{
+    const uint16_t head_cluster_lo = dirent->cluster_location;
+    const uint16_t head_cluster_hi = dirent->cluster_location_high;
+    const uint32_t head_cluster = (head_cluster_hi << 16) | head_cluster_lo;
+
+    struct file_fat* file = malloc(sizeof(struct file_fat));
+    if (!file) return NULL;
+    file->file.ops = fs->fs.ops;
+    file->file.fs = (OFSL_FileSystem*)fs;
+    file->head_cluster = head_cluster;
+    file->parent = parent;
+    file->cursor = 0;
+    file->extmap = NULL;
+    memcpy(&file->direntry, dirent, sizeof(*dirent));
+
+    if (head_cluster != 0) {
+        file->extmap = acquire_extent_map(fs, head_cluster);
+        if (!file->extmap) {
+            free(file);
+            return NULL;
+        }
+    }
+
+    if (parent) {
+        parent->child_count++;
+    }
+
+    return (OFSL_File*)file;
+}
+
 static OFSL_File*
 file_open(
     OFSL_Directory* parent_opaque,
@@ -1411,21 +2907,50 @@ file_open(
         return NULL;
     }
 
-    const uint16_t head_cluster_lo = dirent.cluster_location;
-    const uint16_t head_cluster_hi = dirent.cluster_location_high;
-    const uint32_t head_cluster = (head_cluster_hi << 16) | head_cluster_lo;
+    return open_file_entry(fs, parent, &dirent);
+}
 
-    struct file_fat* file = malloc(sizeof(struct file_fat));
-    file->file.ops = fs->fs.ops;
-    file->file.fs = parent->dir.fs;
-    file->head_cluster = head_cluster;
-    file->parent = parent;
-    file->cursor = 0;
-    memcpy(&file->direntry, &dirent, sizeof(dirent));
+static OFSL_Directory* dir_open_path(OFSL_FileSystem* fs_opaque, const char* path)
+{
+    struct fs_fat* fs = check_fs_mounted(fs_opaque);
+    if (!fs) return NULL;
 
-    parent->child_count++;
+    struct fat_direntry_file dirent;
+    switch (resolve_path(fs, path, &dirent)) {
+        case 0:
+            break;
+        case 1:
+            return rootdir_open(fs_opaque);
+        default:
+            return NULL;
+    }
 
-    return (OFSL_File*)file;
+    if (!test_bitfield(dirent.attribute, FAT_ATTR_DIRECTORY)) {
+        fs->fs.error = OFSL_FSE_NOENT;
+        return NULL;
+    }
+    return open_dir_entry(fs, NULL, &dirent);
+}
+
+static OFSL_File*
+file_open_path(
+    OFSL_FileSystem* fs_opaque,
+    const char* path,
+    const char* mode)
+{
+    struct fs_fat* fs = check_fs_mounted(fs_opaque);
+    if (!fs) return NULL;
+
+    struct fat_direntry_file dirent;
+    switch (resolve_path(fs, path, &dirent)) {
+        case 0:
+            return open_file_entry(fs, NULL, &dirent);
+        case 1:
+            fs->fs.error = OFSL_FSE_NOENT;
+            return NULL;
+        default:
+            return NULL;
+    }
 }
 
 static int file_close(OFSL_File* file_opaque)
@@ -1433,14 +2958,120 @@ static int file_close(OFSL_File* file_opaque)
     struct file_fat* file = check_file(file_opaque);
     if (!file) return 1;
     struct dir_fat* parent = file->parent;
-    if (!parent) return 1;
 
-    parent->child_count--;
+    /* files opened by path have no parent */
+    if (parent) {
+        parent->child_count--;
+    }
 
+    if (file->extmap) {
+        release_extent_map((struct fs_fat*)file->file.fs, file->extmap);
+    }
     free(file);
     return 0;
 }
 
+/**
+ * @brief Read a range of a file from the current cursor
+ *
+ * @param fs filesystem object struct
+ * @param file file object struct
+ * @param buf output buffer
+ * @param len number of bytes, within the file
+ * @return int 0 if success, otherwise failed
+ *
+ * @details
+ *  The clusters are located with the extent map of the file, which is
+ * extended to the end of the range first.
+ *  Partial clusters at the head and the tail of the range go through the data
+ * pool of diskbuf. Whole clusters are read from the drive straight into the
+ * buffer, a run of physically contiguous clusters with a single request of
+ * at most `max_io_size` bytes, so bulk reads skip a copy and do not evict
+ * anything cached.
+ */
+static int
+read_file_range(
+    struct fs_fat* fs,
+    struct file_fat* file,
+    uint8_t* buf,
+    size_t len)
+{
+    struct extent_map* map = file->extmap;
+    if (!map) {
+        /* damaged entry with data but no cluster */
+        fs->fs.error = OFSL_FSE_ICLUSTER;
+        return 1;
+    }
+
+    const uint64_t end = (uint64_t)file->cursor + len;
+    if (extend_extent_map(fs, map, (end + fs->cluster_size - 1) / fs->cluster_size)) {
+        return 1;
+    }
+
+    while (len > 0) {
+        const uint32_t cluster_idx = file->cursor / fs->cluster_size;
+        const uint32_t cluster_offs = file->cursor % fs->cluster_size;
+        const struct fat_extent* ext = find_extent(map, cluster_idx);
+        const fatcluster_t cluster = ext->physical + (cluster_idx - ext->logical);
+        size_t read_bytes;
+
+        /* whole clusters of the extent without changes held in diskbuf */
+        size_t run = 0;
+        if (cluster_offs == 0 && len >= fs->cluster_size) {
+            size_t run_max = ext->logical + ext->length - cluster_idx;
+            if (run_max > len / fs->cluster_size) {
+                run_max = len / fs->cluster_size;
+            }
+            if (run_max > max_io_count(fs, fs->cluster_size)) {
+                run_max = max_io_count(fs, fs->cluster_size);
+            }
+            while (run < run_max) {
+                struct diskbuf_entry* entry =
+                    lookup_diskbuf_entry(fs, DISKBUF_TYPE_CLUSTER, cluster + run);
+                if (entry && entry->dirty) {
+                    break;
+                }
+                run++;
+            }
+        }
+
+        if (run > 0) {
+            lba_t lba = 0;
+            if (cluster_to_sector(fs, &lba, cluster)) {
+                return 1;
+            }
+            const size_t sector_cnt = run * fs->sectors_per_cluster;
+            if (ofsl_drive_read_sector(
+                    fs->part.drv,
+                    buf,
+                    fs->part.lba_start + lba,
+                    fs->sector_size,
+                    sector_cnt) != (ssize_t)sector_cnt) {
+                return 1;
+            }
+            read_bytes = run * fs->cluster_size;
+        } else {
+            unsigned int entry_idx;
+            if (read_cluster(fs, &entry_idx, DISKBUF_POOL_DATA, cluster)) {
+                return 1;
+            }
+
+            /* only the last one read may end inside the cluster */
+            read_bytes = fs->cluster_size - cluster_offs;
+            if (read_bytes > len) {
+                read_bytes = len;
+            }
+            memcpy(buf, fs->diskbuf[entry_idx]->data + cluster_offs, read_bytes);
+        }
+
+        buf += read_bytes;
+        len -= read_bytes;
+        file->cursor += read_bytes;
+    }
+
+    return 0;
+}
+
 static ssize_t
 file_read(
     OFSL_File* file_opaque,
@@ -1452,55 +3083,21 @@ file_read(
     if (!file) return 1;
     struct fs_fat* fs = check_fs_mounted(file->file.fs);
     if (!fs) return 1;
-    struct fat_direntry_file* entry = &file->direntry;
 
     if (file_iseof((OFSL_File*)file)) return -1;
+    if (size == 0) return count;
 
-    uint8_t* bbuf = buf;
-
-    fatcluster_t cluster_idx = file->head_cluster;
-    get_next_cluster(fs, &cluster_idx, file->cursor / fs->cluster_size);
-
-    unsigned int entry_idx;
+    /* whole blocks only */
+    size_t blkcnt = (file->direntry.size - file->cursor) / size;
+    if (blkcnt > count) {
+        blkcnt = count;
+    }
 
-    for (size_t blkcnt = 0; blkcnt < count; blkcnt++) {
-        if (file->cursor + size > file->direntry.size) {
-            return blkcnt;
-        }
-        uint32_t cluster_offs = file->cursor % fs->cluster_size;
-        size_t block_read_bytes = 0;
-
-        for (;;) {
-            uint16_t cluster_max_read = fs->cluster_size - cluster_offs;
-            uint16_t block_max_read = size - block_read_bytes;
-
-            read_cluster(fs, &entry_idx, cluster_idx);
-
-            if (cluster_max_read > block_max_read) {
-                memcpy(
-                    bbuf,
-                    fs->diskbuf[entry_idx]->data + cluster_offs,
-                    block_max_read);
-                block_read_bytes += block_max_read;
-                bbuf += block_max_read;
-                file->cursor += block_max_read;
-                break;
-            } else {
-                memcpy(
-                    bbuf,
-                    fs->diskbuf[entry_idx]->data + cluster_offs,
-                    cluster_max_read);
-                block_read_bytes += cluster_max_read;
-                cluster_offs = 0;
-                bbuf += cluster_max_read;
-                file->cursor += cluster_max_read;
-
-                get_next_cluster(fs, &cluster_idx, 1);
-            }
-        }
+    if (read_file_range(fs, file, buf, blkcnt * size)) {
+        return -1;
     }
 
-    return count;
+    return blkcnt;
 }
 
 static int file_seek(OFSL_File* file_opaque, ssize_t offset, int origin)
@@ -1571,6 +3168,7 @@ OFSL_FileSystem* ofsl_fs_fat_create(OFSL_Partition* part)
         //.dir_remove = dir_remove,
         .rootdir_open = rootdir_open,
         .dir_open = dir_open,
+        .dir_open_path = dir_open_path,
         .dir_close = dir_close,
         .dir_iter_start = dir_iter_start,
         .dir_iter_next = dir_iter_next,
@@ -1583,6 +3181,7 @@ OFSL_FileSystem* ofsl_fs_fat_create(OFSL_Partition* part)
         //.file_create = file_create,
         //.file_remove = file_remove,
         .file_open = file_open,
+        .file_open_path = file_open_path,
         .file_close = file_close,
         .file_read = file_read,
         /* .file_write = file_write, */
@@ -1602,6 +3201,13 @@ OFSL_FileSystem* ofsl_fs_fat_create(OFSL_Partition* part)
 
     /* default settings */
     fs->options.diskbuf_count = DEFAULT_DISKBUF_ENTRY_COUNT;
+    fs->options.fat_diskbuf_count = DEFAULT_FAT_DISKBUF_COUNT;
+    fs->options.dir_diskbuf_count = DEFAULT_DIR_DISKBUF_COUNT;
+    fs->options.diskbuf_hugepage = DEFAULT_DISKBUF_HUGEPAGE;
+    fs->options.fat_in_memory = DEFAULT_FAT_IN_MEMORY;
+    fs->options.max_io_size = DEFAULT_MAX_IO_SIZE;
+    fs->options.dcache_count = DEFAULT_DCACHE_COUNT;
+    fs->options.cache_policy = DEFAULT_CACHE_POLICY;
     fs->options.lfn_enabled = DEFAULT_LFN_ENABLED;
     fs->options.readonly = DEFAULT_READONLY;
     fs->options.unicode_enabled = DEFAULT_UNICODE_ENABLED;
@@ -1611,6 +3217,10 @@ OFSL_FileSystem* ofsl_fs_fat_create(OFSL_Partition* part)
     fs->options.sfn_lowercase = DEFAULT_SFN_LOWERCASE;
     fs->options.codepage = DEFAULT_CODEPAGE;
 
+    fs->extent_maps = NULL;
+    fs->fat_table = NULL;
+    fs->free_bitmap = NULL;
+    fs->dcache = NULL;
     fs->mounted = 0;
 
     return (OFSL_FileSystem*)fs;
@@ -1622,3 +3232,68 @@ struct ofsl_fs_fat_option* ofsl_fs_fat_get_option(OFSL_FileSystem* fs_opaque)
 
     return fs->mounted ? NULL : &fs->options;
 }
+
+OFSL_EXPORT
+int ofsl_fs_fat_get_free_clusters(OFSL_FileSystem* fs_opaque, uint32_t* count)
+{
+    struct fs_fat* fs = check_fs_mounted(fs_opaque);
+    if (!fs) return 1;
+
+    if (!fs->free_bitmap && build_free_bitmap(fs)) {
+        return 1;
+    }
+
+    *count = fs->free_clusters;
+    return 0;
+}
+
+OFSL_EXPORT
+int ofsl_fs_fat_get_free_run(OFSL_FileSystem* fs_opaque, uint32_t* first, uint32_t* length)
+{
+    struct fs_fat* fs = check_fs_mounted(fs_opaque);
+    if (!fs) return 1;
+
+    if (!fs->free_bitmap && build_free_bitmap(fs)) {
+        return 1;
+    }
+
+    const size_t word_cnt = ((size_t)fs->cluster_count + 2 + 63) / 64;
+    uint32_t best_first = 0, best_len = 0;
+    uint32_t run_first = 0, run_len = 0;
+
+    for (size_t i = 0; i < word_cnt; i++) {
+        const uint64_t word = fs->free_bitmap[i];
+
+        /* whole words free or in use need no bit-wise look */
+        if (word == UINT64_MAX || word == 0) {
+            if (word && run_len == 0) {
+                run_first = i * 64;
+            }
+            run_len = word ? run_len + 64 : 0;
+        } else {
+            for (unsigned int bit = 0; bit < 64; bit++) {
+                if ((word >> bit) & 1) {
+                    if (run_len == 0) {
+                        run_first = i * 64 + bit;
+                    }
+                    run_len++;
+                } else {
+                    run_len = 0;
+                }
+                if (run_len > best_len) {
+                    best_first = run_first;
+                    best_len = run_len;
+                }
+            }
+        }
+
+        if (run_len > best_len) {
+            best_first = run_first;
+            best_len = run_len;
+        }
+    }
+
+    *first = best_first;
+    *length = best_len;
+    return 0;
+}
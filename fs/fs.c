@@ -13,6 +13,7 @@ static const char* error_str_list[] = {
     "Invalid cluster index",
     "Invalid file system type",
     "Invalid file or directory name",
+    "Input/output error",
 };
 
 OFSL_EXPORT
@@ -9,31 +9,61 @@
 #include <ofsl/time.h>
 
 #include "endian.h"
+#include "fs/dcache.h"
 #include "fs/iso9660/internal.h"
 #include "config.h"
 
 #define DISKBUF_TYPE_SECTOR     0
 #define DISKBUF_TYPE_CLUSTER    1
 
-#define USAGE_TAG_MAX           32767
+#define DISKBUF_QUEUE_A1IN      0   /* entries referenced once, in FIFO order */
+#define DISKBUF_QUEUE_AM        1   /* entries referenced again, in LRU order */
 
 struct diskbuf_entry {
     uint16_t data_valid : 1;
-    uint16_t usage_tag : 15;
+    uint16_t queue : 1;
     uint32_t lba;
-    uint8_t data[];
+    unsigned int index;                 /* slot in fs->diskbuf */
+    struct diskbuf_entry* hash_next;
+    struct diskbuf_entry* lru_prev;
+    struct diskbuf_entry* lru_next;
+    uint8_t* data;  /* points to buf or to the memory mapped by the drive */
+    uint8_t* buf;   /* allocated by ofsl_drive_alloc_buffer() */
+};
+
+struct diskbuf_queue {
+    struct diskbuf_entry* head;         /* most recently inserted or used */
+    struct diskbuf_entry* tail;
+    unsigned int count;
+};
+
+/* LBA address of a sector recently evicted from A1in */
+struct diskbuf_ghost {
+    uint8_t valid : 1;
+    uint32_t lba;
+    struct diskbuf_ghost* hash_next;
 };
 
 struct fs_iso {
     OFSL_FileSystem fs;
     OFSL_Partition part;
     struct diskbuf_entry** diskbuf;
+    struct diskbuf_entry** diskbuf_hash;
+    unsigned int diskbuf_hash_bits;
+    unsigned int diskbuf_used;          /* slots filled so far */
+    struct diskbuf_queue diskbuf_queue[2];
+    unsigned int diskbuf_a1in_max;
+    struct diskbuf_ghost* diskbuf_ghost;        /* ring of A1out */
+    struct diskbuf_ghost** diskbuf_ghost_hash;
+    unsigned int diskbuf_ghost_max;
+    unsigned int diskbuf_ghost_pos;             /* oldest ghost */
     uint8_t mounted : 1;
     uint32_t pathtbl_size;
     uint32_t volume_sector_count;
     uint16_t sector_size;
     uint32_t lba_primary_desc;
     uint32_t lba_pathtbl[2];
+    struct dcache* dcache;              /* entries by directory LBA, NULL if disabled */
 
     struct ofsl_fs_iso9660_option options;
 };
@@ -52,6 +82,7 @@ struct dirit_iso {
     uint16_t entry_pos_current;
     uint16_t prev_entry_size;
     int valid;
+    int error;      /* stopped on an error rather than the end of entries */
     struct isofs_dir_entry_header direntry;
     char filename[ISO9660_PATH_BUFSZ];
 };
@@ -168,19 +199,130 @@ get_shortfmt_time(
     time->nsec = 0;
 }
 
+static size_t diskbuf_hash_index(struct fs_iso* fs, uint32_t lba)
+{
+    return (lba * UINT64_C(0x9E3779B97F4A7C15)) >> (64 - fs->diskbuf_hash_bits);
+}
+
+static void diskbuf_hash_remove(struct fs_iso* fs, struct diskbuf_entry* entry)
+{
+    struct diskbuf_entry** link =
+        &fs->diskbuf_hash[diskbuf_hash_index(fs, entry->lba)];
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+}
+
+static void diskbuf_queue_unlink(struct fs_iso* fs, struct diskbuf_entry* entry)
+{
+    struct diskbuf_queue* queue = &fs->diskbuf_queue[entry->queue];
+
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        queue->head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        queue->tail = entry->lru_prev;
+    }
+    queue->count--;
+}
+
+static void
+diskbuf_queue_push_front(
+    struct fs_iso* fs,
+    struct diskbuf_entry* entry,
+    unsigned int queue_idx)
+{
+    struct diskbuf_queue* queue = &fs->diskbuf_queue[queue_idx];
+
+    entry->queue = queue_idx;
+    entry->lru_prev = NULL;
+    entry->lru_next = queue->head;
+    if (queue->head) {
+        queue->head->lru_prev = entry;
+    } else {
+        queue->tail = entry;
+    }
+    queue->head = entry;
+    queue->count++;
+}
+
+/**
+ * @brief Take the LBA address out of the A1out ghost list if it is there
+ *
+ * @param fs filesystem object struct
+ * @param lba LBA address of the sector
+ * @return int 1 if the address was found, 0 otherwise
+ */
+static int diskbuf_ghost_take(struct fs_iso* fs, uint32_t lba)
+{
+    if (!fs->diskbuf_ghost) {
+        return 0;
+    }
+
+    struct diskbuf_ghost** link =
+        &fs->diskbuf_ghost_hash[diskbuf_hash_index(fs, lba)];
+    while (*link && (*link)->lba != lba) {
+        link = &(*link)->hash_next;
+    }
+    if (!*link) {
+        return 0;
+    }
+
+    (*link)->valid = 0;
+    *link = (*link)->hash_next;
+    return 1;
+}
+
+/**
+ * @brief Remember the LBA address of an entry evicted from A1in
+ *
+ * @param fs filesystem object struct
+ * @param lba LBA address of the evicted sector
+ *
+ * @details
+ *  The ghost list is a ring, the oldest address is forgotten when it is full.
+ */
+static void diskbuf_ghost_add(struct fs_iso* fs, uint32_t lba)
+{
+    struct diskbuf_ghost* ghost = &fs->diskbuf_ghost[fs->diskbuf_ghost_pos];
+    fs->diskbuf_ghost_pos = (fs->diskbuf_ghost_pos + 1) % fs->diskbuf_ghost_max;
+
+    if (ghost->valid) {
+        diskbuf_ghost_take(fs, ghost->lba);
+    }
+
+    const size_t hidx = diskbuf_hash_index(fs, lba);
+    ghost->lba = lba;
+    ghost->valid = 1;
+    ghost->hash_next = fs->diskbuf_ghost_hash[hidx];
+    fs->diskbuf_ghost_hash[hidx] = ghost;
+}
+
 /**
  * @brief Allocate diskbuf sector entry
  * 
  * @param fs filesystem object struct
- * @param entry_idx entry index output (NULL if not needed)
+ * @param entry_idx entry index output
  * @param lba LBA address of the sector
  * @return int 0 if success, otherwise failed
  * 
  * @details
  *  This function finds, replaces, or allocates a diskbuf sector entry by the
- * given lba value and decreases the `usage_tag` member of each entries for
- * further entry replacement.
- *  Flushes old entry when replacement is required.
+ * given lba value. Entries are looked up in a hash table and kept in recency
+ * queues, so both hits and replacements take constant time.
+ *  Until every slot is filled, a new entry is allocated. After that, an entry
+ * chosen by the cache policy is replaced:
+ * - OFSL_CACHE_LRU: every entry is kept in the Am queue, and the least
+ *   recently used one is replaced.
+ * - OFSL_CACHE_2Q: a new entry goes to the A1in queue first, and is only
+ *   moved to the Am queue when it is missed again while its address is in the
+ *   A1out ghost list. Reading a large file thus does not evict the directory
+ *   sectors and the path table held in Am.
  */
 static int
 allocate_diskbuf_sector_entry(
@@ -188,45 +330,62 @@ allocate_diskbuf_sector_entry(
     unsigned int* entry_idx,
     uint32_t lba)
 {
-    int cached = 0;
-    int target_entry_idx = -1;
-    uint16_t usage_tag_min = USAGE_TAG_MAX;
-
-    for (int i = 0; i < fs->options.diskbuf_count; i++) {
-        if (fs->diskbuf[i] == NULL) {
-            if (target_entry_idx < 0 && !cached) {
-                target_entry_idx = i;
-            }
-        } else {
-            if (fs->diskbuf[i]->lba == lba) {
-                target_entry_idx = i;
-                cached = 1;
-            } else if (
-                (fs->diskbuf[i]->usage_tag < usage_tag_min) &&
-                !cached &&
-                (target_entry_idx < 0)) {
-                usage_tag_min = fs->diskbuf[i]->usage_tag;
-                target_entry_idx = i;
-            }
+    const size_t hidx = diskbuf_hash_index(fs, lba);
 
-            if (fs->diskbuf[i]->usage_tag > 0) {
-                fs->diskbuf[i]->usage_tag--;
-            }
-        } 
+    struct diskbuf_entry* entry = fs->diskbuf_hash[hidx];
+    while (entry && entry->lba != lba) {
+        entry = entry->hash_next;
     }
 
-    if (!cached) {
-        if (!fs->diskbuf[target_entry_idx]) {
-            fs->diskbuf[target_entry_idx] =
-                malloc(sizeof(struct diskbuf_entry) + fs->sector_size);
+    if (entry) {
+        if (entry->queue == DISKBUF_QUEUE_AM &&
+            fs->diskbuf_queue[DISKBUF_QUEUE_AM].head != entry) {
+            diskbuf_queue_unlink(fs, entry);
+            diskbuf_queue_push_front(fs, entry, DISKBUF_QUEUE_AM);
         }
+        *entry_idx = entry->index;
+        return 0;
+    }
+
+    unsigned int queue_idx = DISKBUF_QUEUE_AM;
+    if (fs->diskbuf_ghost && !diskbuf_ghost_take(fs, lba)) {
+        queue_idx = DISKBUF_QUEUE_A1IN;
+    }
 
-        fs->diskbuf[target_entry_idx]->data_valid = 0;
-        fs->diskbuf[target_entry_idx]->lba = lba;
+    if (fs->diskbuf_used < fs->options.diskbuf_count) {
+        entry = malloc(sizeof(struct diskbuf_entry));
+        if (!entry) {
+            return 1;
+        }
+        entry->buf = ofsl_drive_alloc_buffer(fs->part.drv, fs->sector_size);
+        if (!entry->buf) {
+            free(entry);
+            return 1;
+        }
+        entry->index = fs->diskbuf_used++;
+        fs->diskbuf[entry->index] = entry;
+    } else {
+        const struct diskbuf_queue* a1in = &fs->diskbuf_queue[DISKBUF_QUEUE_A1IN];
+        if (a1in->count > fs->diskbuf_a1in_max ||
+            (a1in->count > 0 && !fs->diskbuf_queue[DISKBUF_QUEUE_AM].tail)) {
+            entry = a1in->tail;
+            diskbuf_ghost_add(fs, entry->lba);
+        } else {
+            entry = fs->diskbuf_queue[DISKBUF_QUEUE_AM].tail;
+        }
+        diskbuf_queue_unlink(fs, entry);
+        diskbuf_hash_remove(fs, entry);
     }
-    fs->diskbuf[target_entry_idx]->usage_tag = USAGE_TAG_MAX;
 
-    *entry_idx = target_entry_idx;
+    entry->data_valid = 0;
+    entry->lba = lba;
+    entry->data = entry->buf;
+
+    entry->hash_next = fs->diskbuf_hash[hidx];
+    fs->diskbuf_hash[hidx] = entry;
+    diskbuf_queue_push_front(fs, entry, queue_idx);
+
+    *entry_idx = entry->index;
     return 0;
 }
 
@@ -237,20 +396,44 @@ allocate_diskbuf_sector_entry(
  * @param entry_idx entry index output (NULL if not needed)
  * @param lba LBA address of the sector
  * @return int 0 if success, otherwise failed
+ * 
+ * @details
+ *  If the drive can map the sector in memory, the entry points to the mapped
+ * data instead of copying it into the buffer of the entry.
  */
 static int read_sector(struct fs_iso* fs, unsigned int* entry_idx, lba_t lba)
 {
     unsigned int target_entry_idx;
-    allocate_diskbuf_sector_entry(fs, &target_entry_idx, lba);
+    if (allocate_diskbuf_sector_entry(fs, &target_entry_idx, lba)) {
+        return 1;
+    }
+
+    struct diskbuf_entry* entry = fs->diskbuf[target_entry_idx];
+    if (!entry->data_valid) {
+        const void* mapped = NULL;
+        if (fs->part.drv->drvinfo.sector_size == fs->sector_size) {
+            mapped = ofsl_drive_map_sector(
+                fs->part.drv,
+                fs->part.lba_start + lba,
+                1);
+        }
 
-    if (!fs->diskbuf[target_entry_idx]->data_valid) {
-        ofsl_drive_read_sector(
-            fs->part.drv,
-            fs->diskbuf[target_entry_idx]->data,
-            fs->part.lba_start + lba,
-            fs->sector_size,
-            1);
-        fs->diskbuf[target_entry_idx]->data_valid = 1;
+        if (mapped) {
+            entry->data = (uint8_t*)mapped;
+        } else {
+            entry->data = entry->buf;
+            if (ofsl_drive_read_sector(
+                    fs->part.drv,
+                    entry->data,
+                    fs->part.lba_start + lba,
+                    fs->sector_size,
+                    1) != 1) {
+                /* left invalid, so the next access reads it again */
+                fs->fs.error = OFSL_FSE_IO;
+                return 1;
+            }
+        }
+        entry->data_valid = 1;
     }
 
     if (entry_idx) {
@@ -259,14 +442,73 @@ static int read_sector(struct fs_iso* fs, unsigned int* entry_idx, lba_t lba)
     return 0;
 }
 
+static void free_diskbuf(struct fs_iso* fs)
+{
+    for (int i = 0; fs->diskbuf && i < fs->options.diskbuf_count; i++) {
+        if (fs->diskbuf[i] != NULL) {
+            ofsl_drive_free_buffer(fs->diskbuf[i]->buf);
+            free(fs->diskbuf[i]);
+        }
+    }
+    free(fs->diskbuf);
+    free(fs->diskbuf_hash);
+    free(fs->diskbuf_ghost);
+    free(fs->diskbuf_ghost_hash);
+    fs->diskbuf = NULL;
+    fs->diskbuf_hash = NULL;
+    fs->diskbuf_ghost = NULL;
+    fs->diskbuf_ghost_hash = NULL;
+}
+
 static int mount(OFSL_FileSystem* fs_opaque)
 {
     struct fs_iso* fs = (struct fs_iso*)fs_opaque;
 
+    if (fs->options.diskbuf_count == 0) {
+        return 1;
+    }
+
     fs->diskbuf =
         calloc(
             fs->options.diskbuf_count,
             sizeof(struct diskbuf_entry*));
+
+    /* keep the load factor of the hash table at most 1 */
+    fs->diskbuf_hash_bits = 1;
+    while ((1U << fs->diskbuf_hash_bits) < fs->options.diskbuf_count) {
+        fs->diskbuf_hash_bits++;
+    }
+    fs->diskbuf_hash = calloc(
+        (size_t)1 << fs->diskbuf_hash_bits,
+        sizeof(struct diskbuf_entry*));
+
+    fs->diskbuf_ghost = NULL;
+    fs->diskbuf_ghost_hash = NULL;
+    if (fs->options.cache_policy == OFSL_CACHE_2Q) {
+        /* A1in takes a quarter of the slots, A1out remembers half of them */
+        fs->diskbuf_a1in_max = fs->options.diskbuf_count / 4;
+        if (fs->diskbuf_a1in_max == 0) {
+            fs->diskbuf_a1in_max = 1;
+        }
+        fs->diskbuf_ghost_max = fs->options.diskbuf_count / 2;
+        if (fs->diskbuf_ghost_max == 0) {
+            fs->diskbuf_ghost_max = 1;
+        }
+        fs->diskbuf_ghost_pos = 0;
+        fs->diskbuf_ghost =
+            calloc(fs->diskbuf_ghost_max, sizeof(struct diskbuf_ghost));
+        fs->diskbuf_ghost_hash = calloc(
+            (size_t)1 << fs->diskbuf_hash_bits,
+            sizeof(struct diskbuf_ghost*));
+    }
+    if (!fs->diskbuf || !fs->diskbuf_hash ||
+        (fs->options.cache_policy == OFSL_CACHE_2Q &&
+         (!fs->diskbuf_ghost || !fs->diskbuf_ghost_hash))) {
+        free_diskbuf(fs);
+        return 1;
+    }
+    fs->diskbuf_used = 0;
+    memset(fs->diskbuf_queue, 0, sizeof(fs->diskbuf_queue));
     fs->sector_size = 2048;
 
     lba_t lba_current_descriptor = 16;
@@ -276,11 +518,17 @@ static int mount(OFSL_FileSystem* fs_opaque)
     /* find primary volume descriptor */
     fs->lba_primary_desc = 0;
     do {
-        read_sector(fs, &entry_idx, lba_current_descriptor);
+        if (read_sector(fs, &entry_idx, lba_current_descriptor)) {
+            free_diskbuf(fs);
+            return 1;
+        }
         voldesc = (void*)fs->diskbuf[entry_idx]->data;
 
         /* check signature */
-        if (strncmp(voldesc->signature, ISO9660_SIGNATURE, 5) != 0) return 1;
+        if (strncmp(voldesc->signature, ISO9660_SIGNATURE, 5) != 0) {
+            free_diskbuf(fs);
+            return 1;
+        }
 
         switch (voldesc->type) {
             case VDTYPE_PRIVOLDESC:
@@ -292,9 +540,11 @@ static int mount(OFSL_FileSystem* fs_opaque)
         lba_current_descriptor++;
     } while (voldesc->type != VDTYPE_VDSETTERM);
 
-    if (!fs->lba_primary_desc) return 1;
-
-    read_sector(fs, &entry_idx, fs->lba_primary_desc);
+    if (!fs->lba_primary_desc ||
+        read_sector(fs, &entry_idx, fs->lba_primary_desc)) {
+        free_diskbuf(fs);
+        return 1;
+    }
     voldesc = (void*)fs->diskbuf[entry_idx]->data;
 
 #ifdef BYTE_ORDER_BIG_ENDIAN
@@ -312,6 +562,9 @@ static int mount(OFSL_FileSystem* fs_opaque)
     fs->volume_sector_count =
         get_biendian_value(&voldesc->pvd.vol_sector_count);
 
+    /* path lookups go without the cache if it cannot be allocated */
+    fs->dcache = dcache_create(fs->options.dcache_count, sizeof(struct isofs_dir_entry_header));
+
     fs->mounted = 1;
 
     return 0;
@@ -322,6 +575,9 @@ static int unmount(OFSL_FileSystem* fs_opaque)
     struct fs_iso* fs = check_fs_mounted(fs_opaque);
     if (!fs) return 1;
 
+    free_diskbuf(fs);
+    dcache_delete(fs->dcache);
+    fs->dcache = NULL;
     fs->mounted = 0;
     return 0;
 }
@@ -342,12 +598,18 @@ static OFSL_Directory* rootdir_open(OFSL_FileSystem* fs_opaque)
     dir->dir.fs = &fs->fs;
     dir->dir.ops = fs->fs.ops;
 
-    read_sector(fs, &entry_idx, fs->lba_pathtbl[0]);
+    if (read_sector(fs, &entry_idx, fs->lba_pathtbl[0])) {
+        free(dir);
+        return NULL;
+    }
     struct isofs_pathtbl_entry_header* pathtbl_entry =
         (void*)fs->diskbuf[entry_idx]->data;
     dir->lba_data = pathtbl_entry->lba_data;
 
-    read_sector(fs, &entry_idx, fs->lba_primary_desc);
+    if (read_sector(fs, &entry_idx, fs->lba_primary_desc)) {
+        free(dir);
+        return NULL;
+    }
     struct isofs_vol_desc* voldesc = (void*)fs->diskbuf[entry_idx]->data;
     dir->parent = NULL;
     memcpy(
@@ -366,7 +628,7 @@ static OFSL_Directory* dir_open(OFSL_Directory* parent_opaque, const char* name)
     if (!fs) return NULL;
 
     struct isofs_dir_entry_header dirent;
-    if (!match_name(parent, name, &dirent)) {
+    if (match_name(parent, name, &dirent) <= 0) {
         fs->fs.error = OFSL_FSE_NOENT;
         return  NULL;
     }
@@ -402,6 +664,7 @@ static OFSL_DirectoryIterator* dir_iter_start(OFSL_Directory* dir_opaque)
     it->dirit.ops = fs->fs.ops;
     it->parent = dir;
     it->valid = 0;
+    it->error = 0;
     it->lba_current = dir->lba_data;
     it->entry_pos_current = 0;
     
@@ -419,7 +682,10 @@ static int dir_iter_next(OFSL_DirectoryIterator* it_opaque)
 
     unsigned int entry_idx;
 
-    read_sector(fs, &entry_idx, it->lba_current);
+    if (read_sector(fs, &entry_idx, it->lba_current)) {
+        it->error = 1;
+        return 1;
+    }
     struct isofs_dir_entry_header* direnthdr =
         (void*)((uint8_t*)fs->diskbuf[entry_idx]->data + it->entry_pos_current);
     if (!direnthdr->entry_size) return 1;
@@ -529,7 +795,7 @@ dir_iter_get_timestamp(
     defined(BUILD_FILESYSTEM_ISO9660_JOILET)
     unsigned int entry_idx;
 
-    read_sector(fs, &entry_idx, it->lba_current);
+    if (read_sector(fs, &entry_idx, it->lba_current)) return 1;
     struct isofs_dir_entry_header* direnthdr =
         (void*)(
             (uint8_t*)fs->diskbuf[entry_idx]->data +
@@ -644,7 +910,7 @@ file_open(
     if (!fs) return NULL;
 
     struct isofs_dir_entry_header dirent;
-    if (!match_name(parent, name, &dirent)) {
+    if (match_name(parent, name, &dirent) <= 0) {
         fs->fs.error = OFSL_FSE_NOENT;
         return NULL;
     }
@@ -700,7 +966,7 @@ static ssize_t file_read(
             uint16_t sector_max_read = fs->sector_size - sector_offs;
             uint16_t block_max_read = size - block_read_bytes;
 
-            read_sector(fs, &entry_idx, lba_current);
+            if (read_sector(fs, &entry_idx, lba_current)) return blkcnt;
 
             if (sector_max_read > block_max_read) {
                 memcpy(
@@ -786,7 +1052,7 @@ get_volume_string(
     if (!fs) return 1;
     
     unsigned int entry_idx;
-    read_sector(fs, &entry_idx, fs->lba_primary_desc);
+    if (read_sector(fs, &entry_idx, fs->lba_primary_desc)) return 1;
     struct isofs_vol_desc* voldesc = (void*)fs->diskbuf[entry_idx]->data;
 
     switch (type) {
@@ -855,7 +1121,7 @@ get_volume_timestamp(
     if (!fs) return 1;
     
     unsigned int entry_idx;
-    read_sector(fs, &entry_idx, fs->lba_primary_desc);
+    if (read_sector(fs, &entry_idx, fs->lba_primary_desc)) return 1;
     struct isofs_vol_desc* voldesc = (void*)fs->diskbuf[entry_idx]->data;
 
     switch (type) {
@@ -878,6 +1144,14 @@ get_volume_timestamp(
     return 0;
 }
 
+/**
+ * @brief Find an entry of a directory by its name
+ *
+ * @param parent directory object struct
+ * @param name file name
+ * @param direntry_buf output of the entry found
+ * @return int 1 if found, 0 if not, -1 if the directory could not be read
+ */
 static int
 match_name(
     struct dir_iso* parent,
@@ -904,8 +1178,168 @@ match_name(
             }
         }
     }
+    const int ret = it->error ? -1 : 0;
     dir_iter_end((OFSL_DirectoryIterator*)it);
-    return 0;
+    return ret;
+}
+
+/**
+ * @brief Find an entry of a directory through the dentry cache
+ *
+ * @param fs filesystem object struct
+ * @param dir directory to look in
+ * @param name file name
+ * @param direntry_buf output of the entry found
+ * @return int 1 if found, 0 if not, -1 if the directory could not be read
+ *
+ * @details
+ *  Names are cached lower-cased unless `case_sensitive` is set, as they are
+ * compared by match_name(). Misses are cached too, unless the directory could
+ * not be read to its end.
+ */
+static int
+lookup_dentry(
+    struct fs_iso* fs,
+    struct dir_iso* dir,
+    const char* name,
+    struct isofs_dir_entry_header* direntry_buf)
+{
+    char folded[ISO9660_PATH_BUFSZ];
+    for (size_t i = 0; ; i++) {
+        folded[i] = fs->options.case_sensitive ? name[i] : tolower((uint8_t)name[i]);
+        if (!name[i]) break;
+    }
+
+    if (fs->dcache) {
+        switch (dcache_lookup(fs->dcache, dir->lba_data, folded, direntry_buf)) {
+            case DCACHE_POSITIVE:
+                return 1;
+            case DCACHE_NEGATIVE:
+                return 0;
+            default:
+                break;
+        }
+    }
+
+    const int match = match_name(dir, name, direntry_buf);
+    if (match < 0) {
+        return -1;
+    }
+    if (fs->dcache) {
+        dcache_insert(fs->dcache, dir->lba_data, folded, match ? direntry_buf : NULL);
+    }
+    return match;
+}
+
+/**
+ * @brief Resolve a path from the root directory
+ *
+ * @param fs filesystem object struct
+ * @param path components separated by '/'
+ * @param dir root directory, replaced with the parent of the last component
+ * @param direntry_buf output of the entry of the last component
+ * @return int 0 if resolved, 1 if the path names the root directory,
+ *         -1 if failed with the error set
+ */
+static int
+resolve_path(
+    struct fs_iso* fs,
+    const char* path,
+    struct dir_iso* dir,
+    struct isofs_dir_entry_header* direntry_buf)
+{
+    char name[ISO9660_PATH_BUFSZ];
+    int is_root = 1;
+
+    int ret;
+    while ((ret = dcache_path_next(&path, name, sizeof(name))) == 0) {
+        if (!is_root) {
+            if (!direntry_buf->directory) {
+                fs->fs.error = OFSL_FSE_NOENT;
+                return -1;
+            }
+            dir->lba_data = get_biendian_value(&direntry_buf->lba_data_location);
+            memcpy(&dir->direntry, direntry_buf, sizeof(dir->direntry));
+        }
+
+        const int found = lookup_dentry(fs, dir, name, direntry_buf);
+        if (found <= 0) {
+            /* a read error keeps the error of the failed read */
+            if (found == 0) {
+                fs->fs.error = OFSL_FSE_NOENT;
+            }
+            return -1;
+        }
+        is_root = 0;
+    }
+    if (ret < 0) {
+        fs->fs.error = OFSL_FSE_IENTNAME;
+        return -1;
+    }
+
+    return is_root;
+}
+
+static OFSL_Directory* dir_open_path(OFSL_FileSystem* fs_opaque, const char* path)
+{
+    struct fs_iso* fs = check_fs_mounted(fs_opaque);
+    if (!fs) return NULL;
+
+    struct dir_iso* dir = (struct dir_iso*)rootdir_open(fs_opaque);
+    if (!dir) return NULL;
+
+    struct isofs_dir_entry_header dirent;
+    int ret = resolve_path(fs, path, dir, &dirent);
+    if (ret == 1) {
+        return (OFSL_Directory*)dir;
+    }
+    if (ret == 0 && !dirent.directory) {
+        fs->fs.error = OFSL_FSE_NOENT;
+        ret = -1;
+    }
+    if (ret < 0) {
+        free(dir);
+        return NULL;
+    }
+
+    dir->parent = NULL;
+    dir->lba_data = get_biendian_value(&dirent.lba_data_location);
+    memcpy(&dir->direntry, &dirent, sizeof(dirent));
+    return (OFSL_Directory*)dir;
+}
+
+static OFSL_File*
+file_open_path(
+    OFSL_FileSystem* fs_opaque,
+    const char* path,
+    const char* mode)
+{
+    struct fs_iso* fs = check_fs_mounted(fs_opaque);
+    if (!fs) return NULL;
+
+    struct dir_iso* dir = (struct dir_iso*)rootdir_open(fs_opaque);
+    if (!dir) return NULL;
+
+    struct isofs_dir_entry_header dirent;
+    const int ret = resolve_path(fs, path, dir, &dirent);
+    free(dir);
+    if (ret == 1) {
+        fs->fs.error = OFSL_FSE_NOENT;
+    }
+    if (ret != 0) {
+        return NULL;
+    }
+
+    struct file_iso* file = malloc(sizeof(struct file_iso));
+    if (!file) return NULL;
+    file->file.ops = fs->fs.ops;
+    file->file.fs = fs_opaque;
+    file->lba_data = get_biendian_value(&dirent.lba_data_location);
+    file->parent = NULL;
+    file->cursor = 0;
+    memcpy(&file->direntry, &dirent, sizeof(dirent));
+
+    return (OFSL_File*)file;
 }
 
 OFSL_EXPORT
@@ -923,6 +1357,7 @@ OFSL_FileSystem* ofsl_fs_iso9660_create(OFSL_Partition* part)
         //.dir_remove = dir_remove,
         .rootdir_open = rootdir_open,
         .dir_open = dir_open,
+        .dir_open_path = dir_open_path,
         .dir_close = dir_close,
         .dir_iter_start = dir_iter_start,
         .dir_iter_next = dir_iter_next,
@@ -935,6 +1370,7 @@ OFSL_FileSystem* ofsl_fs_iso9660_create(OFSL_Partition* part)
         //.file_create = file_create,
         //.file_remove = file_remove,
         .file_open = file_open,
+        .file_open_path = file_open_path,
         .file_close = file_close,
         .file_read = file_read,
         //.file_write = file_write,
@@ -955,8 +1391,18 @@ OFSL_FileSystem* ofsl_fs_iso9660_create(OFSL_Partition* part)
     fs->mounted = 0;
 
     fs->options.diskbuf_count = 32;
+    fs->options.dcache_count = 1024;
+    fs->options.cache_policy = OFSL_CACHE_LRU;
     fs->options.enable_joilet = 1;
     fs->options.enable_rock_ridge = 1;
 
     return (OFSL_FileSystem*)fs;
 }
+
+OFSL_EXPORT
+struct ofsl_fs_iso9660_option* ofsl_fs_iso9660_get_option(OFSL_FileSystem* fs_opaque)
+{
+    struct fs_iso* fs = (struct fs_iso*)fs_opaque;
+
+    return fs->mounted ? NULL : &fs->options;
+}
@@ -0,0 +1,41 @@
+#ifndef OFSL_DRIVE_CACHE_H__
+#define OFSL_DRIVE_CACHE_H__
+
+#include <ofsl/drive/drive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OFSL_DRIVE_CACHE_WRITEBACK      0x01    /* keep written blocks until eviction */
+
+/**
+ * @brief Create a block cache drive on top of another drive
+ *
+ * @param lower drive to cache, not owned by the cache drive
+ * @param bytes memory budget of the cached data in bytes
+ * @param block_sectors number of sectors per cache block
+ * @param flags combination of OFSL_DRIVE_CACHE_* flags
+ * @return OFSL_Drive* drive object, NULL if failed
+ *
+ * @details
+ *  The cache drive keeps the most recently used blocks of the lower drive in
+ * memory, up to the given budget, so every partition and filesystem stacked on
+ * it shares a single bounded cache. Consecutive missing blocks of a request are
+ * loaded from the lower drive with one vectored read.
+ *
+ *  Writes go straight through to the lower drive by default. With
+ * OFSL_DRIVE_CACHE_WRITEBACK, they only update the cached blocks which are
+ * written back when evicted or when the cache drive is deleted.
+ *
+ *  Requests with a sector size other than the one of the lower drive bypass
+ * the cache. The lower drive must outlive the cache drive and should not be
+ * accessed directly while the cache drive is in use.
+ */
+OFSL_Drive* ofsl_drive_cache_create(OFSL_Drive* lower, size_t bytes, size_t block_sectors, int flags);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -18,8 +18,20 @@ typedef struct {
     lba_t       lba_max;
     uint16_t    readonly : 1;
     uint16_t    : 15;
+    uint32_t    buf_align;  /* preferred alignment of data buffers, 0 if any */
 } OFSL_DriveInfo;
 
+typedef struct {
+    lba_t       lba;
+    size_t      cnt;
+    void*       buf;
+} OFSL_DriveIOVec;
+
+typedef struct {
+    uint64_t    tag;
+    ssize_t     result;
+} OFSL_DriveCompletion;
+
 struct ofsl_drive_ops;
 
 typedef struct ofsl_drive {
@@ -33,8 +45,68 @@ struct ofsl_drive_ops {
     int (*update_info)(OFSL_Drive* drv);
     ssize_t (*read_sector)(OFSL_Drive* drv, void* buf, lba_t lba, size_t sector_size, size_t cnt);
     ssize_t (*write_sector)(OFSL_Drive* drv, const void* buf, lba_t lba, size_t sector_size, size_t cnt);
+
+    /* optional */
+    const void* (*map_sector)(OFSL_Drive* drv, lba_t lba, size_t cnt);
+    ssize_t (*read_sectorv)(OFSL_Drive* drv, const OFSL_DriveIOVec* iov, size_t iovcnt, size_t sector_size);
+    ssize_t (*write_sectorv)(OFSL_Drive* drv, const OFSL_DriveIOVec* iov, size_t iovcnt, size_t sector_size);
+    int (*submit_read)(OFSL_Drive* drv, void* buf, lba_t lba, size_t sector_size, size_t cnt, uint64_t tag);
+    int (*submit_write)(OFSL_Drive* drv, const void* buf, lba_t lba, size_t sector_size, size_t cnt, uint64_t tag);
+    ssize_t (*reap_completion)(OFSL_Drive* drv, OFSL_DriveCompletion* comp, size_t max, size_t min);
+    int (*flush)(OFSL_Drive* drv);
 };
 
+/**
+ * @brief Read multiple sector ranges into separate buffers at once
+ *
+ * @param drv drive object
+ * @param iov list of (lba, sector count, buffer) segments
+ * @param iovcnt number of segments
+ * @param sector_size sector size in bytes
+ * @return ssize_t total number of sectors read
+ *
+ * @details
+ *  The segments are transferred in order and the transfer stops at the first
+ * segment which is not completed. Drivers without a native implementation
+ * fall back to one read_sector call per segment.
+ */
+ssize_t ofsl_drive_read_sectorv(OFSL_Drive* drv, const OFSL_DriveIOVec* iov, size_t iovcnt, size_t sector_size);
+
+/**
+ * @brief Write multiple sector ranges from separate buffers at once
+ *
+ * @param drv drive object
+ * @param iov list of (lba, sector count, buffer) segments
+ * @param iovcnt number of segments
+ * @param sector_size sector size in bytes
+ * @return ssize_t total number of sectors written
+ *
+ * @details
+ *  Same as ofsl_drive_read_sectorv() except the direction of the transfer.
+ */
+ssize_t ofsl_drive_write_sectorv(OFSL_Drive* drv, const OFSL_DriveIOVec* iov, size_t iovcnt, size_t sector_size);
+
+/**
+ * @brief Allocate a data buffer suitable for the transfers of the drive
+ *
+ * @param drv drive object
+ * @param size size of the buffer in bytes
+ * @return void* allocated buffer, NULL if failed
+ *
+ * @details
+ *  The buffer is aligned as the `buf_align` member of the drive information
+ * requires, so drives doing direct I/O can transfer it without bouncing the
+ * data through an internal buffer. Free it with ofsl_drive_free_buffer().
+ */
+void* ofsl_drive_alloc_buffer(OFSL_Drive* drv, size_t size);
+
+/**
+ * @brief Free a buffer allocated by ofsl_drive_alloc_buffer()
+ *
+ * @param buf buffer to free, may be NULL
+ */
+void ofsl_drive_free_buffer(void* buf);
+
 OFSL_INLINE
 static inline void ofsl_drive_delete(OFSL_Drive* drv)
 {
@@ -59,6 +131,106 @@ static inline ssize_t ofsl_drive_write_sector(OFSL_Drive* drv, const void* buf,
     return drv->ops->write_sector(drv, buf, lba, sector_size, cnt);
 }
 
+/**
+ * @brief Get a pointer to the sectors mapped in memory by the drive
+ *
+ * @param drv drive object
+ * @param lba LBA address of the first sector
+ * @param cnt number of sectors
+ * @return const void* pointer to the sector data, NULL if the drive cannot
+ *                     map the range
+ *
+ * @details
+ *  The returned memory is owned by the drive and stays valid until the drive
+ * is deleted. Sectors are always mapped in the sector size of the drive.
+ */
+OFSL_INLINE
+static inline const void* ofsl_drive_map_sector(OFSL_Drive* drv, lba_t lba, size_t cnt)
+{
+    if (!drv->ops->map_sector) {
+        return NULL;
+    }
+    return drv->ops->map_sector(drv, lba, cnt);
+}
+
+/**
+ * @brief Queue a sector read without waiting for it to finish
+ *
+ * @param drv drive object
+ * @param buf sector data buffer, must stay valid until the completion is reaped
+ * @param lba LBA address of the first sector
+ * @param sector_size sector size in bytes
+ * @param cnt number of sectors
+ * @param tag value reported back in the completion of the request
+ * @return int 0 if queued, nonzero if the drive does not support asynchronous
+ *             I/O or the request cannot be queued
+ */
+OFSL_INLINE
+static inline int ofsl_drive_submit_read(OFSL_Drive* drv, void* buf, lba_t lba, size_t sector_size, size_t cnt, uint64_t tag)
+{
+    if (!drv->ops->submit_read) {
+        return -1;
+    }
+    return drv->ops->submit_read(drv, buf, lba, sector_size, cnt, tag);
+}
+
+/**
+ * @brief Queue a sector write without waiting for it to finish
+ *
+ * @details
+ *  Same as ofsl_drive_submit_read() except the direction of the transfer.
+ */
+OFSL_INLINE
+static inline int ofsl_drive_submit_write(OFSL_Drive* drv, const void* buf, lba_t lba, size_t sector_size, size_t cnt, uint64_t tag)
+{
+    if (!drv->ops->submit_write) {
+        return -1;
+    }
+    return drv->ops->submit_write(drv, buf, lba, sector_size, cnt, tag);
+}
+
+/**
+ * @brief Collect the completions of submitted requests
+ *
+ * @param drv drive object
+ * @param comp completion array
+ * @param max maximum number of completions to store in comp
+ * @param min number of completions to wait for, 0 to poll without blocking
+ * @return ssize_t number of completions stored, negative if failed
+ *
+ * @details
+ *  The result member of each completion is the number of sectors transferred,
+ * or negative if the request failed. Requests may complete in any order.
+ */
+OFSL_INLINE
+static inline ssize_t ofsl_drive_reap_completion(OFSL_Drive* drv, OFSL_DriveCompletion* comp, size_t max, size_t min)
+{
+    if (!drv->ops->reap_completion) {
+        return -1;
+    }
+    return drv->ops->reap_completion(drv, comp, max, min);
+}
+
+/**
+ * @brief Write back the data buffered by the drive and make it durable
+ *
+ * @param drv drive object
+ * @return int 0 if succeed, nonzero otherwise
+ *
+ * @details
+ *  Drives stacked on other drives flush their own buffers first and then the
+ * drive below them, so flushing the top of a stack reaches the storage.
+ * Drives which buffer nothing and have no storage to synchronize do nothing.
+ */
+OFSL_INLINE
+static inline int ofsl_drive_flush(OFSL_Drive* drv)
+{
+    if (!drv->ops->flush) {
+        return 0;
+    }
+    return drv->ops->flush(drv);
+}
+
 #ifdef __cplusplus
 };
 #endif
@@ -0,0 +1,37 @@
+#ifndef OFSL_DRIVE_GZIMAGE_H__
+#define OFSL_DRIVE_GZIMAGE_H__
+
+#include <ofsl/drive/drive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Open a gzip-compressed disk image file as a read-only drive
+ *
+ * @param name path of the compressed image file
+ * @param index_name path of the seek index file, NULL to keep it in memory only
+ * @param sector_size sector size of the image in bytes
+ * @return OFSL_Drive* drive object, NULL if failed
+ *
+ * @details
+ *  The image is decompressed once on creation to build an index of the points
+ * where decompression can be resumed, about every megabyte of image data.
+ * A sector read then inflates only the span of the image between two points,
+ * and the most recently used spans are kept decompressed in memory.
+ *
+ *  If `index_name` is given, the index is loaded from the file when it matches
+ * the image, and written to it otherwise, so the image is not decompressed
+ * again the next time. Failing to write the index is not an error.
+ *
+ *  Only images compressed as a single gzip member are supported, and the
+ * drive is unavailable if the library is built without zlib.
+ */
+OFSL_Drive* ofsl_drive_gzimage_create(const char* name, const char* index_name, size_t sector_size);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef OFSL_DRIVE_MEMORY_H__
+#define OFSL_DRIVE_MEMORY_H__
+
+#include <ofsl/drive/drive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Create a zero-filled drive in memory
+ *
+ * @param size size of the drive in bytes, a multiple of the sector size
+ * @param sector_size sector size of the drive in bytes
+ * @return OFSL_Drive* drive object, NULL if failed
+ *
+ * @details
+ *  The data is allocated on the heap and released with the drive. Like every
+ * memory drive, it supports ofsl_drive_map_sector().
+ */
+OFSL_Drive* ofsl_drive_memory_create(size_t size, size_t sector_size);
+
+/**
+ * @brief Use a buffer of the caller as a drive
+ *
+ * @param buf disk image data, not owned by the drive
+ * @param len length of the data in bytes, a multiple of the sector size
+ * @param readonly refuse writes to the buffer if nonzero
+ * @param sector_size sector size of the image in bytes
+ * @return OFSL_Drive* drive object, NULL if failed
+ *
+ * @details
+ *  The buffer is accessed in place, so it must outlive the drive. Writes
+ * modify it directly.
+ */
+OFSL_Drive* ofsl_drive_memory_from_buffer(void* buf, size_t len, int readonly, size_t sector_size);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
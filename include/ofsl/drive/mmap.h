@@ -0,0 +1,29 @@
+#ifndef OFSL_DRIVE_MMAP_H__
+#define OFSL_DRIVE_MMAP_H__
+
+#include <ofsl/drive/drive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Map a raw disk image file in memory as a drive
+ *
+ * @param name path of the image file
+ * @param readonly map the image without write permission if nonzero
+ * @param sector_size sector size of the image in bytes
+ * @return OFSL_Drive* drive object, NULL if failed
+ *
+ * @details
+ *  The whole image is mapped at once. Besides the usual copying sector I/O,
+ * the drive supports ofsl_drive_map_sector() which returns pointers into the
+ * mapping directly.
+ */
+OFSL_Drive* ofsl_drive_mmap_create(const char* name, int readonly, size_t sector_size);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef OFSL_DRIVE_OVERLAY_H__
+#define OFSL_DRIVE_OVERLAY_H__
+
+#include <ofsl/drive/drive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OFSL_DRIVE_OVERLAY_NEW          0x01    /* discard the existing overlay file */
+
+/**
+ * @brief Create a writable copy-on-write drive over a base drive
+ *
+ * @param base drive holding the original data, not owned by the overlay drive
+ * @param name path of the overlay file
+ * @param block_sectors number of sectors per overlay block
+ * @param flags combination of OFSL_DRIVE_OVERLAY_* flags
+ * @return OFSL_Drive* drive object, NULL if failed
+ *
+ * @details
+ *  Writes never reach the base drive. The first write to a block copies the
+ * block from the base drive into the overlay file, and later reads of the
+ * block are served from the file. The file holds a header, a bitmap of the
+ * copied blocks and a data area laid out like the drive, so it stays sparse
+ * and only grows with the written blocks.
+ *
+ *  An existing overlay file is reopened with its changes unless
+ * OFSL_DRIVE_OVERLAY_NEW is given, in which case it is created or truncated.
+ * Reopening fails if the file was made for a base drive of another geometry
+ * or with another block size. Only the sector size of the base drive is
+ * accepted for the requests.
+ */
+OFSL_Drive* ofsl_drive_overlay_create(OFSL_Drive* base, const char* name, size_t block_sectors, int flags);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
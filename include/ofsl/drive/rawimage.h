@@ -7,7 +7,37 @@
 extern "C" {
 #endif
 
-OFSL_Drive* ofsl_drive_rawimage_create(const char* name, int readonly, size_t sector_size);
+#define OFSL_DRIVE_RAWIMAGE_READONLY    0x01    /* open without write permission */
+#define OFSL_DRIVE_RAWIMAGE_DIRECT      0x02    /* bypass the page cache of the host */
+
+/**
+ * @brief Open a raw disk image file as a drive
+ *
+ * @param name path of the image file
+ * @param flags combination of OFSL_DRIVE_RAWIMAGE_* flags
+ * @param sector_size sector size of the image in bytes
+ * @return OFSL_Drive* drive object, NULL if failed
+ *
+ * @details
+ *  Every sector transfer is done with positional I/O (preadv/pwritev) on the
+ * image file, so multiple threads may read or write the same drive object at
+ * once without sharing a file cursor.
+ *
+ *  Asynchronous requests are submitted through io_uring on Linux, falling back
+ * to a small pool of worker threads if it is unavailable. Only the sector size
+ * of the image is accepted for them, and completions should be reaped by one
+ * thread at a time.
+ *
+ *  With OFSL_DRIVE_RAWIMAGE_DIRECT, the image is opened with O_DIRECT (or
+ * F_NOCACHE on macOS) so the data is cached only by the caller. With O_DIRECT,
+ * the size of the image must be a multiple of the page size. Transfers with
+ * buffers from ofsl_drive_alloc_buffer() on page-aligned sector ranges go
+ * straight to the image; the others are bounced through an aligned buffer, and
+ * writes of partial pages become read-modify-write cycles which are not atomic
+ * against other threads writing the same page. Asynchronous requests are
+ * accepted only if they need no bounce buffer.
+ */
+OFSL_Drive* ofsl_drive_rawimage_create(const char* name, int flags, size_t sector_size);
 
 #ifdef __cplusplus
 };
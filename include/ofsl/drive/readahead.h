@@ -0,0 +1,34 @@
+#ifndef OFSL_DRIVE_READAHEAD_H__
+#define OFSL_DRIVE_READAHEAD_H__
+
+#include <ofsl/drive/drive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Create a readahead drive on top of another drive
+ *
+ * @param lower drive to read from, not owned by the readahead drive
+ * @param window_max maximum number of sectors read ahead
+ * @return OFSL_Drive* drive object, NULL if failed
+ *
+ * @details
+ *  While the reads stay sequential, each read of the lower drive also fetches
+ * a window of the following sectors in the same vectored request, and the
+ * window doubles on every refill up to `window_max`. Reads served from the
+ * window leave it as is. A read out of the sequence turns readahead off until
+ * the next sequential read.
+ *
+ *  Writes go through to the lower drive and discard the sectors read ahead.
+ * Requests with a sector size other than the one of the lower drive bypass the
+ * readahead.
+ */
+OFSL_Drive* ofsl_drive_readahead_create(OFSL_Drive* lower, size_t window_max);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef OFSL_DRIVE_STATS_H__
+#define OFSL_DRIVE_STATS_H__
+
+#include <ofsl/drive/drive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* bucket i counts latencies of [2^i, 2^(i+1)) microseconds, the first one
+ * also takes less than a microsecond and the last one anything longer */
+#define OFSL_DRIVE_STATS_HIST_BUCKETS   32
+
+typedef struct {
+    uint64_t ops;               /* number of requests */
+    uint64_t sectors;           /* number of sectors transferred */
+    uint64_t sequential;        /* requests starting where the previous one ended */
+    uint64_t errors;            /* requests which transferred less than requested */
+    uint64_t latency_ns;        /* total time spent in the lower drive */
+    uint64_t latency_hist[OFSL_DRIVE_STATS_HIST_BUCKETS];
+} OFSL_DriveOpStats;
+
+typedef struct {
+    OFSL_DriveOpStats read;
+    OFSL_DriveOpStats write;
+    uint64_t flushes;
+} OFSL_DriveStats;
+
+/**
+ * @brief Create a drive recording the I/O statistics of another drive
+ *
+ * @param lower drive to measure, not owned by the statistics drive
+ * @return OFSL_Drive* drive object, NULL if failed
+ *
+ * @details
+ *  Every request is passed to the lower drive as is. Sector reads and writes,
+ * vectored ones included, are counted per direction with their latency; a
+ * vectored request counts as one request. Asynchronous requests are counted
+ * when their completions are reaped, with the latency from the submission to
+ * the reap. Mapped sectors are not counted.
+ */
+OFSL_Drive* ofsl_drive_stats_create(OFSL_Drive* lower);
+
+/**
+ * @brief Take a snapshot of the statistics
+ *
+ * @param drv drive object created by ofsl_drive_stats_create()
+ * @param stats statistics output
+ * @return int 0 if succeed, nonzero if the drive does not record statistics
+ */
+int ofsl_drive_stats_get(OFSL_Drive* drv, OFSL_DriveStats* stats);
+
+/**
+ * @brief Clear the statistics
+ *
+ * @param drv drive object created by ofsl_drive_stats_create()
+ * @return int 0 if succeed, nonzero if the drive does not record statistics
+ */
+int ofsl_drive_stats_reset(OFSL_Drive* drv);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
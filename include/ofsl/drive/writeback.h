@@ -0,0 +1,33 @@
+#ifndef OFSL_DRIVE_WRITEBACK_H__
+#define OFSL_DRIVE_WRITEBACK_H__
+
+#include <ofsl/drive/drive.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Create a write-back drive collecting the writes to another drive
+ *
+ * @param lower drive to write to, not owned by the write-back drive
+ * @param dirty_max number of bytes held before they are written back
+ * @return OFSL_Drive* drive object, NULL if failed
+ *
+ * @details
+ *  Written sectors are kept in memory until ofsl_drive_flush() is called, the
+ * held data reaches `dirty_max` bytes or the drive is deleted. They are then
+ * sorted by LBA address, adjacent sectors are merged into contiguous ranges,
+ * and every range is written to the lower drive with a single vectored write.
+ * Reads see the held sectors.
+ *
+ *  Requests with a sector size other than the one of the lower drive write
+ * back every held sector first and go straight to the lower drive.
+ */
+OFSL_Drive* ofsl_drive_writeback_create(OFSL_Drive* lower, size_t dirty_max);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
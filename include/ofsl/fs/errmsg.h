@@ -13,7 +13,8 @@ typedef enum {
     OFSL_FSE_ICLUSTER   = 3,
     OFSL_FSE_INVALFS    = 4,
     OFSL_FSE_IENTNAME   = 5,
-    OFSL_FSE_MAX        = 5,  /* should be equal to last enum value */
+    OFSL_FSE_IO         = 6,
+    OFSL_FSE_MAX        = 6,  /* should be equal to last enum value */
 } OFSL_FileSystemError;
 
 #ifdef __cplusplus
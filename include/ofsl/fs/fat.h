@@ -9,7 +9,12 @@ extern "C" {
 #endif
 
 struct ofsl_fs_fat_option {
-    unsigned int diskbuf_count;
+    unsigned int diskbuf_count;         /* file data, and the pools without entries */
+    unsigned int fat_diskbuf_count;     /* sectors of the FAT */
+    unsigned int dir_diskbuf_count;     /* directories and the other sectors */
+    unsigned int dcache_count;          /* names cached for path lookups, 0 to disable */
+    OFSL_CachePolicy cache_policy;
+    size_t      max_io_size;            /* bytes per bulk drive read, 0 for no limit */
     unsigned int codepage;
     uint8_t     lfn_enabled : 1;
     uint8_t     unicode_enabled : 1;
@@ -17,6 +22,8 @@ struct ofsl_fs_fat_option {
     uint8_t     case_sensitive : 1;
     uint8_t     sfn_lowercase : 1;
     uint8_t     readonly : 1;
+    uint8_t     diskbuf_hugepage : 1;   /* back large disk buffers with huge pages */
+    uint8_t     fat_in_memory : 1;      /* read the whole FAT at mount */
     char        unknown_char_fallback;
 };
 
@@ -24,6 +31,29 @@ OFSL_FileSystem* ofsl_fs_fat_create(OFSL_Partition* part);
 
 struct ofsl_fs_fat_option* ofsl_fs_fat_get_option(OFSL_FileSystem* fs);
 
+/**
+ * @brief Get the number of free clusters
+ *
+ * @param fs mounted filesystem object
+ * @param count number of free clusters
+ * @return int 0 if succeed, nonzero otherwise
+ *
+ * @details
+ *  The FAT is scanned into a bitmap of the free clusters on the first query,
+ * later ones are answered from the bitmap.
+ */
+int ofsl_fs_fat_get_free_clusters(OFSL_FileSystem* fs, uint32_t* count);
+
+/**
+ * @brief Find the longest run of contiguous free clusters
+ *
+ * @param fs mounted filesystem object
+ * @param first first cluster of the run
+ * @param length number of clusters in the run, 0 if the volume is full
+ * @return int 0 if succeed, nonzero otherwise
+ */
+int ofsl_fs_fat_get_free_run(OFSL_FileSystem* fs, uint32_t* first, uint32_t* length);
+
 #ifdef __cplusplus
 };
 #endif
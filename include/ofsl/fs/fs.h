@@ -70,6 +70,12 @@ typedef enum {
     OFSL_FATYPE_COMPRESSED,
 } OFSL_FileAttributeType;
 
+/* replacement policy of the disk buffer of a filesystem */
+typedef enum {
+    OFSL_CACHE_LRU = 0,     /* least recently used */
+    OFSL_CACHE_2Q,          /* 2Q, sectors read only once do not evict the others */
+} OFSL_CachePolicy;
+
 struct ofsl_fs_ops;
 
 typedef struct {
@@ -107,6 +113,7 @@ struct ofsl_fs_ops {
     int (*dir_remove)(OFSL_Directory* parent, const char* name);
     OFSL_Directory* (*rootdir_open)(OFSL_FileSystem* fs);
     OFSL_Directory* (*dir_open)(OFSL_Directory* parent, const char* name);
+    OFSL_Directory* (*dir_open_path)(OFSL_FileSystem* fs, const char* path);
     int (*dir_close)(OFSL_Directory* dir);
 
     OFSL_DirectoryIterator* (*dir_iter_start)(OFSL_Directory* dir);
@@ -122,6 +129,7 @@ struct ofsl_fs_ops {
     int (*file_create)(OFSL_Directory* parent, const char* name);
     int (*file_remove)(OFSL_Directory* parent, const char* name);
     OFSL_File* (*file_open)(OFSL_Directory* parent, const char* name, const char* mode);
+    OFSL_File* (*file_open_path)(OFSL_FileSystem* fs, const char* path, const char* mode);
     int (*file_close)(OFSL_File* file);
     ssize_t (*file_read)(OFSL_File* file, void* buf, size_t size, size_t count);
     ssize_t (*file_write)(OFSL_File* file, const void* buf, size_t size, size_t count);
@@ -192,6 +200,24 @@ static inline OFSL_Directory* ofsl_dir_open(OFSL_Directory* parent, const char*
     return parent->ops->dir_open(parent, name);
 }
 
+/**
+ * @brief Open a directory by its path from the root directory
+ *
+ * @param fs mounted filesystem object
+ * @param path components separated by '/', the root directory if empty
+ * @return OFSL_Directory* directory object, NULL if failed
+ *
+ * @details
+ *  Components are resolved through the dentry cache of the filesystem, so
+ * opening the same paths again does not scan the directories on the way.
+ * The directory is not a child of any open directory.
+ */
+OFSL_INLINE
+static inline OFSL_Directory* ofsl_fs_dir_open_path(OFSL_FileSystem* fs, const char* path)
+{
+    return fs->ops->dir_open_path(fs, path);
+}
+
 OFSL_INLINE
 static inline int ofsl_dir_close(OFSL_Directory* dir)
 {
@@ -264,6 +290,23 @@ static inline OFSL_File* ofsl_file_open(OFSL_Directory* parent, const char* name
     return parent->ops->file_open(parent, name, mode);
 }
 
+/**
+ * @brief Open a file by its path from the root directory
+ *
+ * @param fs mounted filesystem object
+ * @param path components separated by '/'
+ * @param mode open mode, as ofsl_file_open()
+ * @return OFSL_File* file object, NULL if failed
+ *
+ * @details
+ *  Resolved like ofsl_fs_dir_open_path().
+ */
+OFSL_INLINE
+static inline OFSL_File* ofsl_fs_file_open_path(OFSL_FileSystem* fs, const char* path, const char* mode)
+{
+    return fs->ops->file_open_path(fs, path, mode);
+}
+
 OFSL_INLINE
 static inline int ofsl_file_close(OFSL_File* file)
 {
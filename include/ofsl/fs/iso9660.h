@@ -11,6 +11,8 @@ extern "C" {
 
 struct ofsl_fs_iso9660_option {
     unsigned int diskbuf_count;
+    unsigned int dcache_count;      /* names cached for path lookups, 0 to disable */
+    OFSL_CachePolicy cache_policy;
     uint8_t case_sensitive : 1;
     uint8_t enable_rock_ridge : 1;
     uint8_t enable_joilet : 1;
@@ -0,0 +1,214 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ofsl/drive/cache.h>
+#include <ofsl/drive/memory.h>
+#include <ofsl/drive/rawimage.h>
+
+#define TEST_SECTOR_SIZE 512
+
+OFSL_Drive* lower;
+OFSL_Drive* drive;
+
+static int init_test_suite(void)
+{
+    lower = ofsl_drive_rawimage_create("tests/data/drive/rawimage.img", 0, TEST_SECTOR_SIZE);
+    assert(lower);
+    drive = ofsl_drive_cache_create(lower, TEST_SECTOR_SIZE * 2, 1, 0);
+    assert(drive);
+    return 0;
+}
+
+static int clean_test_suite(void)
+{
+    ofsl_drive_delete(drive);
+    ofsl_drive_delete(lower);
+    return 0;
+}
+
+static void test_create(void)
+{
+    CU_ASSERT_PTR_NULL(ofsl_drive_cache_create(NULL, 4096, 1, 0));
+    CU_ASSERT_PTR_NULL(ofsl_drive_cache_create(lower, 4096, 0, 0));
+
+    OFSL_Drive* testdrv;
+    CU_ASSERT_PTR_NOT_NULL(testdrv = ofsl_drive_cache_create(lower, 0, 4, 0));
+    CU_ASSERT_EQUAL(testdrv->drvinfo.sector_size, lower->drvinfo.sector_size);
+    CU_ASSERT_EQUAL(testdrv->drvinfo.lba_max, lower->drvinfo.lba_max);
+    ofsl_drive_delete(testdrv);
+}
+
+static void test_read_sector(void)
+{
+    OFSL_Drive* image = ofsl_drive_rawimage_create(
+        "tests/data/fat/fat12.img",
+        OFSL_DRIVE_RAWIMAGE_READONLY,
+        TEST_SECTOR_SIZE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(image);
+
+    /* small budget to make blocks evicted while reading */
+    OFSL_Drive* cached = ofsl_drive_cache_create(image, TEST_SECTOR_SIZE * 4 * 8, 4, 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cached);
+
+    uint8_t buf[TEST_SECTOR_SIZE * 64];
+    uint8_t expected[TEST_SECTOR_SIZE * 64];
+    srand(0);
+    for (int i = 0; i < 256; i++) {
+        lba_t lba = rand() % 128;
+        size_t cnt = 1 + rand() % 64;
+        CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, expected, lba, TEST_SECTOR_SIZE, cnt), cnt);
+        CU_ASSERT_EQUAL(ofsl_drive_read_sector(cached, buf, lba, TEST_SECTOR_SIZE, cnt), cnt);
+        CU_ASSERT_EQUAL(memcmp(buf, expected, cnt * TEST_SECTOR_SIZE), 0);
+    }
+
+    /* partial read at the end of the drive */
+    const lba_t lba_max = cached->drvinfo.lba_max;
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(cached, buf, lba_max - 1, TEST_SECTOR_SIZE, 4), 2);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(cached, buf, lba_max + 1, TEST_SECTOR_SIZE, 1), 0);
+
+    /* smaller sector size bypasses the cache */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(cached, buf, 0, TEST_SECTOR_SIZE / 2, 2), 2);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, expected, 0, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(memcmp(buf, expected, TEST_SECTOR_SIZE / 2), 0);
+    CU_ASSERT_EQUAL(memcmp(buf + TEST_SECTOR_SIZE / 2, expected + TEST_SECTOR_SIZE, TEST_SECTOR_SIZE / 2), 0);
+
+    ofsl_drive_delete(cached);
+    ofsl_drive_delete(image);
+}
+
+static void test_write_through(void)
+{
+    uint8_t orig[TEST_SECTOR_SIZE];
+    uint8_t buf[TEST_SECTOR_SIZE];
+    uint8_t rbuf[TEST_SECTOR_SIZE];
+
+    /* cache the sector first */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, orig, 1, TEST_SECTOR_SIZE, 1), 1);
+
+    memcpy(buf, orig, sizeof(buf));
+    buf[16] ^= 0xFF;
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, 1, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(lower, rbuf, 1, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, sizeof(buf)), 0);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, rbuf, 1, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, sizeof(buf)), 0);
+
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, orig, 1, TEST_SECTOR_SIZE, 1), 1);
+}
+
+static void test_write_back(void)
+{
+    uint8_t orig[TEST_SECTOR_SIZE * 4];
+    uint8_t buf[TEST_SECTOR_SIZE * 4];
+    uint8_t rbuf[TEST_SECTOR_SIZE * 4];
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(lower, orig, 0, TEST_SECTOR_SIZE, 4), 4);
+
+    /* room for a single block of 2 sectors */
+    OFSL_Drive* cached = ofsl_drive_cache_create(
+        lower,
+        TEST_SECTOR_SIZE * 2,
+        2,
+        OFSL_DRIVE_CACHE_WRITEBACK);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cached);
+
+    /* partial block write keeps the rest of the block */
+    memcpy(buf, orig, sizeof(buf));
+    buf[TEST_SECTOR_SIZE + 16] ^= 0xFF;
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(cached, buf + TEST_SECTOR_SIZE, 1, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(cached, rbuf, 0, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, TEST_SECTOR_SIZE * 2), 0);
+
+    /* not written to the lower drive yet */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(lower, rbuf, 0, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(memcmp(rbuf, orig, TEST_SECTOR_SIZE * 2), 0);
+
+    /* written back on eviction */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(cached, rbuf, 2, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(lower, rbuf, 0, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, TEST_SECTOR_SIZE * 2), 0);
+
+    /* written back on flush */
+    buf[16] ^= 0xFF;
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(cached, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_flush(cached), 0);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(lower, rbuf, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, TEST_SECTOR_SIZE), 0);
+
+    /* written back on delete */
+    buf[TEST_SECTOR_SIZE * 3 + 16] ^= 0xFF;
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(cached, buf + TEST_SECTOR_SIZE * 3, 3, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(lower, rbuf, 3, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(rbuf, orig + TEST_SECTOR_SIZE * 3, TEST_SECTOR_SIZE), 0);
+    ofsl_drive_delete(cached);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(lower, rbuf, 0, TEST_SECTOR_SIZE, 4), 4);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, sizeof(buf)), 0);
+
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(lower, orig, 0, TEST_SECTOR_SIZE, 4), 4);
+}
+
+static void test_write_back_failure(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE];
+    uint8_t rbuf[TEST_SECTOR_SIZE];
+    OFSL_Drive* mem = ofsl_drive_memory_create(TEST_SECTOR_SIZE * 4, TEST_SECTOR_SIZE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mem);
+    OFSL_Drive* cached = ofsl_drive_cache_create(
+        mem,
+        TEST_SECTOR_SIZE,
+        1,
+        OFSL_DRIVE_CACHE_WRITEBACK);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(cached);
+
+    memset(buf, 0xA5, sizeof(buf));
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(cached, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+
+    /* the dirty block can neither be evicted nor flushed */
+    mem->drvinfo.readonly = 1;
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(cached, rbuf, 1, TEST_SECTOR_SIZE, 1), 0);
+    CU_ASSERT_NOT_EQUAL(ofsl_drive_flush(cached), 0);
+
+    /* and is still written back once the lower drive accepts it */
+    mem->drvinfo.readonly = 0;
+    CU_ASSERT_EQUAL(ofsl_drive_flush(cached), 0);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(mem, rbuf, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, sizeof(buf)), 0);
+
+    ofsl_drive_delete(cached);
+    ofsl_drive_delete(mem);
+}
+
+int main(int argc, char** argv)
+{
+    CU_pSuite pSuite = NULL;
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return CU_get_error();
+    }
+
+    pSuite = CU_add_suite("drive/cache", init_test_suite, clean_test_suite);
+    if (pSuite == NULL) {
+        goto error_exit;
+    }
+
+    if ((CU_add_test(pSuite, "create", test_create) == NULL) ||
+        (CU_add_test(pSuite, "read sector", test_read_sector) == NULL) ||
+        (CU_add_test(pSuite, "write through", test_write_through) == NULL) ||
+        (CU_add_test(pSuite, "write back", test_write_back) == NULL) ||
+        (CU_add_test(pSuite, "write back failure", test_write_back_failure) == NULL)) {
+        goto error_exit;
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+
+    int tests_failed = CU_get_run_summary()->nTestsFailed;
+    CU_cleanup_registry();
+    return tests_failed;
+
+error_exit:
+    CU_cleanup_registry();
+    return CU_get_error();
+}
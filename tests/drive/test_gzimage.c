@@ -0,0 +1,157 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ofsl/drive/gzimage.h>
+#include <ofsl/drive/rawimage.h>
+
+#define TEST_SECTOR_SIZE 512
+#define TEST_INDEX_PATH "tests/data/partition/mbr.img.gzi"
+
+OFSL_Drive* image;
+OFSL_Drive* drive;
+
+static int init_test_suite(void)
+{
+    image = ofsl_drive_rawimage_create(
+        "tests/data/partition/mbr.img",
+        OFSL_DRIVE_RAWIMAGE_READONLY,
+        TEST_SECTOR_SIZE);
+    assert(image);
+    drive = ofsl_drive_gzimage_create("tests/data/partition/mbr.img.gz", NULL, TEST_SECTOR_SIZE);
+    assert(drive);
+    return 0;
+}
+
+static int clean_test_suite(void)
+{
+    ofsl_drive_delete(drive);
+    ofsl_drive_delete(image);
+    return 0;
+}
+
+static void test_create(void)
+{
+    CU_ASSERT_PTR_NULL(ofsl_drive_gzimage_create("", NULL, TEST_SECTOR_SIZE));
+    /* not compressed */
+    CU_ASSERT_PTR_NULL(ofsl_drive_gzimage_create("tests/data/drive/rawimage.img", NULL, TEST_SECTOR_SIZE));
+
+    CU_ASSERT_EQUAL(drive->drvinfo.sector_size, TEST_SECTOR_SIZE);
+    CU_ASSERT_EQUAL(drive->drvinfo.lba_max, image->drvinfo.lba_max);
+    CU_ASSERT(drive->drvinfo.readonly);
+}
+
+static void test_read_sector(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE * 64];
+    uint8_t expected[TEST_SECTOR_SIZE * 64];
+    const lba_t lba_max = drive->drvinfo.lba_max;
+
+    srand(0);
+    for (int i = 0; i < 256; i++) {
+        lba_t lba = rand() % (lba_max + 1);
+        size_t cnt = 1 + rand() % 64;
+        ssize_t ret = ofsl_drive_read_sector(image, expected, lba, TEST_SECTOR_SIZE, cnt);
+        CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, lba, TEST_SECTOR_SIZE, cnt), ret);
+        CU_ASSERT_EQUAL(memcmp(buf, expected, ret * TEST_SECTOR_SIZE), 0);
+    }
+
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, lba_max - 1, TEST_SECTOR_SIZE, 4), 2);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, lba_max + 1, TEST_SECTOR_SIZE, 1), 0);
+
+    /* read only */
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, 0, TEST_SECTOR_SIZE, 1), 0);
+}
+
+static void test_index_file(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE];
+    uint8_t expected[TEST_SECTOR_SIZE];
+    const lba_t lba = image->drvinfo.lba_max / 2;
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, expected, lba, TEST_SECTOR_SIZE, 1), 1);
+
+    remove(TEST_INDEX_PATH);
+
+    /* written on the first open, then loaded */
+    for (int i = 0; i < 2; i++) {
+        OFSL_Drive* testdrv = ofsl_drive_gzimage_create(
+            "tests/data/partition/mbr.img.gz",
+            TEST_INDEX_PATH,
+            TEST_SECTOR_SIZE);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(testdrv);
+        CU_ASSERT_EQUAL(testdrv->drvinfo.lba_max, image->drvinfo.lba_max);
+        CU_ASSERT_EQUAL(ofsl_drive_read_sector(testdrv, buf, lba, TEST_SECTOR_SIZE, 1), 1);
+        CU_ASSERT_EQUAL(memcmp(buf, expected, sizeof(buf)), 0);
+        ofsl_drive_delete(testdrv);
+
+        FILE* fp = fopen(TEST_INDEX_PATH, "rb");
+        CU_ASSERT_PTR_NOT_NULL(fp);
+        if (fp) {
+            fclose(fp);
+        }
+    }
+
+    /* index not starting at offset 0 is rebuilt */
+    FILE* fp = fopen(TEST_INDEX_PATH, "r+b");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(fp);
+    const uint8_t bad_out = 1;
+    CU_ASSERT_EQUAL(fseek(fp, 8 + 4 * 8, SEEK_SET), 0);
+    CU_ASSERT_EQUAL(fwrite(&bad_out, 1, 1, fp), 1);
+    fclose(fp);
+
+    OFSL_Drive* testdrv = ofsl_drive_gzimage_create(
+        "tests/data/partition/mbr.img.gz",
+        TEST_INDEX_PATH,
+        TEST_SECTOR_SIZE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(testdrv);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, expected, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(testdrv, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(buf, expected, sizeof(buf)), 0);
+    ofsl_drive_delete(testdrv);
+
+    /* index of another image is rebuilt */
+    testdrv = ofsl_drive_gzimage_create(
+        "tests/data/partition/gpt.img.gz",
+        TEST_INDEX_PATH,
+        TEST_SECTOR_SIZE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(testdrv);
+    CU_ASSERT_EQUAL(testdrv->drvinfo.lba_max, 4 * 1024 * 1024 / TEST_SECTOR_SIZE - 1);
+    ofsl_drive_delete(testdrv);
+
+    remove(TEST_INDEX_PATH);
+}
+
+int main(int argc, char** argv)
+{
+    CU_pSuite pSuite = NULL;
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return CU_get_error();
+    }
+
+    pSuite = CU_add_suite("drive/gzimage", init_test_suite, clean_test_suite);
+    if (pSuite == NULL) {
+        goto error_exit;
+    }
+
+    if ((CU_add_test(pSuite, "create", test_create) == NULL) ||
+        (CU_add_test(pSuite, "read sector", test_read_sector) == NULL) ||
+        (CU_add_test(pSuite, "index file", test_index_file) == NULL)) {
+        goto error_exit;
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+
+    int tests_failed = CU_get_run_summary()->nTestsFailed;
+    CU_cleanup_registry();
+    return tests_failed;
+
+error_exit:
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -0,0 +1,119 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ofsl/drive/memory.h>
+#include <ofsl/drive/rawimage.h>
+
+#define TEST_SECTOR_SIZE 512
+#define TEST_SECTOR_COUNT 4
+
+uint8_t image[TEST_SECTOR_SIZE * TEST_SECTOR_COUNT];
+OFSL_Drive* drive;
+
+static int init_test_suite(void)
+{
+    OFSL_Drive* rawdrv = ofsl_drive_rawimage_create(
+        "tests/data/drive/rawimage.img",
+        OFSL_DRIVE_RAWIMAGE_READONLY,
+        TEST_SECTOR_SIZE);
+    assert(rawdrv);
+    ofsl_drive_read_sector(rawdrv, image, 0, TEST_SECTOR_SIZE, TEST_SECTOR_COUNT);
+    ofsl_drive_delete(rawdrv);
+
+    drive = ofsl_drive_memory_from_buffer(image, sizeof(image), 0, TEST_SECTOR_SIZE);
+    assert(drive);
+    return 0;
+}
+
+static int clean_test_suite(void)
+{
+    ofsl_drive_delete(drive);
+    return 0;
+}
+
+static void test_create(void)
+{
+    CU_ASSERT_PTR_NULL(ofsl_drive_memory_create(0, TEST_SECTOR_SIZE));
+    CU_ASSERT_PTR_NULL(ofsl_drive_memory_create(TEST_SECTOR_SIZE + 1, TEST_SECTOR_SIZE));
+    CU_ASSERT_PTR_NULL(ofsl_drive_memory_from_buffer(NULL, sizeof(image), 0, TEST_SECTOR_SIZE));
+    CU_ASSERT_PTR_NULL(ofsl_drive_memory_from_buffer(image, sizeof(image) - 1, 0, TEST_SECTOR_SIZE));
+
+    OFSL_Drive* testdrv = ofsl_drive_memory_create(TEST_SECTOR_SIZE * 8, TEST_SECTOR_SIZE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(testdrv);
+    CU_ASSERT_EQUAL(testdrv->drvinfo.sector_size, TEST_SECTOR_SIZE);
+    CU_ASSERT_EQUAL(testdrv->drvinfo.lba_max, 7);
+    CU_ASSERT_FALSE(testdrv->drvinfo.readonly);
+
+    /* zero filled */
+    uint8_t buf[TEST_SECTOR_SIZE];
+    uint8_t zero[TEST_SECTOR_SIZE] = { 0 };
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(testdrv, buf, 7, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(buf, zero, sizeof(buf)), 0);
+    ofsl_drive_delete(testdrv);
+
+    CU_ASSERT_EQUAL(drive->drvinfo.lba_max, TEST_SECTOR_COUNT - 1);
+}
+
+static void test_read_sector(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE * 2];
+
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 1, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(memcmp(buf, image + TEST_SECTOR_SIZE, sizeof(buf)), 0);
+
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, TEST_SECTOR_COUNT - 1, TEST_SECTOR_SIZE, 2), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, TEST_SECTOR_COUNT, TEST_SECTOR_SIZE, 1), 0);
+
+    /* mapped in place */
+    CU_ASSERT_PTR_EQUAL(ofsl_drive_map_sector(drive, 2, 2), image + TEST_SECTOR_SIZE * 2);
+    CU_ASSERT_PTR_NULL(ofsl_drive_map_sector(drive, 3, 2));
+}
+
+static void test_write_sector(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE];
+
+    memset(buf, 0xA5, sizeof(buf));
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, 3, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(image + TEST_SECTOR_SIZE * 3, buf, sizeof(buf)), 0);
+
+    OFSL_Drive* rodrv = ofsl_drive_memory_from_buffer(image, sizeof(image), 1, TEST_SECTOR_SIZE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(rodrv);
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(rodrv, buf, 0, TEST_SECTOR_SIZE, 1), 0);
+    ofsl_drive_delete(rodrv);
+}
+
+int main(int argc, char** argv)
+{
+    CU_pSuite pSuite = NULL;
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return CU_get_error();
+    }
+
+    pSuite = CU_add_suite("drive/memory", init_test_suite, clean_test_suite);
+    if (pSuite == NULL) {
+        goto error_exit;
+    }
+
+    if ((CU_add_test(pSuite, "create", test_create) == NULL) ||
+        (CU_add_test(pSuite, "read sector", test_read_sector) == NULL) ||
+        (CU_add_test(pSuite, "write sector", test_write_sector) == NULL)) {
+        goto error_exit;
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+
+    int tests_failed = CU_get_run_summary()->nTestsFailed;
+    CU_cleanup_registry();
+    return tests_failed;
+
+error_exit:
+    CU_cleanup_registry();
+    return CU_get_error();
+}
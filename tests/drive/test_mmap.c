@@ -0,0 +1,135 @@
+#include <assert.h>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ofsl/drive/mmap.h>
+#include <ofsl/drive/rawimage.h>
+
+#define TEST_SECTOR_SIZE 512
+
+OFSL_Drive* drive;
+
+static int init_test_suite(void)
+{
+    drive = ofsl_drive_mmap_create("tests/data/drive/rawimage.img", 0, TEST_SECTOR_SIZE);
+    assert(drive);
+    return 0;
+}
+
+static int clean_test_suite(void)
+{
+    ofsl_drive_delete(drive);
+    return 0;
+}
+
+static void test_create(void)
+{
+    OFSL_Drive* testdrv;
+    CU_ASSERT_PTR_NOT_NULL(testdrv = ofsl_drive_mmap_create("tests/data/drive/rawimage.img", 1, TEST_SECTOR_SIZE));
+    ofsl_drive_delete(testdrv);
+
+    /* invalid file name */
+    CU_ASSERT_PTR_NULL(ofsl_drive_mmap_create("", 0, TEST_SECTOR_SIZE));
+}
+
+static void test_read_sector(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE * 2];
+    uint8_t raw_buf[TEST_SECTOR_SIZE * 2];
+    OFSL_Drive* rawdrv = ofsl_drive_rawimage_create("tests/data/drive/rawimage.img", 1, TEST_SECTOR_SIZE);
+
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 1, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(rawdrv, raw_buf, 1, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(memcmp(buf, raw_buf, sizeof(buf)), 0);
+
+    /* partial read at the end of the image */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, drive->drvinfo.lba_max, TEST_SECTOR_SIZE, 2), 1);
+
+    /* invalid sector size */
+    CU_ASSERT(ofsl_drive_read_sector(drive, buf, 0, 1024, 1) < 1);
+
+    ofsl_drive_delete(rawdrv);
+}
+
+static void test_map_sector(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE * 2];
+    const uint8_t* mapped;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mapped = ofsl_drive_map_sector(drive, 1, 2));
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 1, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(memcmp(buf, mapped, sizeof(buf)), 0);
+
+    /* out of range */
+    CU_ASSERT_PTR_NULL(ofsl_drive_map_sector(drive, drive->drvinfo.lba_max, 2));
+    CU_ASSERT_PTR_NULL(ofsl_drive_map_sector(drive, 0, 0));
+}
+
+static void test_write_sector(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE];
+    const uint8_t wdata[] = {
+        0xFF, 0x00, 0xEE, 0x11, 0xDD, 0x22, 0xCC, 0x33,
+        0xBB, 0x44, 0xAA, 0x55, 0x99, 0x66, 0x88, 0x77,
+    };
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+    memcpy(buf + 16, wdata, sizeof(wdata));
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp((const uint8_t*)ofsl_drive_map_sector(drive, 0, 1) + 16, wdata, sizeof(wdata)), 0);
+    memset(buf + 16, 0, sizeof(wdata));
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+
+    /* invalid sector size */
+    CU_ASSERT(ofsl_drive_write_sector(drive, buf, 0, 1024, 1) < 1);
+}
+
+static void test_read_sectorv(void)
+{
+    /* the generic implementation is used since the drive has no native one */
+    uint8_t buf[TEST_SECTOR_SIZE * 3];
+    uint8_t vbuf[TEST_SECTOR_SIZE * 3];
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, 3), 3);
+
+    OFSL_DriveIOVec iov[] = {
+        { .lba = 2, .cnt = 1, .buf = vbuf },
+        { .lba = 0, .cnt = 2, .buf = vbuf + TEST_SECTOR_SIZE },
+        { .lba = drive->drvinfo.lba_max + 1, .cnt = 1, .buf = vbuf },
+    };
+    CU_ASSERT_EQUAL(ofsl_drive_read_sectorv(drive, iov, 3, TEST_SECTOR_SIZE), 3);
+    CU_ASSERT_EQUAL(memcmp(vbuf, buf + TEST_SECTOR_SIZE * 2, TEST_SECTOR_SIZE), 0);
+    CU_ASSERT_EQUAL(memcmp(vbuf + TEST_SECTOR_SIZE, buf, TEST_SECTOR_SIZE * 2), 0);
+}
+
+int main(int argc, char** argv)
+{
+    CU_pSuite pSuite = NULL;
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return CU_get_error();
+    }
+
+    pSuite = CU_add_suite("drive/mmap", init_test_suite, clean_test_suite);
+    if (pSuite == NULL) {
+        goto error_exit;
+    }
+
+    if ((CU_add_test(pSuite, "create", test_create) == NULL) ||
+        (CU_add_test(pSuite, "read sector", test_read_sector) == NULL) ||
+        (CU_add_test(pSuite, "map sector", test_map_sector) == NULL) ||
+        (CU_add_test(pSuite, "read sectorv", test_read_sectorv) == NULL) ||
+        (CU_add_test(pSuite, "write sector", test_write_sector) == NULL)) {
+        goto error_exit;
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+
+    int tests_failed = CU_get_run_summary()->nTestsFailed;
+    CU_cleanup_registry();
+    return tests_failed;
+
+error_exit:
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -0,0 +1,158 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ofsl/drive/overlay.h>
+#include <ofsl/drive/rawimage.h>
+
+#define TEST_SECTOR_SIZE 512
+#define TEST_BLOCK_SECTORS 8
+#define TEST_OVERLAY_PATH "tests/data/drive/overlay.cow"
+
+OFSL_Drive* base;
+OFSL_Drive* drive;
+
+static int init_test_suite(void)
+{
+    base = ofsl_drive_rawimage_create(
+        "tests/data/fat/fat12.img",
+        OFSL_DRIVE_RAWIMAGE_READONLY,
+        TEST_SECTOR_SIZE);
+    assert(base);
+    drive = ofsl_drive_overlay_create(base, TEST_OVERLAY_PATH, TEST_BLOCK_SECTORS, OFSL_DRIVE_OVERLAY_NEW);
+    assert(drive);
+    return 0;
+}
+
+static int clean_test_suite(void)
+{
+    ofsl_drive_delete(drive);
+    ofsl_drive_delete(base);
+    remove(TEST_OVERLAY_PATH);
+    return 0;
+}
+
+static void test_create(void)
+{
+    CU_ASSERT_PTR_NULL(ofsl_drive_overlay_create(NULL, TEST_OVERLAY_PATH, TEST_BLOCK_SECTORS, 0));
+    CU_ASSERT_PTR_NULL(ofsl_drive_overlay_create(base, TEST_OVERLAY_PATH, 0, 0));
+    CU_ASSERT_PTR_NULL(ofsl_drive_overlay_create(base, "", TEST_BLOCK_SECTORS, 0));
+
+    CU_ASSERT_EQUAL(drive->drvinfo.sector_size, base->drvinfo.sector_size);
+    CU_ASSERT_EQUAL(drive->drvinfo.lba_max, base->drvinfo.lba_max);
+    CU_ASSERT_FALSE(drive->drvinfo.readonly);
+}
+
+static void test_read_sector(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE * 16];
+    uint8_t expected[TEST_SECTOR_SIZE * 16];
+    const lba_t lba_max = drive->drvinfo.lba_max;
+
+    for (lba_t lba = 0; lba <= lba_max; lba += 16) {
+        CU_ASSERT_EQUAL(ofsl_drive_read_sector(base, expected, lba, TEST_SECTOR_SIZE, 16), 16);
+        CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, lba, TEST_SECTOR_SIZE, 16), 16);
+        CU_ASSERT_EQUAL(memcmp(buf, expected, sizeof(buf)), 0);
+    }
+
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, lba_max - 1, TEST_SECTOR_SIZE, 4), 2);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, lba_max + 1, TEST_SECTOR_SIZE, 1), 0);
+}
+
+static void test_write_sector(void)
+{
+    /* reference copy of the beginning of the drive */
+    const size_t sector_cnt = 256;
+    uint8_t* ref = malloc(sector_cnt * TEST_SECTOR_SIZE);
+    uint8_t* buf = malloc(sector_cnt * TEST_SECTOR_SIZE);
+    uint8_t* orig = malloc(sector_cnt * TEST_SECTOR_SIZE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ref);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(buf);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(orig);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(base, ref, 0, TEST_SECTOR_SIZE, sector_cnt), sector_cnt);
+    memcpy(orig, ref, sector_cnt * TEST_SECTOR_SIZE);
+
+    /* partial, whole and multiple block writes */
+    srand(0);
+    for (int i = 0; i < 64; i++) {
+        lba_t lba = rand() % (sector_cnt - 32);
+        size_t cnt = 1 + rand() % 32;
+        for (size_t j = 0; j < cnt * TEST_SECTOR_SIZE; j++) {
+            buf[j] = rand();
+        }
+
+        CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, lba, TEST_SECTOR_SIZE, cnt), cnt);
+        memcpy(ref + lba * TEST_SECTOR_SIZE, buf, cnt * TEST_SECTOR_SIZE);
+    }
+
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, sector_cnt), sector_cnt);
+    CU_ASSERT_EQUAL(memcmp(buf, ref, sector_cnt * TEST_SECTOR_SIZE), 0);
+
+    /* base drive untouched */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(base, buf, 0, TEST_SECTOR_SIZE, sector_cnt), sector_cnt);
+    CU_ASSERT_EQUAL(memcmp(buf, orig, sector_cnt * TEST_SECTOR_SIZE), 0);
+
+    /* last sector of the drive */
+    const lba_t lba_max = drive->drvinfo.lba_max;
+    memset(buf, 0xA5, TEST_SECTOR_SIZE);
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, lba_max, TEST_SECTOR_SIZE, 2), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, orig, lba_max, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(buf, orig, TEST_SECTOR_SIZE), 0);
+
+    /* kept when reopened */
+    ofsl_drive_delete(drive);
+    drive = ofsl_drive_overlay_create(base, TEST_OVERLAY_PATH, TEST_BLOCK_SECTORS, 0);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(drive);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, sector_cnt), sector_cnt);
+    CU_ASSERT_EQUAL(memcmp(buf, ref, sector_cnt * TEST_SECTOR_SIZE), 0);
+
+    /* another block size does not match the file */
+    CU_ASSERT_PTR_NULL(ofsl_drive_overlay_create(base, TEST_OVERLAY_PATH, TEST_BLOCK_SECTORS * 2, 0));
+
+    /* discarded when created anew */
+    ofsl_drive_delete(drive);
+    drive = ofsl_drive_overlay_create(base, TEST_OVERLAY_PATH, TEST_BLOCK_SECTORS, OFSL_DRIVE_OVERLAY_NEW);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(drive);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(base, orig, 0, TEST_SECTOR_SIZE, sector_cnt), sector_cnt);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, sector_cnt), sector_cnt);
+    CU_ASSERT_EQUAL(memcmp(buf, orig, sector_cnt * TEST_SECTOR_SIZE), 0);
+
+    free(orig);
+    free(buf);
+    free(ref);
+}
+
+int main(int argc, char** argv)
+{
+    CU_pSuite pSuite = NULL;
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return CU_get_error();
+    }
+
+    pSuite = CU_add_suite("drive/overlay", init_test_suite, clean_test_suite);
+    if (pSuite == NULL) {
+        goto error_exit;
+    }
+
+    if ((CU_add_test(pSuite, "create", test_create) == NULL) ||
+        (CU_add_test(pSuite, "read sector", test_read_sector) == NULL) ||
+        (CU_add_test(pSuite, "write sector", test_write_sector) == NULL)) {
+        goto error_exit;
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+
+    int tests_failed = CU_get_run_summary()->nTestsFailed;
+    CU_cleanup_registry();
+    return tests_failed;
+
+error_exit:
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -46,6 +46,17 @@ static void test_read_sector(void)
     CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 2, TEST_SECTOR_SIZE, 2), 2);
     CU_ASSERT_EQUAL(memcmp(buf, buf + TEST_SECTOR_SIZE + 16, 16), 0);
 
+    /* partial read at the end of the image */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, drive->drvinfo.lba_max, TEST_SECTOR_SIZE, 2), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, drive->drvinfo.lba_max + 1, TEST_SECTOR_SIZE, 1), 0);
+
+    /* smaller sector size than the image */
+    uint8_t small_buf[TEST_SECTOR_SIZE];
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, small_buf, 0, TEST_SECTOR_SIZE / 2, 2), 2);
+    CU_ASSERT_EQUAL(memcmp(small_buf, buf, TEST_SECTOR_SIZE / 2), 0);
+    CU_ASSERT_EQUAL(memcmp(small_buf + TEST_SECTOR_SIZE / 2, buf + TEST_SECTOR_SIZE, TEST_SECTOR_SIZE / 2), 0);
+
     /* invalid sector size */
     CU_ASSERT(ofsl_drive_read_sector(drive, buf, 0, 1024, 1) < 1);
 }
@@ -64,11 +75,187 @@ static void test_write_sector(void)
     CU_ASSERT_EQUAL(memcmp(buf + 16, wdata, sizeof(wdata)), 0);
     memset(buf + 16, 0, sizeof(wdata));
     CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_flush(drive), 0);
 
     /* invalid sector size */
     CU_ASSERT(ofsl_drive_write_sector(drive, buf, 0, 1024, 1) < 1);
 }
 
+static void test_read_sectorv(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE * 4];
+    uint8_t vbuf[TEST_SECTOR_SIZE * 4];
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, 4), 4);
+
+    /* adjacent segments are merged, the others are not */
+    OFSL_DriveIOVec iov[] = {
+        { .lba = 0, .cnt = 1, .buf = vbuf + TEST_SECTOR_SIZE * 3 },
+        { .lba = 1, .cnt = 2, .buf = vbuf },
+        { .lba = 3, .cnt = 1, .buf = vbuf + TEST_SECTOR_SIZE * 2 },
+    };
+    CU_ASSERT_EQUAL(ofsl_drive_read_sectorv(drive, iov, 3, TEST_SECTOR_SIZE), 4);
+    CU_ASSERT_EQUAL(memcmp(vbuf + TEST_SECTOR_SIZE * 3, buf, TEST_SECTOR_SIZE), 0);
+    CU_ASSERT_EQUAL(memcmp(vbuf, buf + TEST_SECTOR_SIZE, TEST_SECTOR_SIZE * 2), 0);
+    CU_ASSERT_EQUAL(memcmp(vbuf + TEST_SECTOR_SIZE * 2, buf + TEST_SECTOR_SIZE * 3, TEST_SECTOR_SIZE), 0);
+
+    /* stops at the end of the image */
+    OFSL_DriveIOVec iov_end[] = {
+        { .lba = drive->drvinfo.lba_max, .cnt = 2, .buf = vbuf },
+        { .lba = 0, .cnt = 1, .buf = vbuf + TEST_SECTOR_SIZE * 2 },
+    };
+    CU_ASSERT_EQUAL(ofsl_drive_read_sectorv(drive, iov_end, 2, TEST_SECTOR_SIZE), 1);
+
+    /* smaller sector size than the image */
+    OFSL_DriveIOVec iov_small[] = {
+        { .lba = 1, .cnt = 1, .buf = vbuf },
+    };
+    CU_ASSERT_EQUAL(ofsl_drive_read_sectorv(drive, iov_small, 1, TEST_SECTOR_SIZE / 2), 1);
+    CU_ASSERT_EQUAL(memcmp(vbuf, buf + TEST_SECTOR_SIZE, TEST_SECTOR_SIZE / 2), 0);
+}
+
+static void test_write_sectorv(void)
+{
+    uint8_t orig[TEST_SECTOR_SIZE * 3];
+    uint8_t buf[TEST_SECTOR_SIZE * 3];
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, orig, 0, TEST_SECTOR_SIZE, 3), 3);
+
+    memcpy(buf, orig, sizeof(buf));
+    for (int i = 0; i < 16; i++) {
+        buf[16 + i] ^= 0xFF;
+        buf[TEST_SECTOR_SIZE * 2 + 16 + i] ^= 0xFF;
+    }
+
+    OFSL_DriveIOVec iov[] = {
+        { .lba = 2, .cnt = 1, .buf = buf + TEST_SECTOR_SIZE * 2 },
+        { .lba = 0, .cnt = 2, .buf = buf },
+    };
+    uint8_t rbuf[TEST_SECTOR_SIZE * 3];
+    CU_ASSERT_EQUAL(ofsl_drive_write_sectorv(drive, iov, 2, TEST_SECTOR_SIZE), 3);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, rbuf, 0, TEST_SECTOR_SIZE, 3), 3);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, sizeof(buf)), 0);
+
+    /* restore the original data */
+    OFSL_DriveIOVec iov_orig[] = {
+        { .lba = 0, .cnt = 3, .buf = orig },
+    };
+    CU_ASSERT_EQUAL(ofsl_drive_write_sectorv(drive, iov_orig, 1, TEST_SECTOR_SIZE), 3);
+}
+
+static void test_async_io(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE * 4];
+    uint8_t abuf[TEST_SECTOR_SIZE * 4];
+    OFSL_DriveCompletion comp[4];
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, 4), 4);
+
+    /* nothing in flight */
+    CU_ASSERT_EQUAL(ofsl_drive_reap_completion(drive, comp, 4, 1), 0);
+
+    for (int i = 0; i < 4; i++) {
+        CU_ASSERT_FALSE(ofsl_drive_submit_read(drive, abuf + TEST_SECTOR_SIZE * i, 3 - i, TEST_SECTOR_SIZE, 1, 3 - i));
+    }
+    size_t reaped = 0;
+    while (reaped < 4) {
+        ssize_t ret = ofsl_drive_reap_completion(drive, comp + reaped, 4 - reaped, 4 - reaped);
+        CU_ASSERT(ret > 0);
+        if (ret <= 0) break;
+        reaped += ret;
+    }
+    unsigned int tag_seen = 0;
+    for (size_t i = 0; i < reaped; i++) {
+        CU_ASSERT_EQUAL(comp[i].result, 1);
+        tag_seen |= 1 << comp[i].tag;
+    }
+    CU_ASSERT_EQUAL(tag_seen, 0xF);
+    for (int i = 0; i < 4; i++) {
+        CU_ASSERT_EQUAL(memcmp(abuf + TEST_SECTOR_SIZE * i, buf + TEST_SECTOR_SIZE * (3 - i), TEST_SECTOR_SIZE), 0);
+    }
+
+    /* write and restore */
+    memcpy(abuf, buf, TEST_SECTOR_SIZE);
+    abuf[16] ^= 0xFF;
+    CU_ASSERT_FALSE(ofsl_drive_submit_write(drive, abuf, 0, TEST_SECTOR_SIZE, 1, 100));
+    CU_ASSERT_EQUAL(ofsl_drive_reap_completion(drive, comp, 1, 1), 1);
+    CU_ASSERT_EQUAL(comp[0].tag, 100);
+    CU_ASSERT_EQUAL(comp[0].result, 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, abuf + TEST_SECTOR_SIZE, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(abuf[TEST_SECTOR_SIZE + 16], buf[16] ^ 0xFF);
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+
+    /* partial read at the end of the image */
+    CU_ASSERT_FALSE(ofsl_drive_submit_read(drive, abuf, drive->drvinfo.lba_max, TEST_SECTOR_SIZE, 2, 0));
+    CU_ASSERT_EQUAL(ofsl_drive_reap_completion(drive, comp, 1, 1), 1);
+    CU_ASSERT_EQUAL(comp[0].result, 1);
+
+    /* invalid sector size */
+    CU_ASSERT(ofsl_drive_submit_read(drive, abuf, 0, TEST_SECTOR_SIZE / 2, 1, 0));
+}
+
+static void test_direct_io(void)
+{
+    OFSL_Drive* direct = ofsl_drive_rawimage_create(
+        "tests/data/fat/fat12.img",
+        OFSL_DRIVE_RAWIMAGE_DIRECT,
+        TEST_SECTOR_SIZE);
+    OFSL_Drive* buffered = ofsl_drive_rawimage_create(
+        "tests/data/fat/fat12.img",
+        OFSL_DRIVE_RAWIMAGE_READONLY,
+        TEST_SECTOR_SIZE);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(direct);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(buffered);
+
+    /* image size is not a multiple of the page size */
+    if (direct->drvinfo.buf_align > TEST_SECTOR_SIZE * 4) {
+        CU_ASSERT_PTR_NULL(ofsl_drive_rawimage_create("tests/data/drive/rawimage.img", OFSL_DRIVE_RAWIMAGE_DIRECT, TEST_SECTOR_SIZE));
+    }
+
+    uint8_t expected[TEST_SECTOR_SIZE * 9];
+    uint8_t unaligned[TEST_SECTOR_SIZE * 9 + 1];
+    uint8_t* aligned = ofsl_drive_alloc_buffer(direct, TEST_SECTOR_SIZE * 8);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(aligned);
+    if (direct->drvinfo.buf_align) {
+        CU_ASSERT_EQUAL((uintptr_t)aligned % direct->drvinfo.buf_align, 0);
+    }
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(buffered, expected, 0, TEST_SECTOR_SIZE, 9), 9);
+
+    /* aligned buffer on aligned range */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(direct, aligned, 0, TEST_SECTOR_SIZE, 8), 8);
+    CU_ASSERT_EQUAL(memcmp(aligned, expected, TEST_SECTOR_SIZE * 8), 0);
+
+    /* unaligned buffer and range go through the bounce buffer */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(direct, unaligned + 1, 1, TEST_SECTOR_SIZE, 8), 8);
+    CU_ASSERT_EQUAL(memcmp(unaligned + 1, expected + TEST_SECTOR_SIZE, TEST_SECTOR_SIZE * 8), 0);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(direct, unaligned, 1, TEST_SECTOR_SIZE / 2, 2), 2);
+    CU_ASSERT_EQUAL(memcmp(unaligned, expected + TEST_SECTOR_SIZE, TEST_SECTOR_SIZE / 2), 0);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(direct, unaligned, direct->drvinfo.lba_max, TEST_SECTOR_SIZE, 2), 1);
+
+    /* mixed vectored read */
+    OFSL_DriveIOVec iov[] = {
+        { .lba = 0, .cnt = 8, .buf = aligned },
+        { .lba = 8, .cnt = 1, .buf = unaligned + 1 },
+    };
+    memset(aligned, 0, TEST_SECTOR_SIZE * 8);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sectorv(direct, iov, 2, TEST_SECTOR_SIZE), 9);
+    CU_ASSERT_EQUAL(memcmp(aligned, expected, TEST_SECTOR_SIZE * 8), 0);
+    CU_ASSERT_EQUAL(memcmp(unaligned + 1, expected + TEST_SECTOR_SIZE * 8, TEST_SECTOR_SIZE), 0);
+
+    /* partial page write keeps the neighboring sectors */
+    const lba_t lba_last = direct->drvinfo.lba_max;
+    uint8_t orig[TEST_SECTOR_SIZE * 2];
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(buffered, orig, lba_last - 1, TEST_SECTOR_SIZE, 2), 2);
+    memcpy(unaligned + 1, orig + TEST_SECTOR_SIZE, TEST_SECTOR_SIZE);
+    unaligned[1 + 16] ^= 0xFF;
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(direct, unaligned + 1, lba_last, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(buffered, expected, lba_last - 1, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(memcmp(expected, orig, TEST_SECTOR_SIZE), 0);
+    CU_ASSERT_EQUAL(memcmp(expected + TEST_SECTOR_SIZE, unaligned + 1, TEST_SECTOR_SIZE), 0);
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(direct, orig + TEST_SECTOR_SIZE, lba_last, TEST_SECTOR_SIZE, 1), 1);
+
+    ofsl_drive_free_buffer(aligned);
+    ofsl_drive_delete(buffered);
+    ofsl_drive_delete(direct);
+}
+
 int main(int argc, char** argv)
 {
     CU_pSuite pSuite = NULL;
@@ -85,7 +272,11 @@ int main(int argc, char** argv)
     if ((CU_add_test(pSuite, "create", test_create) == NULL) ||
         (CU_add_test(pSuite, "update info", test_update_info) == NULL) ||
         (CU_add_test(pSuite, "read sector", test_read_sector) == NULL) ||
-        (CU_add_test(pSuite, "write sector", test_write_sector) == NULL)) {
+        (CU_add_test(pSuite, "write sector", test_write_sector) == NULL) ||
+        (CU_add_test(pSuite, "read sectorv", test_read_sectorv) == NULL) ||
+        (CU_add_test(pSuite, "write sectorv", test_write_sectorv) == NULL) ||
+        (CU_add_test(pSuite, "async io", test_async_io) == NULL) ||
+        (CU_add_test(pSuite, "direct io", test_direct_io) == NULL)) {
         goto error_exit;
     }
 
@@ -0,0 +1,189 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ofsl/drive/readahead.h>
+#include <ofsl/drive/rawimage.h>
+
+#define TEST_SECTOR_SIZE 512
+#define TEST_WINDOW_MAX 64
+
+/* passes requests to the image and counts the reads */
+struct counting_drive {
+    OFSL_Drive drv;
+    OFSL_Drive* lower;
+    int reads;
+};
+
+OFSL_Drive* image;
+struct counting_drive counter;
+OFSL_Drive* drive;
+
+static int counting_update_info(OFSL_Drive* drv)
+{
+    return ofsl_drive_update_info(((struct counting_drive*)drv)->lower);
+}
+
+static ssize_t counting_read_sector(OFSL_Drive* drv, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct counting_drive* cdrv = (struct counting_drive*)drv;
+    cdrv->reads++;
+    return ofsl_drive_read_sector(cdrv->lower, buf, lba, sector_size, cnt);
+}
+
+static ssize_t counting_write_sector(OFSL_Drive* drv, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    return ofsl_drive_write_sector(((struct counting_drive*)drv)->lower, buf, lba, sector_size, cnt);
+}
+
+static const struct ofsl_drive_ops counting_ops = {
+    .update_info = counting_update_info,
+    .read_sector = counting_read_sector,
+    .write_sector = counting_write_sector,
+};
+
+static int init_test_suite(void)
+{
+    image = ofsl_drive_rawimage_create("tests/data/fat/fat12.img", 0, TEST_SECTOR_SIZE);
+    assert(image);
+    counter.drv.ops = &counting_ops;
+    counter.drv.drvinfo = image->drvinfo;
+    counter.lower = image;
+    drive = ofsl_drive_readahead_create(&counter.drv, TEST_WINDOW_MAX);
+    assert(drive);
+    return 0;
+}
+
+static int clean_test_suite(void)
+{
+    ofsl_drive_delete(drive);
+    ofsl_drive_delete(image);
+    return 0;
+}
+
+static void test_create(void)
+{
+    CU_ASSERT_PTR_NULL(ofsl_drive_readahead_create(NULL, TEST_WINDOW_MAX));
+    CU_ASSERT_PTR_NULL(ofsl_drive_readahead_create(image, 0));
+
+    CU_ASSERT_EQUAL(drive->drvinfo.sector_size, image->drvinfo.sector_size);
+    CU_ASSERT_EQUAL(drive->drvinfo.lba_max, image->drvinfo.lba_max);
+}
+
+static void test_sequential_read(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE];
+    uint8_t expected[TEST_SECTOR_SIZE];
+
+    counter.reads = 0;
+    for (lba_t lba = 0; lba <= drive->drvinfo.lba_max; lba++) {
+        CU_ASSERT_EQUAL_FATAL(ofsl_drive_read_sector(drive, buf, lba, TEST_SECTOR_SIZE, 1), 1);
+        CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, expected, lba, TEST_SECTOR_SIZE, 1), 1);
+        CU_ASSERT_EQUAL(memcmp(buf, expected, sizeof(buf)), 0);
+    }
+
+    /* the window grows up to its maximum */
+    const int expected_reads = (drive->drvinfo.lba_max + 1) / TEST_WINDOW_MAX + 8;
+    CU_ASSERT(counter.reads <= expected_reads);
+
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, drive->drvinfo.lba_max + 1, TEST_SECTOR_SIZE, 1), 0);
+}
+
+static void test_window_growth(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE];
+    OFSL_Drive* ra = ofsl_drive_readahead_create(&counter.drv, TEST_WINDOW_MAX);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ra);
+
+    /* windows of 8, 16 and 32 sectors, hits in between do not grow them */
+    counter.reads = 0;
+    for (lba_t lba = 0; lba < 8 + 16 + 32; lba++) {
+        CU_ASSERT_EQUAL(ofsl_drive_read_sector(ra, buf, lba, TEST_SECTOR_SIZE, 1), 1);
+    }
+    CU_ASSERT_EQUAL(counter.reads, 3);
+
+    ofsl_drive_delete(ra);
+}
+
+static void test_random_read(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE * 96];
+    uint8_t expected[TEST_SECTOR_SIZE * 96];
+
+    srand(0);
+    for (int i = 0; i < 256; i++) {
+        lba_t lba = rand() % 256;
+        size_t cnt = 1 + rand() % 96;
+
+        /* mix in sequential runs */
+        for (int j = 0; j < 3; j++, lba += cnt) {
+            CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, lba, TEST_SECTOR_SIZE, cnt), cnt);
+            CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, expected, lba, TEST_SECTOR_SIZE, cnt), cnt);
+            CU_ASSERT_EQUAL(memcmp(buf, expected, cnt * TEST_SECTOR_SIZE), 0);
+        }
+    }
+
+    /* random reads are not read ahead */
+    counter.reads = 0;
+    for (int i = 0; i < 16; i++) {
+        CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 1024 + i * 7, TEST_SECTOR_SIZE, 1), 1);
+    }
+    CU_ASSERT_EQUAL(counter.reads, 16);
+}
+
+static void test_write_sector(void)
+{
+    uint8_t orig[TEST_SECTOR_SIZE];
+    uint8_t buf[TEST_SECTOR_SIZE];
+    uint8_t rbuf[TEST_SECTOR_SIZE];
+
+    /* have sector 3 read ahead */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 1, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, orig, 3, TEST_SECTOR_SIZE, 1), 1);
+
+    memcpy(buf, orig, sizeof(buf));
+    buf[16] ^= 0xFF;
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, 3, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, rbuf, 2, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, rbuf, 3, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, sizeof(buf)), 0);
+
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, orig, 3, TEST_SECTOR_SIZE, 1), 1);
+}
+
+int main(int argc, char** argv)
+{
+    CU_pSuite pSuite = NULL;
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return CU_get_error();
+    }
+
+    pSuite = CU_add_suite("drive/readahead", init_test_suite, clean_test_suite);
+    if (pSuite == NULL) {
+        goto error_exit;
+    }
+
+    if ((CU_add_test(pSuite, "create", test_create) == NULL) ||
+        (CU_add_test(pSuite, "sequential read", test_sequential_read) == NULL) ||
+        (CU_add_test(pSuite, "window growth", test_window_growth) == NULL) ||
+        (CU_add_test(pSuite, "random read", test_random_read) == NULL) ||
+        (CU_add_test(pSuite, "write sector", test_write_sector) == NULL)) {
+        goto error_exit;
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+
+    int tests_failed = CU_get_run_summary()->nTestsFailed;
+    CU_cleanup_registry();
+    return tests_failed;
+
+error_exit:
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -0,0 +1,182 @@
+#include <assert.h>
+#include <string.h>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ofsl/drive/stats.h>
+#include <ofsl/drive/rawimage.h>
+
+#define TEST_SECTOR_SIZE 512
+
+OFSL_Drive* image;
+OFSL_Drive* drive;
+
+static int init_test_suite(void)
+{
+    image = ofsl_drive_rawimage_create("tests/data/drive/rawimage.img", 0, TEST_SECTOR_SIZE);
+    assert(image);
+    drive = ofsl_drive_stats_create(image);
+    assert(drive);
+    return 0;
+}
+
+static int clean_test_suite(void)
+{
+    ofsl_drive_delete(drive);
+    ofsl_drive_delete(image);
+    return 0;
+}
+
+static uint64_t hist_total(const OFSL_DriveOpStats* op)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < OFSL_DRIVE_STATS_HIST_BUCKETS; i++) {
+        total += op->latency_hist[i];
+    }
+    return total;
+}
+
+static void test_create(void)
+{
+    OFSL_DriveStats stats;
+
+    CU_ASSERT_PTR_NULL(ofsl_drive_stats_create(NULL));
+    CU_ASSERT_NOT_EQUAL(ofsl_drive_stats_get(image, &stats), 0);
+    CU_ASSERT_NOT_EQUAL(ofsl_drive_stats_reset(image), 0);
+
+    CU_ASSERT_EQUAL(ofsl_drive_stats_get(drive, &stats), 0);
+    CU_ASSERT_EQUAL(stats.read.ops, 0);
+    CU_ASSERT_EQUAL(stats.write.ops, 0);
+    CU_ASSERT_EQUAL(drive->drvinfo.lba_max, image->drvinfo.lba_max);
+}
+
+static void test_read_sector(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE * 4];
+    OFSL_DriveStats stats;
+
+    CU_ASSERT_EQUAL(ofsl_drive_stats_reset(drive), 0);
+
+    /* two sequential reads, a random one and a short one */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 1, TEST_SECTOR_SIZE, 2), 2);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 0, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 2, TEST_SECTOR_SIZE, 4), 2);
+
+    CU_ASSERT_EQUAL(ofsl_drive_stats_get(drive, &stats), 0);
+    CU_ASSERT_EQUAL(stats.read.ops, 4);
+    CU_ASSERT_EQUAL(stats.read.sectors, 6);
+    CU_ASSERT_EQUAL(stats.read.sequential, 2);
+    CU_ASSERT_EQUAL(stats.read.errors, 1);
+    CU_ASSERT_EQUAL(hist_total(&stats.read), 4);
+    CU_ASSERT_EQUAL(stats.write.ops, 0);
+
+    /* vectored read counts once */
+    OFSL_DriveIOVec iov[2] = {
+        { .lba = 0, .cnt = 1, .buf = buf },
+        { .lba = 2, .cnt = 1, .buf = buf + TEST_SECTOR_SIZE },
+    };
+    CU_ASSERT_EQUAL(ofsl_drive_read_sectorv(drive, iov, 2, TEST_SECTOR_SIZE), 2);
+    CU_ASSERT_EQUAL(ofsl_drive_stats_get(drive, &stats), 0);
+    CU_ASSERT_EQUAL(stats.read.ops, 5);
+    CU_ASSERT_EQUAL(stats.read.sectors, 8);
+
+    /* the next one is sequential if it starts after the last segment */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, buf, 3, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_stats_get(drive, &stats), 0);
+    CU_ASSERT_EQUAL(stats.read.sequential, 3);
+}
+
+static void test_write_sector(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE];
+    OFSL_DriveStats stats;
+
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, buf, 1, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_stats_reset(drive), 0);
+
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, buf, 1, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_flush(drive), 0);
+
+    CU_ASSERT_EQUAL(ofsl_drive_stats_get(drive, &stats), 0);
+    CU_ASSERT_EQUAL(stats.write.ops, 1);
+    CU_ASSERT_EQUAL(stats.write.sectors, 1);
+    CU_ASSERT_EQUAL(stats.write.errors, 0);
+    CU_ASSERT_EQUAL(hist_total(&stats.write), 1);
+    CU_ASSERT_EQUAL(stats.flushes, 1);
+    CU_ASSERT_EQUAL(stats.read.ops, 0);
+}
+
+static void test_async_io(void)
+{
+    uint8_t buf[TEST_SECTOR_SIZE * 2];
+    OFSL_DriveCompletion comp[2];
+    OFSL_DriveStats stats;
+
+    CU_ASSERT_EQUAL(ofsl_drive_stats_reset(drive), 0);
+
+    /* counted once reaped, with the tags of the caller */
+    CU_ASSERT_FALSE(ofsl_drive_submit_read(drive, buf, 0, TEST_SECTOR_SIZE, 1, 10));
+    CU_ASSERT_FALSE(ofsl_drive_submit_read(drive, buf + TEST_SECTOR_SIZE, 1, TEST_SECTOR_SIZE, 1, 11));
+    size_t reaped = 0;
+    while (reaped < 2) {
+        ssize_t ret = ofsl_drive_reap_completion(drive, comp + reaped, 2 - reaped, 2 - reaped);
+        CU_ASSERT(ret > 0);
+        if (ret <= 0) break;
+        reaped += ret;
+    }
+    CU_ASSERT_EQUAL(reaped, 2);
+    CU_ASSERT_EQUAL(comp[0].tag + comp[1].tag, 21);
+    CU_ASSERT_EQUAL(comp[0].result, 1);
+    CU_ASSERT_EQUAL(comp[1].result, 1);
+
+    CU_ASSERT_EQUAL(ofsl_drive_stats_get(drive, &stats), 0);
+    CU_ASSERT_EQUAL(stats.read.ops, 2);
+    CU_ASSERT_EQUAL(stats.read.sectors, 2);
+    CU_ASSERT_EQUAL(hist_total(&stats.read), 2);
+
+    /* a short one */
+    CU_ASSERT_FALSE(ofsl_drive_submit_read(drive, buf, drive->drvinfo.lba_max, TEST_SECTOR_SIZE, 2, 12));
+    CU_ASSERT_EQUAL(ofsl_drive_reap_completion(drive, comp, 1, 1), 1);
+    CU_ASSERT_EQUAL(comp[0].tag, 12);
+    CU_ASSERT_EQUAL(comp[0].result, 1);
+
+    CU_ASSERT_EQUAL(ofsl_drive_stats_get(drive, &stats), 0);
+    CU_ASSERT_EQUAL(stats.read.ops, 3);
+    CU_ASSERT_EQUAL(stats.read.sectors, 3);
+    CU_ASSERT_EQUAL(stats.read.errors, 1);
+    CU_ASSERT_EQUAL(stats.write.ops, 0);
+}
+
+int main(int argc, char** argv)
+{
+    CU_pSuite pSuite = NULL;
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return CU_get_error();
+    }
+
+    pSuite = CU_add_suite("drive/stats", init_test_suite, clean_test_suite);
+    if (pSuite == NULL) {
+        goto error_exit;
+    }
+
+    if ((CU_add_test(pSuite, "create", test_create) == NULL) ||
+        (CU_add_test(pSuite, "read sector", test_read_sector) == NULL) ||
+        (CU_add_test(pSuite, "write sector", test_write_sector) == NULL) ||
+        (CU_add_test(pSuite, "async io", test_async_io) == NULL)) {
+        goto error_exit;
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+
+    int tests_failed = CU_get_run_summary()->nTestsFailed;
+    CU_cleanup_registry();
+    return tests_failed;
+
+error_exit:
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -0,0 +1,214 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <CUnit/CUnit.h>
+#include <CUnit/Basic.h>
+
+#include <ofsl/drive/writeback.h>
+#include <ofsl/drive/rawimage.h>
+
+#define TEST_SECTOR_SIZE 512
+#define TEST_DIRTY_SECTORS 32
+
+/* passes requests to the image and counts the writes */
+struct counting_drive {
+    OFSL_Drive drv;
+    OFSL_Drive* lower;
+    int writes;
+    int flushes;
+    int fail_writes;
+};
+
+OFSL_Drive* image;
+struct counting_drive counter;
+OFSL_Drive* drive;
+
+static int counting_update_info(OFSL_Drive* drv)
+{
+    return ofsl_drive_update_info(((struct counting_drive*)drv)->lower);
+}
+
+static ssize_t counting_read_sector(OFSL_Drive* drv, void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    return ofsl_drive_read_sector(((struct counting_drive*)drv)->lower, buf, lba, sector_size, cnt);
+}
+
+static ssize_t counting_write_sector(OFSL_Drive* drv, const void* buf, lba_t lba, size_t sector_size, size_t cnt)
+{
+    struct counting_drive* cdrv = (struct counting_drive*)drv;
+    cdrv->writes++;
+    if (cdrv->fail_writes) {
+        return 0;
+    }
+    return ofsl_drive_write_sector(cdrv->lower, buf, lba, sector_size, cnt);
+}
+
+static int counting_flush(OFSL_Drive* drv)
+{
+    struct counting_drive* cdrv = (struct counting_drive*)drv;
+    cdrv->flushes++;
+    return ofsl_drive_flush(cdrv->lower);
+}
+
+static const struct ofsl_drive_ops counting_ops = {
+    .update_info = counting_update_info,
+    .read_sector = counting_read_sector,
+    .write_sector = counting_write_sector,
+    .flush = counting_flush,
+};
+
+static int init_test_suite(void)
+{
+    image = ofsl_drive_rawimage_create("tests/data/fat/fat12.img", 0, TEST_SECTOR_SIZE);
+    assert(image);
+    counter.drv.ops = &counting_ops;
+    counter.drv.drvinfo = image->drvinfo;
+    counter.lower = image;
+    drive = ofsl_drive_writeback_create(&counter.drv, TEST_SECTOR_SIZE * TEST_DIRTY_SECTORS);
+    assert(drive);
+    return 0;
+}
+
+static int clean_test_suite(void)
+{
+    ofsl_drive_delete(drive);
+    ofsl_drive_delete(image);
+    return 0;
+}
+
+static void test_create(void)
+{
+    CU_ASSERT_PTR_NULL(ofsl_drive_writeback_create(NULL, 4096));
+
+    CU_ASSERT_EQUAL(drive->drvinfo.sector_size, image->drvinfo.sector_size);
+    CU_ASSERT_EQUAL(drive->drvinfo.lba_max, image->drvinfo.lba_max);
+}
+
+static void test_write_sector(void)
+{
+    uint8_t orig[TEST_SECTOR_SIZE * 16];
+    uint8_t buf[TEST_SECTOR_SIZE * 16];
+    uint8_t rbuf[TEST_SECTOR_SIZE * 16];
+    const lba_t lba = 64;
+
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, orig, lba, TEST_SECTOR_SIZE, 16), 16);
+    memcpy(buf, orig, sizeof(buf));
+    for (size_t i = 0; i < 16; i++) {
+        buf[i * TEST_SECTOR_SIZE + 16] ^= 0xFF;
+    }
+
+    /* scattered single sector writes in reverse order */
+    counter.writes = 0;
+    for (int i = 15; i >= 0; i--) {
+        if (i == 8) continue;
+        CU_ASSERT_EQUAL(
+            ofsl_drive_write_sector(drive, buf + i * TEST_SECTOR_SIZE, lba + i, TEST_SECTOR_SIZE, 1),
+            1);
+    }
+    CU_ASSERT_EQUAL(counter.writes, 0);
+
+    /* held sectors are read back */
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, rbuf, lba, TEST_SECTOR_SIZE, 16), 16);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, TEST_SECTOR_SIZE * 8), 0);
+    CU_ASSERT_EQUAL(memcmp(rbuf + TEST_SECTOR_SIZE * 8, orig + TEST_SECTOR_SIZE * 8, TEST_SECTOR_SIZE), 0);
+    CU_ASSERT_EQUAL(memcmp(rbuf + TEST_SECTOR_SIZE * 9, buf + TEST_SECTOR_SIZE * 9, TEST_SECTOR_SIZE * 7), 0);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, rbuf, lba, TEST_SECTOR_SIZE, 16), 16);
+    CU_ASSERT_EQUAL(memcmp(rbuf, orig, sizeof(orig)), 0);
+
+    /* merged into one write per run of adjacent sectors */
+    counter.flushes = 0;
+    CU_ASSERT_EQUAL(ofsl_drive_flush(drive), 0);
+    CU_ASSERT_EQUAL(counter.writes, 2);
+    CU_ASSERT_EQUAL(counter.flushes, 1);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, rbuf, lba, TEST_SECTOR_SIZE, 16), 16);
+    CU_ASSERT_EQUAL(memcmp(rbuf, buf, TEST_SECTOR_SIZE * 8), 0);
+    CU_ASSERT_EQUAL(memcmp(rbuf + TEST_SECTOR_SIZE * 9, buf + TEST_SECTOR_SIZE * 9, TEST_SECTOR_SIZE * 7), 0);
+
+    /* written back once the threshold is reached */
+    uint8_t* large_orig = malloc(TEST_SECTOR_SIZE * TEST_DIRTY_SECTORS);
+    uint8_t* large_buf = malloc(TEST_SECTOR_SIZE * TEST_DIRTY_SECTORS);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(large_orig);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(large_buf);
+    CU_ASSERT_EQUAL(
+        ofsl_drive_read_sector(image, large_orig, 1024, TEST_SECTOR_SIZE, TEST_DIRTY_SECTORS),
+        TEST_DIRTY_SECTORS);
+    memset(large_buf, 0xA5, TEST_SECTOR_SIZE * TEST_DIRTY_SECTORS);
+
+    counter.writes = 0;
+    for (int i = 0; i < TEST_DIRTY_SECTORS; i++) {
+        CU_ASSERT_EQUAL(
+            ofsl_drive_write_sector(drive, orig + (i % 16) * TEST_SECTOR_SIZE, lba + i % 16, TEST_SECTOR_SIZE, 1),
+            1);
+    }
+    CU_ASSERT_EQUAL(counter.writes, 0);
+    CU_ASSERT_EQUAL(
+        ofsl_drive_write_sector(drive, large_buf, 1024, TEST_SECTOR_SIZE, TEST_DIRTY_SECTORS),
+        TEST_DIRTY_SECTORS);
+    CU_ASSERT(counter.writes > 0);
+
+    CU_ASSERT_EQUAL(
+        ofsl_drive_write_sector(drive, large_orig, 1024, TEST_SECTOR_SIZE, TEST_DIRTY_SECTORS),
+        TEST_DIRTY_SECTORS);
+    CU_ASSERT_EQUAL(ofsl_drive_flush(drive), 0);
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, rbuf, lba, TEST_SECTOR_SIZE, 16), 16);
+    CU_ASSERT_EQUAL(memcmp(rbuf, orig, sizeof(orig)), 0);
+    CU_ASSERT_EQUAL(
+        ofsl_drive_read_sector(image, large_buf, 1024, TEST_SECTOR_SIZE, TEST_DIRTY_SECTORS),
+        TEST_DIRTY_SECTORS);
+    CU_ASSERT_EQUAL(memcmp(large_buf, large_orig, TEST_SECTOR_SIZE * TEST_DIRTY_SECTORS), 0);
+
+    free(large_buf);
+    free(large_orig);
+}
+
+static void test_mixed_sector_size(void)
+{
+    uint8_t orig[TEST_SECTOR_SIZE];
+    uint8_t rbuf[TEST_SECTOR_SIZE];
+    const lba_t lba = 64;
+
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(image, orig, lba, TEST_SECTOR_SIZE, 1), 1);
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, orig, lba, TEST_SECTOR_SIZE, 1), 1);
+
+    /* other sector sizes bypass the held sectors, which must be written first */
+    counter.fail_writes = 1;
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, rbuf, lba, TEST_SECTOR_SIZE / 2, 1), -1);
+    CU_ASSERT_EQUAL(ofsl_drive_write_sector(drive, orig, lba, TEST_SECTOR_SIZE / 2, 1), 0);
+
+    counter.fail_writes = 0;
+    CU_ASSERT_EQUAL(ofsl_drive_read_sector(drive, rbuf, lba, TEST_SECTOR_SIZE / 2, 1), 1);
+    CU_ASSERT_EQUAL(memcmp(rbuf, orig, TEST_SECTOR_SIZE / 2), 0);
+    CU_ASSERT_EQUAL(ofsl_drive_flush(drive), 0);
+}
+
+int main(int argc, char** argv)
+{
+    CU_pSuite pSuite = NULL;
+
+    if (CU_initialize_registry() != CUE_SUCCESS) {
+        return CU_get_error();
+    }
+
+    pSuite = CU_add_suite("drive/writeback", init_test_suite, clean_test_suite);
+    if (pSuite == NULL) {
+        goto error_exit;
+    }
+
+    if ((CU_add_test(pSuite, "create", test_create) == NULL) ||
+        (CU_add_test(pSuite, "write sector", test_write_sector) == NULL) ||
+        (CU_add_test(pSuite, "mixed sector size", test_mixed_sector_size) == NULL)) {
+        goto error_exit;
+    }
+
+    CU_basic_set_mode(CU_BRM_VERBOSE);
+    CU_basic_run_tests();
+
+    int tests_failed = CU_get_run_summary()->nTestsFailed;
+    CU_cleanup_registry();
+    return tests_failed;
+
+error_exit:
+    CU_cleanup_registry();
+    return CU_get_error();
+}
@@ -1,11 +1,15 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <string.h>
+#include <stdio.h>
 
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 
 #include <ofsl/drive/rawimage.h>
+#include <ofsl/drive/mmap.h>
+#include <ofsl/drive/memory.h>
 #include <ofsl/fs/fat.h>
 #include <ofsl/time.h>
 
@@ -135,6 +139,268 @@ static int init_fat32_suite(void)
     return 0;
 }
 
+static int init_fat32_mmap_suite(void)
+{
+    drive = ofsl_drive_mmap_create("tests/data/fat/fat32.img", 1, TEST_SECTOR_SIZE);
+    assert(drive);
+
+    OFSL_Partition part;
+    ofsl_partition_from_drive(&part, drive);
+
+    fat = ofsl_fs_fat_create(&part);
+    assert(fat);
+
+    fsname_expected = "FAT32";
+    imgtree_path = "tests/data/fat/fat32-tree.txt";
+    lfn_enabled = 1;
+    return 0;
+}
+
+static int init_fat32_small_diskbuf_suite(void)
+{
+    drive = ofsl_drive_rawimage_create("tests/data/fat/fat32.img", 0, TEST_SECTOR_SIZE);
+    assert(drive);
+
+    OFSL_Partition part;
+    ofsl_partition_from_drive(&part, drive);
+
+    fat = ofsl_fs_fat_create(&part);
+    assert(fat);
+
+    /* entries are replaced all the time */
+    struct ofsl_fs_fat_option* options = ofsl_fs_fat_get_option(fat);
+    options->diskbuf_count = 3;
+    options->fat_diskbuf_count = 1;
+    options->dir_diskbuf_count = 1;
+    options->dcache_count = 1;
+
+    fsname_expected = "FAT32";
+    imgtree_path = "tests/data/fat/fat32-tree.txt";
+    lfn_enabled = 1;
+    return 0;
+}
+
+static int init_fat32_shared_diskbuf_suite(void)
+{
+    drive = ofsl_drive_rawimage_create("tests/data/fat/fat32.img", 0, TEST_SECTOR_SIZE);
+    assert(drive);
+
+    OFSL_Partition part;
+    ofsl_partition_from_drive(&part, drive);
+
+    fat = ofsl_fs_fat_create(&part);
+    assert(fat);
+
+    /* every entry goes to the data pool */
+    struct ofsl_fs_fat_option* options = ofsl_fs_fat_get_option(fat);
+    options->diskbuf_count = 4;
+    options->fat_diskbuf_count = 0;
+    options->dir_diskbuf_count = 0;
+
+    fsname_expected = "FAT32";
+    imgtree_path = "tests/data/fat/fat32-tree.txt";
+    lfn_enabled = 1;
+    return 0;
+}
+
+static int init_fat32_hugepage_suite(void)
+{
+    drive = ofsl_drive_rawimage_create("tests/data/fat/fat32.img", 0, TEST_SECTOR_SIZE);
+    assert(drive);
+
+    OFSL_Partition part;
+    ofsl_partition_from_drive(&part, drive);
+
+    fat = ofsl_fs_fat_create(&part);
+    assert(fat);
+
+    /* large enough for a huge page, falls back if there is none */
+    struct ofsl_fs_fat_option* options = ofsl_fs_fat_get_option(fat);
+    options->diskbuf_count = 4096;
+    options->diskbuf_hugepage = 1;
+
+    fsname_expected = "FAT32";
+    imgtree_path = "tests/data/fat/fat32-tree.txt";
+    lfn_enabled = 1;
+    return 0;
+}
+
+static int init_fat12_fat_in_memory_suite(void)
+{
+    drive = ofsl_drive_rawimage_create("tests/data/fat/fat12.img", 0, TEST_SECTOR_SIZE);
+    assert(drive);
+
+    OFSL_Partition part;
+    ofsl_partition_from_drive(&part, drive);
+
+    fat = ofsl_fs_fat_create(&part);
+    assert(fat);
+
+    struct ofsl_fs_fat_option* options = ofsl_fs_fat_get_option(fat);
+    options->fat_in_memory = 1;
+
+    fsname_expected = "FAT12";
+    imgtree_path = "tests/data/fat/fat12-tree.txt";
+    lfn_enabled = 1;
+    return 0;
+}
+
+static int init_fat32_fat_in_memory_suite(void)
+{
+    drive = ofsl_drive_rawimage_create("tests/data/fat/fat32.img", 0, TEST_SECTOR_SIZE);
+    assert(drive);
+
+    OFSL_Partition part;
+    ofsl_partition_from_drive(&part, drive);
+
+    fat = ofsl_fs_fat_create(&part);
+    assert(fat);
+
+    struct ofsl_fs_fat_option* options = ofsl_fs_fat_get_option(fat);
+    options->fat_in_memory = 1;
+
+    fsname_expected = "FAT32";
+    imgtree_path = "tests/data/fat/fat32-tree.txt";
+    lfn_enabled = 1;
+    return 0;
+}
+
+static int init_fat12_small_io_suite(void)
+{
+    drive = ofsl_drive_rawimage_create("tests/data/fat/fat12.img", 0, TEST_SECTOR_SIZE);
+    assert(drive);
+
+    OFSL_Partition part;
+    ofsl_partition_from_drive(&part, drive);
+
+    fat = ofsl_fs_fat_create(&part);
+    assert(fat);
+
+    /* a single sector or cluster per bulk read */
+    struct ofsl_fs_fat_option* options = ofsl_fs_fat_get_option(fat);
+    options->max_io_size = 1;
+    options->fat_in_memory = 1;
+
+    fsname_expected = "FAT12";
+    imgtree_path = "tests/data/fat/fat12-tree.txt";
+    lfn_enabled = 1;
+    return 0;
+}
+
+static uint8_t* image_buf;
+
+static uint32_t get_le32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void set_le32(uint8_t* p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+static int init_fat32_long_dir_suite(void)
+{
+    /* fat32.img in memory, with the root directory spread over two clusters */
+    FILE* fp = fopen("tests/data/fat/fat32.img", "rb");
+    assert(fp);
+    fseek(fp, 0, SEEK_END);
+    const size_t image_len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    image_buf = malloc(image_len);
+    assert(image_buf);
+    assert(fread(image_buf, 1, image_len, fp) == image_len);
+    fclose(fp);
+
+    const uint32_t sectors_per_cluster = image_buf[0x0D];
+    const uint32_t reserved_sectors = image_buf[0x0E] | (image_buf[0x0F] << 8);
+    const uint32_t data_begin = reserved_sectors + image_buf[0x10] * get_le32(image_buf + 0x24);
+    const uint32_t root_cluster = get_le32(image_buf + 0x2C);
+    const uint32_t last_cluster =
+        (get_le32(image_buf + 0x20) - data_begin) / sectors_per_cluster + 1;
+    const size_t entry_cnt = sectors_per_cluster * TEST_SECTOR_SIZE / 32;
+
+    uint8_t* fat_area = image_buf + reserved_sectors * TEST_SECTOR_SIZE;
+    uint8_t* root = image_buf +
+        (data_begin + (root_cluster - 2) * sectors_per_cluster) * TEST_SECTOR_SIZE;
+    uint8_t* moved = image_buf +
+        (data_begin + (last_cluster - 2) * sectors_per_cluster) * TEST_SECTOR_SIZE;
+    assert(get_le32(fat_area + 4 * root_cluster) >= 0x0FFFFFF8);
+    assert(get_le32(fat_area + 4 * last_cluster) == 0);
+
+    /* keep the volume label, move the rest and leave deleted entries behind */
+    size_t used = 1;
+    while (used < entry_cnt && root[used * 32] != 0) {
+        used++;
+    }
+    memcpy(moved, root + 32, (used - 1) * 32);
+    for (size_t i = 1; i < entry_cnt; i++) {
+        memset(root + i * 32, 0, 32);
+        root[i * 32] = 0xE5;
+    }
+    set_le32(fat_area + 4 * root_cluster, last_cluster);
+    set_le32(fat_area + 4 * last_cluster, 0x0FFFFFFF);
+
+    drive = ofsl_drive_memory_from_buffer(image_buf, image_len, 0, TEST_SECTOR_SIZE);
+    assert(drive);
+
+    OFSL_Partition part;
+    ofsl_partition_from_drive(&part, drive);
+
+    fat = ofsl_fs_fat_create(&part);
+    assert(fat);
+
+    fsname_expected = "FAT32";
+    imgtree_path = "tests/data/fat/fat32-tree.txt";
+    lfn_enabled = 1;
+    return 0;
+}
+
+static int init_fat16_2q_suite(void)
+{
+    drive = ofsl_drive_rawimage_create("tests/data/fat/fat16.img", 0, TEST_SECTOR_SIZE);
+    assert(drive);
+
+    OFSL_Partition part;
+    ofsl_partition_from_drive(&part, drive);
+
+    fat = ofsl_fs_fat_create(&part);
+    assert(fat);
+
+    /* small enough for every queue of 2Q to be cycled through */
+    struct ofsl_fs_fat_option* options = ofsl_fs_fat_get_option(fat);
+    options->diskbuf_count = 5;
+    options->cache_policy = OFSL_CACHE_2Q;
+
+    fsname_expected = "FAT16";
+    imgtree_path = "tests/data/fat/fat16-tree.txt";
+    lfn_enabled = 1;
+    return 0;
+}
+
+static int init_fat16_direct_suite(void)
+{
+    drive = ofsl_drive_rawimage_create(
+        "tests/data/fat/fat16.img",
+        OFSL_DRIVE_RAWIMAGE_READONLY | OFSL_DRIVE_RAWIMAGE_DIRECT,
+        TEST_SECTOR_SIZE);
+    assert(drive);
+
+    OFSL_Partition part;
+    ofsl_partition_from_drive(&part, drive);
+
+    fat = ofsl_fs_fat_create(&part);
+    assert(fat);
+
+    fsname_expected = "FAT16";
+    imgtree_path = "tests/data/fat/fat16-tree.txt";
+    lfn_enabled = 1;
+    return 0;
+}
+
 static void test_mount(void)
 {
     CU_ASSERT_FALSE(ofsl_fs_mount(fat));
@@ -169,6 +435,77 @@ static void test_no_such_entry(void)
     ofsl_dir_close(rootdir);
 }
 
+static void test_repeated_lookup(void)
+{
+    OFSL_Directory* rootdir = ofsl_fs_rootdir_open(fat);
+
+    /* the later lookups are answered by the name index of the directory */
+    for (int i = 0; i < 3; i++) {
+        OFSL_Directory* subdir =
+            ofsl_dir_open(rootdir, lfn_enabled ? "directory1" : "direct~1");
+        CU_ASSERT_PTR_NOT_NULL_FATAL(subdir);
+        OFSL_File* file = ofsl_file_open(subdir, "file.bin", "r");
+        CU_ASSERT_PTR_NOT_NULL(file);
+        if (file) {
+            ofsl_file_close(file);
+        }
+        CU_ASSERT_PTR_NULL(ofsl_file_open(subdir, "unavailable.file", "r"));
+        CU_ASSERT_FALSE(ofsl_dir_close(subdir));
+
+        CU_ASSERT_PTR_NULL(ofsl_dir_open(rootdir, "unavailable.directory"));
+    }
+
+    ofsl_dir_close(rootdir);
+}
+
+static void test_path_open(void)
+{
+    const char* dir_name = lfn_enabled ? "directory1" : "direct~1";
+    char path[64], data[1024], data_path[1024];
+
+    OFSL_Directory* rootdir = ofsl_fs_rootdir_open(fat);
+    OFSL_Directory* subdir = ofsl_dir_open(rootdir, dir_name);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(subdir);
+    OFSL_File* file = ofsl_file_open(subdir, "file.bin", "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    CU_ASSERT_EQUAL(ofsl_file_read(file, data, 1, sizeof(data)), sizeof(data));
+    ofsl_file_close(file);
+    ofsl_dir_close(subdir);
+    ofsl_dir_close(rootdir);
+
+    /* the second round is answered by the dentry cache */
+    snprintf(path, sizeof(path), "/%s//file.bin", dir_name);
+    for (int i = 0; i < 2; i++) {
+        file = ofsl_fs_file_open_path(fat, path, "r");
+        CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+        CU_ASSERT_EQUAL(ofsl_file_read(file, data_path, 1, sizeof(data_path)), sizeof(data_path));
+        CU_ASSERT_EQUAL(memcmp(data, data_path, sizeof(data)), 0);
+        CU_ASSERT_FALSE(ofsl_file_close(file));
+
+        subdir = ofsl_fs_dir_open_path(fat, dir_name);
+        CU_ASSERT_PTR_NOT_NULL_FATAL(subdir);
+        file = ofsl_file_open(subdir, "file.bin", "r");
+        CU_ASSERT_PTR_NOT_NULL(file);
+        if (file) {
+            ofsl_file_close(file);
+        }
+        CU_ASSERT_FALSE(ofsl_dir_close(subdir));
+
+        snprintf(path, sizeof(path), "%s/unavailable.file", dir_name);
+        CU_ASSERT_PTR_NULL(ofsl_fs_file_open_path(fat, path, "r"));
+        snprintf(path, sizeof(path), "%s/file.bin/file.bin", dir_name);
+        CU_ASSERT_PTR_NULL(ofsl_fs_file_open_path(fat, path, "r"));
+        CU_ASSERT_PTR_NULL(ofsl_fs_file_open_path(fat, "/", "r"));
+        snprintf(path, sizeof(path), "/%s//file.bin", dir_name);
+    }
+
+    rootdir = ofsl_fs_dir_open_path(fat, "/");
+    CU_ASSERT_PTR_NOT_NULL(rootdir);
+    if (rootdir) {
+        ofsl_dir_close(rootdir);
+    }
+}
+
 static void test_dir_list(void)
 {
     OFSL_Directory* rootdir = ofsl_fs_rootdir_open(fat);
@@ -295,6 +632,77 @@ static void test_dir_list(void)
     ofsl_dir_close(rootdir);
 }
 
+static void test_file_read_partial(void)
+{
+    OFSL_Directory* rootdir = ofsl_fs_rootdir_open(fat);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(rootdir);
+
+    /* the short name is shown lowercase with sfn_lowercase */
+    OFSL_File* file = ofsl_file_open(rootdir, "FILE.BIN", "r");
+    if (!file) {
+        file = ofsl_file_open(rootdir, "file.bin", "r");
+    }
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+
+    uint8_t whole[1024];
+    uint8_t part[1024];
+    CU_ASSERT_EQUAL(ofsl_file_read(file, whole, sizeof(whole), 1), 1);
+
+    /* partial head cluster, then whole clusters if they are small enough */
+    CU_ASSERT_FALSE(ofsl_file_seek(file, 100, SEEK_SET));
+    CU_ASSERT_EQUAL(ofsl_file_read(file, part, 1, sizeof(part) - 100), sizeof(part) - 100);
+    CU_ASSERT_EQUAL(memcmp(part, whole + 100, sizeof(part) - 100), 0);
+
+    /* blocks crossing cluster boundaries, the last one does not fit */
+    CU_ASSERT_FALSE(ofsl_file_seek(file, 0, SEEK_SET));
+    CU_ASSERT_EQUAL(ofsl_file_read(file, part, 300, 4), 3);
+    CU_ASSERT_EQUAL(memcmp(part, whole, 900), 0);
+    CU_ASSERT_EQUAL(ofsl_file_tell(file), 900);
+
+    /* small sequential reads, after going back to the start */
+    CU_ASSERT_FALSE(ofsl_file_seek(file, 0, SEEK_SET));
+    for (size_t offs = 0; offs + 7 <= sizeof(part); offs += 7) {
+        CU_ASSERT_EQUAL_FATAL(ofsl_file_read(file, part + offs, 7, 1), 1);
+    }
+    CU_ASSERT_EQUAL(memcmp(part, whole, sizeof(part) / 7 * 7), 0);
+
+    ofsl_file_close(file);
+    ofsl_dir_close(rootdir);
+}
+
+static void test_file_read_shared(void)
+{
+    OFSL_Directory* rootdir = ofsl_fs_rootdir_open(fat);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(rootdir);
+
+    OFSL_File* file[2];
+    for (int i = 0; i < 2; i++) {
+        file[i] = ofsl_file_open(rootdir, "FILE.BIN", "r");
+        if (!file[i]) {
+            file[i] = ofsl_file_open(rootdir, "file.bin", "r");
+        }
+        CU_ASSERT_PTR_NOT_NULL_FATAL(file[i]);
+    }
+
+    uint8_t whole[1024];
+    uint8_t part[512];
+    CU_ASSERT_EQUAL(ofsl_file_read(file[0], whole, sizeof(whole), 1), 1);
+
+    /* the second handle uses the chain mapped by the first one */
+    CU_ASSERT_FALSE(ofsl_file_seek(file[1], 512, SEEK_SET));
+    CU_ASSERT_EQUAL(ofsl_file_read(file[1], part, sizeof(part), 1), 1);
+    CU_ASSERT_EQUAL(memcmp(part, whole + 512, sizeof(part)), 0);
+
+    ofsl_file_close(file[0]);
+
+    CU_ASSERT_FALSE(ofsl_file_seek(file[1], 10, SEEK_SET));
+    CU_ASSERT_EQUAL(ofsl_file_read(file[1], part, sizeof(part), 1), 1);
+    CU_ASSERT_EQUAL(memcmp(part, whole + 10, sizeof(part)), 0);
+
+    ofsl_file_close(file[1]);
+    ofsl_dir_close(rootdir);
+}
+
 static void test_file_read(void)
 {
     OFSL_Directory* rootdir = ofsl_fs_rootdir_open(fat);
@@ -424,6 +832,78 @@ static int clean_test_suite(void)
     return 0;
 }
 
+static int clean_fat32_long_dir_suite(void)
+{
+    clean_test_suite();
+    free(image_buf);
+    return 0;
+}
+
+static void test_dir_read_error(void)
+{
+    OFSL_Directory* rootdir = ofsl_fs_rootdir_open(fat);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(rootdir);
+
+    /* the entries moved to the last cluster cannot be read */
+    const lba_t lba_max = drive->drvinfo.lba_max;
+    drive->drvinfo.lba_max = lba_max / 2;
+    CU_ASSERT_PTR_NULL(ofsl_dir_open(rootdir, "directory1"));
+    CU_ASSERT_PTR_NULL(ofsl_fs_dir_open_path(fat, "/directory1"));
+    CU_ASSERT_EQUAL(fat->error, OFSL_FSE_IO);
+    drive->drvinfo.lba_max = lba_max;
+
+    /* and are found once they can */
+    OFSL_Directory* subdir = ofsl_dir_open(rootdir, "directory1");
+    CU_ASSERT_PTR_NOT_NULL(subdir);
+    if (subdir) {
+        ofsl_dir_close(subdir);
+    }
+    subdir = ofsl_fs_dir_open_path(fat, "/directory1");
+    CU_ASSERT_PTR_NOT_NULL(subdir);
+    if (subdir) {
+        ofsl_dir_close(subdir);
+    }
+
+    ofsl_dir_close(rootdir);
+}
+
+static void test_damaged_entry_read(void)
+{
+    CU_ASSERT_FALSE_FATAL(ofsl_fs_unmount(fat));
+
+    /* entries of FILE.BIN with data but no cluster */
+    const size_t image_len = (drive->drvinfo.lba_max + 1) * TEST_SECTOR_SIZE;
+    for (size_t offs = 0; offs + 32 <= image_len; offs += 32) {
+        if (memcmp(image_buf + offs, "FILE    BIN", 11) == 0) {
+            memset(image_buf + offs + 20, 0, 2);
+            memset(image_buf + offs + 26, 0, 2);
+        }
+    }
+    CU_ASSERT_FALSE_FATAL(ofsl_fs_mount(fat));
+
+    OFSL_File* file = ofsl_fs_file_open_path(fat, "/FILE.BIN", "r");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+
+    uint8_t data[16];
+    CU_ASSERT_EQUAL(ofsl_file_read(file, data, 1, sizeof(data)), -1);
+    CU_ASSERT_EQUAL(fat->error, OFSL_FSE_ICLUSTER);
+
+    ofsl_file_close(file);
+}
+
+static void test_free_clusters(void)
+{
+    uint32_t free_cnt, run_first, run_len;
+
+    CU_ASSERT_FALSE(ofsl_fs_fat_get_free_clusters(fat, &free_cnt));
+    CU_ASSERT_FALSE(ofsl_fs_fat_get_free_run(fat, &run_first, &run_len));
+    CU_ASSERT(free_cnt > 0);
+    CU_ASSERT(run_first >= 2);
+
+    /* the images are filled from the start, the free space is in one piece */
+    CU_ASSERT_EQUAL(run_len, free_cnt);
+}
+
 int main(int argc, char** argv)
 {
     CU_pSuite pSuite = NULL;
@@ -449,10 +929,50 @@ int main(int argc, char** argv)
             .pName      = "invalid file or directory",
             .pTestFunc  =     test_no_such_entry,
         },
+        {
+            .pName      = "repeated lookup",
+            .pTestFunc  = test_repeated_lookup,
+        },
+        {
+            .pName      = "path open",
+            .pTestFunc  = test_path_open,
+        },
         {
             .pName      = "file read",
             .pTestFunc  = test_file_read,
         },
+        {
+            .pName      = "partial file read",
+            .pTestFunc  = test_file_read_partial,
+        },
+        {
+            .pName      = "shared file read",
+            .pTestFunc  = test_file_read_shared,
+        },
+        {
+            .pName      = "free clusters",
+            .pTestFunc  = test_free_clusters,
+        },
+        {
+            .pName      = "unmount",
+            .pTestFunc  = test_unmount
+        },
+        CU_TEST_INFO_NULL
+    };
+
+    static CU_TestInfo read_error_tests[] = {
+        {
+            .pName      = "mount",
+            .pTestFunc  = test_mount
+        },
+        {
+            .pName      = "directory read error",
+            .pTestFunc  = test_dir_read_error,
+        },
+        {
+            .pName      = "damaged entry read",
+            .pTestFunc  = test_damaged_entry_read,
+        },
         {
             .pName      = "unmount",
             .pTestFunc  = test_unmount
@@ -497,6 +1017,72 @@ int main(int argc, char** argv)
             .pCleanupFunc   = clean_test_suite,
             .pTests         = tests
         },
+        {
+            .pName          = "fs/fat/fat32_mmap",
+            .pInitFunc      = init_fat32_mmap_suite,
+            .pCleanupFunc   = clean_test_suite,
+            .pTests         = tests
+        },
+        {
+            .pName          = "fs/fat/fat32_small_diskbuf",
+            .pInitFunc      = init_fat32_small_diskbuf_suite,
+            .pCleanupFunc   = clean_test_suite,
+            .pTests         = tests
+        },
+        {
+            .pName          = "fs/fat/fat32_shared_diskbuf",
+            .pInitFunc      = init_fat32_shared_diskbuf_suite,
+            .pCleanupFunc   = clean_test_suite,
+            .pTests         = tests
+        },
+        {
+            .pName          = "fs/fat/fat32_hugepage",
+            .pInitFunc      = init_fat32_hugepage_suite,
+            .pCleanupFunc   = clean_test_suite,
+            .pTests         = tests
+        },
+        {
+            .pName          = "fs/fat/fat12_fat_in_memory",
+            .pInitFunc      = init_fat12_fat_in_memory_suite,
+            .pCleanupFunc   = clean_test_suite,
+            .pTests         = tests
+        },
+        {
+            .pName          = "fs/fat/fat32_fat_in_memory",
+            .pInitFunc      = init_fat32_fat_in_memory_suite,
+            .pCleanupFunc   = clean_test_suite,
+            .pTests         = tests
+        },
+        {
+            .pName          = "fs/fat/fat12_small_io",
+            .pInitFunc      = init_fat12_small_io_suite,
+            .pCleanupFunc   = clean_test_suite,
+            .pTests         = tests
+        },
+        {
+            .pName          = "fs/fat/fat32_long_dir",
+            .pInitFunc      = init_fat32_long_dir_suite,
+            .pCleanupFunc   = clean_fat32_long_dir_suite,
+            .pTests         = tests
+        },
+        {
+            .pName          = "fs/fat/fat32_read_error",
+            .pInitFunc      = init_fat32_long_dir_suite,
+            .pCleanupFunc   = clean_fat32_long_dir_suite,
+            .pTests         = read_error_tests
+        },
+        {
+            .pName          = "fs/fat/fat16_2q",
+            .pInitFunc      = init_fat16_2q_suite,
+            .pCleanupFunc   = clean_test_suite,
+            .pTests         = tests
+        },
+        {
+            .pName          = "fs/fat/fat16_direct",
+            .pInitFunc      = init_fat16_direct_suite,
+            .pCleanupFunc   = clean_test_suite,
+            .pTests         = tests
+        },
         CU_SUITE_INFO_NULL
     };
 
@@ -35,6 +35,17 @@ static int init_test_suite(void)
     return 0;
 }
 
+static int init_2q_suite(void)
+{
+    init_test_suite();
+
+    /* small enough for the file reads to go through A1in */
+    struct ofsl_fs_iso9660_option* options = ofsl_fs_iso9660_get_option(isofs);
+    options->diskbuf_count = 4;
+    options->cache_policy = OFSL_CACHE_2Q;
+    return 0;
+}
+
 static void test_mount(void)
 {
     CU_ASSERT_FALSE(ofsl_fs_mount(isofs));
@@ -147,6 +158,8 @@ static void test_file_read(void)
 
     char line_buf[512];
     char fname_buf[384];
+    char dir_path[384] = "";
+    char path_buf[800];
     char md5str_buf[2][33];
     unsigned int fsize;
     
@@ -162,6 +175,7 @@ static void test_file_read(void)
                         }
                         subdir = ofsl_dir_open(rootdir, fname_buf);
                         CU_ASSERT_PTR_NOT_NULL_FATAL(subdir);
+                        strcpy(dir_path, fname_buf);
                     }
                     break;
                 default:
@@ -222,6 +236,14 @@ static void test_file_read(void)
 
                         ofsl_file_close(file);
                         free(file_data);
+
+                        /* the same file by its path */
+                        snprintf(path_buf, sizeof(path_buf), "%s/%s", dir_path, fname_buf);
+                        file = ofsl_fs_file_open_path(isofs, path_buf, "r");
+                        CU_ASSERT_PTR_NOT_NULL(file);
+                        if (file) {
+                            ofsl_file_close(file);
+                        }
                     }
                     break;
             }
@@ -288,6 +310,12 @@ int main(int argc, char** argv)
             .pCleanupFunc = clean_test_suite,
             .pTests = tests
         },
+        {
+            .pName = "fs/iso9660/2q",
+            .pInitFunc = init_2q_suite,
+            .pCleanupFunc = clean_test_suite,
+            .pTests = tests
+        },
         CU_SUITE_INFO_NULL
     };
 